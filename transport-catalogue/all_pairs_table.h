@@ -0,0 +1,248 @@
+#pragma once
+
+#include "graph.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace graph {
+
+    // Routes between every pair of vertices of DirectedWeightedGraph, found once by Floyd–Warshall.
+    // Takes O(V^2) memory and O(V^3) time to build, so it suits medium graphs that need the
+    // fastest queries. Weights and last edges of the routes lie in flat row-major matrices
+    // processed in square blocks, small enough for the three blocks a step reads to stay in cache.
+    // In every round the blocks of the through vertices' row and column are relaxed first,
+    // and then the rest of the matrix, a row of blocks per task.
+    // The table does not keep the graph: routes are unpacked with the graph passed to BuildRoute
+    template <typename Weight>
+    class AllPairsTable {
+    private:
+        using Graph = DirectedWeightedGraph<Weight>;
+
+    public:
+        static constexpr EdgeId NO_EDGE = std::numeric_limits<EdgeId>::max();
+
+        // Everything a query needs. The route from -> to is at from * vertex count + to.
+        // The arrays may refer to a mapped snapshot instead of owning their memory
+        struct Matrices {
+            // INFINITE_WEIGHT if to is unreachable
+            ArrayStorage<Weight> weights;
+            // the last edge of the route, NO_EDGE if from == to or to is unreachable
+            ArrayStorage<EdgeId> last_edges;
+        };
+
+        // 0 threads means one per hardware thread
+        explicit AllPairsTable(const Graph& graph, size_t thread_count = 1);
+        // uses matrices built earlier, e.g. stored by GetMatrices
+        explicit AllPairsTable(Matrices matrices);
+
+        struct Route {
+            Weight weight;
+            std::vector<EdgeId> edges;
+        };
+
+        // graph has to be the one the table was built for
+        std::optional<Route> BuildRoute(const Graph& graph, VertexId from, VertexId to) const;
+
+        size_t GetVertexCount() const;
+        const Matrices& GetMatrices() const;
+
+    private:
+        // vertices along a side of a block: three blocks of doubles take 96 KB
+        static constexpr size_t BLOCK_SIZE = 64;
+        // the weight of the routes to unreachable vertices
+        static constexpr Weight INFINITE_WEIGHT = std::numeric_limits<Weight>::has_infinity
+            ? std::numeric_limits<Weight>::infinity() : std::numeric_limits<Weight>::max();
+
+        size_t vertex_count_;
+        Matrices matrices_;
+
+        // relaxes the routes from the vertices of row_block to the ones of column_block
+        // through the vertices of through_block, one through vertex after another
+        void RelaxBlock(std::vector<Weight>& weights, std::vector<EdgeId>& last_edges,
+            size_t row_block, size_t column_block, size_t through_block) const;
+        // relaxes the routes to the vertices [first, last) through a vertex the route to which weighs weight_to_through
+        static void RelaxRow(Weight weight_to_through, const Weight* through_weights, const EdgeId* through_last_edges,
+            Weight* from_weights, EdgeId* from_last_edges, size_t first, size_t last);
+    };
+
+    template <typename Weight>
+    AllPairsTable<Weight>::AllPairsTable(const Graph& graph, size_t thread_count)
+        : vertex_count_(graph.GetVertexCount())
+    {
+        std::vector<Weight> weights(vertex_count_ * vertex_count_, INFINITE_WEIGHT);
+        std::vector<EdgeId> last_edges(vertex_count_ * vertex_count_, NO_EDGE);
+        for (VertexId vertex = 0; vertex < vertex_count_; ++vertex) {
+            weights[vertex * vertex_count_ + vertex] = Weight{};
+        }
+        for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+            const auto& edge = graph.GetEdge(edge_id);
+            if (edge.weight < Weight{}) {
+                throw std::domain_error("Edges' weights should be non-negative");
+            }
+            const size_t index = edge.from * vertex_count_ + edge.to;
+            if (edge.weight < weights[index]) {
+                weights[index] = edge.weight;
+                last_edges[index] = edge_id;
+            }
+        }
+
+        std::optional<thread_pool::ThreadPool> pool;
+        if (thread_count != 1) {
+            pool.emplace(thread_count);
+        }
+        const auto for_each = [&pool](size_t count, auto function) {
+            if (pool) {
+                thread_pool::ParallelFor(*pool, count, function);
+                return;
+            }
+            for (size_t i = 0; i < count; ++i) {
+                function(i);
+            }
+        };
+
+        const size_t block_count = (vertex_count_ + BLOCK_SIZE - 1) / BLOCK_SIZE;
+        for (size_t through_block = 0; through_block < block_count; ++through_block) {
+            RelaxBlock(weights, last_edges, through_block, through_block, through_block);
+            // the row and the column of the through block depend only on the diagonal one
+            for_each(block_count * 2, [&](size_t task) {
+                const size_t block = task / 2;
+                if (block == through_block) {
+                    return;
+                }
+                if (task % 2 == 0) {
+                    RelaxBlock(weights, last_edges, through_block, block, through_block);
+                }
+                else {
+                    RelaxBlock(weights, last_edges, block, through_block, through_block);
+                }
+            });
+            // the rest depends only on the row and the column, which do not change any more
+            for_each(block_count, [&](size_t row_block) {
+                if (row_block == through_block) {
+                    return;
+                }
+                for (size_t column_block = 0; column_block < block_count; ++column_block) {
+                    if (column_block != through_block) {
+                        RelaxBlock(weights, last_edges, row_block, column_block, through_block);
+                    }
+                }
+            });
+        }
+        matrices_ = { ArrayStorage<Weight>(std::move(weights)), ArrayStorage<EdgeId>(std::move(last_edges)) };
+    }
+
+    template <typename Weight>
+    AllPairsTable<Weight>::AllPairsTable(Matrices matrices)
+        : vertex_count_(0)
+        , matrices_(std::move(matrices))
+    {
+        while (vertex_count_ * vertex_count_ < matrices_.weights.size()) {
+            ++vertex_count_;
+        }
+        if (vertex_count_ * vertex_count_ != matrices_.weights.size() || matrices_.last_edges.size() != matrices_.weights.size()) {
+            throw std::invalid_argument("All-pairs matrices should be square and of the same size");
+        }
+    }
+
+    template <typename Weight>
+    size_t AllPairsTable<Weight>::GetVertexCount() const {
+        return vertex_count_;
+    }
+
+    template <typename Weight>
+    const typename AllPairsTable<Weight>::Matrices& AllPairsTable<Weight>::GetMatrices() const {
+        return matrices_;
+    }
+
+    template <typename Weight>
+    void AllPairsTable<Weight>::RelaxBlock(std::vector<Weight>& weights, std::vector<EdgeId>& last_edges,
+        size_t row_block, size_t column_block, size_t through_block) const {
+        const size_t first_row = row_block * BLOCK_SIZE;
+        const size_t last_row = std::min(first_row + BLOCK_SIZE, vertex_count_);
+        const size_t first_column = column_block * BLOCK_SIZE;
+        const size_t last_column = std::min(first_column + BLOCK_SIZE, vertex_count_);
+        const size_t first_through = through_block * BLOCK_SIZE;
+        const size_t last_through = std::min(first_through + BLOCK_SIZE, vertex_count_);
+
+        for (size_t through = first_through; through < last_through; ++through) {
+            const Weight* through_weights = weights.data() + through * vertex_count_;
+            const EdgeId* through_last_edges = last_edges.data() + through * vertex_count_;
+            for (size_t from = first_row; from < last_row; ++from) {
+                const Weight weight_to_through = weights[from * vertex_count_ + through];
+                if (weight_to_through == INFINITE_WEIGHT) {
+                    continue;
+                }
+                RelaxRow(weight_to_through, through_weights, through_last_edges,
+                    weights.data() + from * vertex_count_, last_edges.data() + from * vertex_count_, first_column, last_column);
+            }
+        }
+    }
+
+    template <typename Weight>
+    void AllPairsTable<Weight>::RelaxRow(Weight weight_to_through, const Weight* through_weights, const EdgeId* through_last_edges,
+        Weight* from_weights, EdgeId* from_last_edges, size_t first, size_t last) {
+#ifdef __SSE2__
+        if constexpr (std::is_same_v<Weight, double>) {
+            // routes rarely get shorter after the first rounds, so only the weights are relaxed
+            // four at a time, and the last edges of the shorter routes are copied one by one
+            const __m128d through = _mm_set1_pd(weight_to_through);
+            for (; first + 4 <= last; first += 4) {
+                const __m128d low_weights = _mm_loadu_pd(from_weights + first);
+                const __m128d high_weights = _mm_loadu_pd(from_weights + first + 2);
+                const __m128d low_candidates = _mm_add_pd(through, _mm_loadu_pd(through_weights + first));
+                const __m128d high_candidates = _mm_add_pd(through, _mm_loadu_pd(through_weights + first + 2));
+                const int shorter = _mm_movemask_pd(_mm_cmplt_pd(low_candidates, low_weights))
+                    | _mm_movemask_pd(_mm_cmplt_pd(high_candidates, high_weights)) << 2;
+                if (shorter == 0) {
+                    continue;
+                }
+                _mm_storeu_pd(from_weights + first, _mm_min_pd(low_candidates, low_weights));
+                _mm_storeu_pd(from_weights + first + 2, _mm_min_pd(high_candidates, high_weights));
+                for (size_t lane = 0; lane < 4; ++lane) {
+                    if (shorter & (1 << lane)) {
+                        from_last_edges[first + lane] = through_last_edges[first + lane];
+                    }
+                }
+            }
+        }
+#endif
+        for (; first < last; ++first) {
+            // an integer weight would overflow
+            if (through_weights[first] == INFINITE_WEIGHT) {
+                continue;
+            }
+            const Weight candidate_weight = weight_to_through + through_weights[first];
+            if (candidate_weight < from_weights[first]) {
+                from_weights[first] = candidate_weight;
+                from_last_edges[first] = through_last_edges[first];
+            }
+        }
+    }
+
+    template <typename Weight>
+    std::optional<typename AllPairsTable<Weight>::Route> AllPairsTable<Weight>::BuildRoute(const Graph& graph,
+        VertexId from, VertexId to) const {
+        const Weight weight = matrices_.weights[from * vertex_count_ + to];
+        if (weight == INFINITE_WEIGHT) {
+            return std::nullopt;
+        }
+        std::vector<EdgeId> edges;
+        for (VertexId vertex = to; vertex != from; vertex = graph.GetEdge(edges.back()).from) {
+            edges.push_back(matrices_.last_edges[from * vertex_count_ + vertex]);
+        }
+        std::reverse(edges.begin(), edges.end());
+        return Route{ weight, std::move(edges) };
+    }
+
+}  // namespace graph
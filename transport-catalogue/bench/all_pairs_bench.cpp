@@ -0,0 +1,158 @@
+#include "../serialization.h"
+#include "bench.h"
+
+#include <cmath>
+#include <filesystem>
+#include <iostream>
+#include <optional>
+#include <vector>
+
+// The all-pairs table: build time on random transport-like graphs for 1, 2 and 4 threads next to the old
+// triple-loop router, both checked against Dijkstra, and the time to restore the table from a snapshot
+// instead of building it for a generated city
+
+namespace {
+
+    // chains of vertices both ways with a few links missing and random transfers; some weights are zero
+    graph::DirectedWeightedGraph<double> MakeTransportGraph(size_t vertex_count) {
+        std::mt19937 generator(static_cast<uint32_t>(vertex_count));
+        std::vector<graph::Edge<double>> edges;
+        for (size_t vertex = 0; vertex + 1 < vertex_count; ++vertex) {
+            const auto from = static_cast<graph::VertexId>(vertex);
+            if (generator() % 8 != 0) {
+                edges.emplace_back(from, from + 1, (generator() % 10) * 0.5, graph::EdgeType::BUS, 0, 1);
+            }
+            if (generator() % 8 != 0) {
+                edges.emplace_back(from + 1, from, (generator() % 10) * 0.5, graph::EdgeType::BUS, 0, 1);
+            }
+        }
+        for (size_t i = 0; i < vertex_count; ++i) {
+            const auto from = static_cast<graph::VertexId>(generator() % vertex_count);
+            const auto to = static_cast<graph::VertexId>(generator() % vertex_count);
+            edges.emplace_back(from, to, (generator() % 100) * 0.25, graph::EdgeType::WAIT, 0, 0);
+        }
+        return graph::DirectedWeightedGraph<double>(vertex_count, edges);
+    }
+
+    // The all-pairs router before the blocked Floyd–Warshall table: a matrix of optional routes,
+    // each with the last edge of the route, relaxed through every vertex in a plain triple loop.
+    // It is kept here only to measure the old build time on the same graphs
+    struct OldRouteData {
+        double weight;
+        std::optional<graph::EdgeId> prev_edge;
+    };
+    using OldRoutesData = std::vector<std::vector<std::optional<OldRouteData>>>;
+
+    OldRoutesData BuildOldAllPairsTable(const graph::DirectedWeightedGraph<double>& graph) {
+        const size_t vertex_count = graph.GetVertexCount();
+        OldRoutesData routes(vertex_count, std::vector<std::optional<OldRouteData>>(vertex_count));
+        for (graph::VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+            routes[vertex][vertex] = OldRouteData{ 0.0, std::nullopt };
+            for (const graph::EdgeId edge_id : graph.GetIncidentEdges(vertex)) {
+                const auto& edge = graph.GetEdge(edge_id);
+                auto& route = routes[vertex][edge.to];
+                if (!route || route->weight > edge.weight) {
+                    route = OldRouteData{ edge.weight, edge_id };
+                }
+            }
+        }
+        for (graph::VertexId vertex_through = 0; vertex_through < vertex_count; ++vertex_through) {
+            for (graph::VertexId vertex_from = 0; vertex_from < vertex_count; ++vertex_from) {
+                if (const auto& route_from = routes[vertex_from][vertex_through]) {
+                    for (graph::VertexId vertex_to = 0; vertex_to < vertex_count; ++vertex_to) {
+                        if (const auto& route_to = routes[vertex_through][vertex_to]) {
+                            auto& route = routes[vertex_from][vertex_to];
+                            const double candidate_weight = route_from->weight + route_to->weight;
+                            if (!route || candidate_weight < route->weight) {
+                                route = OldRouteData{ candidate_weight, route_to->prev_edge ? route_to->prev_edge : route_from->prev_edge };
+                            }
+                        }
+                    }
+                }
+            }
+        }
+        return routes;
+    }
+
+    // the number of random pairs whose route weight, as get_weight(from, to) gives it, differs from Dijkstra's
+    template <typename GetWeight>
+    size_t CountMismatches(const graph::DirectedWeightedGraph<double>& graph, GetWeight get_weight) {
+        const graph::Router<double> dijkstra(graph);
+        std::mt19937 generator(1);
+        size_t mismatch_count = 0;
+        for (int i = 0; i < 1000; ++i) {
+            const auto from = static_cast<graph::VertexId>(generator() % graph.GetVertexCount());
+            const auto to = static_cast<graph::VertexId>(generator() % graph.GetVertexCount());
+            const auto expected = dijkstra.BuildRoute(from, to);
+            const std::optional<double> weight = get_weight(from, to);
+            if (expected.has_value() != weight.has_value() || (expected && std::abs(expected->weight - *weight) > 1e-9)) {
+                ++mismatch_count;
+            }
+        }
+        return mismatch_count;
+    }
+
+    void MeasureSnapshot() {
+        // 144 stops and 30 buses of 30 stops
+        const bench::Feed feed = bench::MakeCityFeed(5, 12, 30, 30);
+        transport_catalogue::TransportCatalogue catalogue;
+        bench::FillCatalogue(feed, catalogue);
+        transport_router::TranspRouteParams params;
+        params.bus_wait_time = 6;
+        params.bus_velocity = 40;
+        params.algorithm = graph::RouterAlgorithm::ALL_PAIRS;
+
+        std::optional<transport_router::TransportRouter> router;
+        const double build_ms = bench::MeasureBest(1, [&] {
+            router.emplace(catalogue, params);
+        });
+        const serialization::SerializationSettings settings{ std::filesystem::temp_directory_path() / "all_pairs_bench.db" };
+        const renderer::MapRenderer renderer{};
+        serialization::SaveSnapshot(settings, catalogue, renderer, *router);
+
+        double total_time = 0;
+        const double load_ms = bench::MeasureBest(3, [&] {
+            const serialization::Snapshot snapshot(settings);
+            transport_catalogue::TransportCatalogue loaded_catalogue;
+            snapshot.LoadCatalogue(loaded_catalogue);
+            const transport_router::TransportRouter loaded_router(loaded_catalogue, snapshot.GetRoutingSettings(),
+                snapshot.GetRoutingGraph(), snapshot.GetContractionHierarchy(), snapshot.GetAllPairsTable());
+            const auto route = loaded_router.MakeRoute(feed.stops.front().name, feed.stops.back().name);
+            total_time += route ? route->total_time : 0;
+        });
+        std::filesystem::remove(settings.file);
+
+        std::cout << feed.stops.size() << " stops, " << router->GetGraph().GetVertexCount() << " vertices: building the router "
+            << build_ms << " ms, loading it from the snapshot " << load_ms << " ms (" << total_time << ")\n";
+    }
+
+}  // namespace
+
+int main() {
+    for (const size_t vertex_count : { 256, 512, 1024, 2048 }) {
+        const auto graph = MakeTransportGraph(vertex_count);
+        OldRoutesData old_routes;
+        const double old_ms = bench::MeasureBest(1, [&] {
+            old_routes = BuildOldAllPairsTable(graph);
+        });
+        std::cout << "V = " << vertex_count << ": old triple loop " << old_ms << " ms;";
+        size_t mismatch_count = CountMismatches(graph, [&](graph::VertexId from, graph::VertexId to) -> std::optional<double> {
+            const auto& route = old_routes[from][to];
+            return route ? std::optional<double>(route->weight) : std::nullopt;
+        });
+        old_routes = {};
+        for (const size_t thread_count : { 1, 2, 4 }) {
+            std::optional<graph::AllPairsTable<double>> table;
+            const double ms = bench::MeasureBest(1, [&] {
+                table.emplace(graph, thread_count);
+            });
+            std::cout << (thread_count == 1 ? " " : ", ") << thread_count << (thread_count == 1 ? " thread " : " threads ") << ms << " ms";
+            mismatch_count += CountMismatches(graph, [&](graph::VertexId from, graph::VertexId to) -> std::optional<double> {
+                const auto route = table->BuildRoute(graph, from, to);
+                return route ? std::optional<double>(route->weight) : std::nullopt;
+            });
+        }
+        std::cout << "; " << mismatch_count << " routes differ from Dijkstra's\n";
+    }
+    MeasureSnapshot();
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+// Replaces the global operator new and delete to count allocations and the bytes in use,
+// so it has to be included by one file of a program only
+namespace bench {
+
+    struct AllocationCounters {
+        std::atomic<size_t> count{ 0 };
+        std::atomic<size_t> bytes_in_use{ 0 };
+    };
+
+    inline AllocationCounters& GetAllocationCounters() {
+        static AllocationCounters counters;
+        return counters;
+    }
+
+    namespace detail {
+        // every block starts with its size, padded to keep the alignment of operator new
+        constexpr size_t ALLOCATION_HEADER_SIZE = alignof(std::max_align_t);
+    }
+
+}  // namespace bench
+
+void* operator new(size_t size) {
+    char* block = static_cast<char*>(std::malloc(size + bench::detail::ALLOCATION_HEADER_SIZE));
+    if (block == nullptr) {
+        throw std::bad_alloc();
+    }
+    *reinterpret_cast<size_t*>(block) = size;
+    ++bench::GetAllocationCounters().count;
+    bench::GetAllocationCounters().bytes_in_use += size;
+    return block + bench::detail::ALLOCATION_HEADER_SIZE;
+}
+
+void operator delete(void* pointer) noexcept {
+    if (pointer == nullptr) {
+        return;
+    }
+    char* block = static_cast<char*>(pointer) - bench::detail::ALLOCATION_HEADER_SIZE;
+    bench::GetAllocationCounters().bytes_in_use -= *reinterpret_cast<size_t*>(block);
+    std::free(block);
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+    operator delete(pointer);
+}
@@ -0,0 +1,174 @@
+#pragma once
+
+#include "../json_writer.h"
+#include "../transport_catalogue.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <random>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Helpers shared by the benchmark programs: timing and generated feeds
+namespace bench {
+
+    // the best wall time of repeat_count runs of function, in milliseconds
+    template <typename Function>
+    double MeasureBest(int repeat_count, Function function) {
+        double best = std::numeric_limits<double>::infinity();
+        for (int i = 0; i < repeat_count; ++i) {
+            const auto start = std::chrono::steady_clock::now();
+            function();
+            best = std::min(best, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+        }
+        return best;
+    }
+
+    // A generated feed, kept apart from the catalogue so that it can be loaded both directly and as JSON
+    struct Feed {
+        struct Stop {
+            std::string name;
+            geo::Coordinates coordinates;
+        };
+        struct Bus {
+            std::string name;
+            // indices in stops; a roundtrip route ends at its first stop
+            std::vector<uint32_t> stops;
+            bool is_roundtrip;
+        };
+        struct Distance {
+            uint32_t from;
+            uint32_t to;
+            int meters;
+        };
+
+        std::vector<Stop> stops;
+        std::vector<Bus> buses;
+        std::vector<Distance> distances;
+    };
+
+    // A city: grid_side * grid_side stops on a grid about ten kilometres wide and buses walking
+    // route_size stops between neighbouring ones, every other bus a roundtrip. Every road is
+    // 1.05 to 1.6 times its great circle, and a third of them are longer the other way
+    inline Feed MakeCityFeed(uint32_t seed, size_t grid_side, size_t bus_count, size_t route_size) {
+        std::mt19937 generator(seed);
+        std::uniform_real_distribution<double> jitter(0.0, 0.5);
+        std::uniform_real_distribution<double> road_factor(1.05, 1.6);
+        const double step = 0.1 / static_cast<double>(grid_side);
+
+        Feed feed;
+        for (size_t row = 0; row < grid_side; ++row) {
+            for (size_t column = 0; column < grid_side; ++column) {
+                const geo::Coordinates coordinates{ 55.6 + (row + jitter(generator)) * step, 37.5 + (column + jitter(generator)) * step * 1.8 };
+                feed.stops.push_back({ "Stop number " + std::to_string(feed.stops.size()), coordinates });
+            }
+        }
+
+        for (size_t bus = 0; bus < bus_count; ++bus) {
+            Feed::Bus& route = feed.buses.emplace_back();
+            route.name = "Bus " + std::to_string(bus);
+            route.is_roundtrip = bus % 2 == 0;
+            size_t row = generator() % grid_side;
+            size_t column = generator() % grid_side;
+            for (size_t i = 0; i < route_size; ++i) {
+                route.stops.push_back(static_cast<uint32_t>(row * grid_side + column));
+                switch (generator() % 4) {
+                case 0: row = row > 0 ? row - 1 : row + 1; break;
+                case 1: row = row + 1 < grid_side ? row + 1 : row - 1; break;
+                case 2: column = column > 0 ? column - 1 : column + 1; break;
+                default: column = column + 1 < grid_side ? column + 1 : column - 1; break;
+                }
+            }
+            if (route.is_roundtrip) {
+                route.stops.push_back(route.stops.front());
+            }
+            for (size_t i = 0; i + 1 < route.stops.size(); ++i) {
+                const uint32_t from = route.stops[i];
+                const uint32_t to = route.stops[i + 1];
+                const double distance = geo::ComputeDistance(feed.stops[from].coordinates, feed.stops[to].coordinates);
+                const int meters = static_cast<int>(distance * road_factor(generator)) + 1;
+                feed.distances.push_back({ from, to, meters });
+                if (generator() % 3 == 0) {
+                    feed.distances.push_back({ to, from, meters + static_cast<int>(generator() % 300) });
+                }
+            }
+        }
+        return feed;
+    }
+
+    // adds the feed the way JsonReader does, with linear routes expanded there and back
+    inline void FillCatalogue(const Feed& feed, transport_catalogue::TransportCatalogue& catalogue) {
+        for (const Feed::Stop& stop : feed.stops) {
+            catalogue.AddStop(stop.name, stop.coordinates);
+        }
+        for (const Feed::Distance& distance : feed.distances) {
+            catalogue.SetStopDistances(feed.stops[distance.from].name, feed.stops[distance.to].name, distance.meters);
+        }
+        std::vector<std::string_view> stops;
+        for (const Feed::Bus& bus : feed.buses) {
+            stops.clear();
+            for (const uint32_t stop : bus.stops) {
+                stops.push_back(feed.stops[stop].name);
+            }
+            for (size_t i = bus.stops.size(); !bus.is_roundtrip && i > 1; --i) {
+                stops.push_back(feed.stops[bus.stops[i - 2]].name);
+            }
+            catalogue.AddBus(bus.name, stops, bus.is_roundtrip);
+        }
+    }
+
+    // the feed as base_requests and routing_settings of an input document, indented like json::Print,
+    // with build_settings ahead of base_requests, where the streaming loader sees it, if build_thread_count is given.
+    // As in the catalogue, the first distance given for a pair of stops is the one kept
+    inline std::string MakeFeedJson(const Feed& feed, std::optional<size_t> build_thread_count = std::nullopt) {
+        std::vector<std::vector<std::pair<std::string_view, int>>> road_distances(feed.stops.size());
+        for (const Feed::Distance& distance : feed.distances) {
+            road_distances[distance.from].emplace_back(feed.stops[distance.to].name, distance.meters);
+        }
+        for (auto& distances : road_distances) {
+            std::stable_sort(distances.begin(), distances.end(), [](const auto& lhs, const auto& rhs) {
+                return lhs.first < rhs.first;
+            });
+            distances.erase(std::unique(distances.begin(), distances.end(), [](const auto& lhs, const auto& rhs) {
+                return lhs.first == rhs.first;
+            }), distances.end());
+        }
+
+        std::string text;
+        json::Writer writer(text);
+        writer.StartDict();
+        if (build_thread_count) {
+            writer.Key("build_settings").StartDict().Key("threads").Value(static_cast<int>(*build_thread_count)).EndDict();
+        }
+        writer.Key("base_requests").StartArray();
+        for (size_t stop = 0; stop < feed.stops.size(); ++stop) {
+            writer.StartDict()
+                .Key("latitude").Value(feed.stops[stop].coordinates.lat)
+                .Key("longitude").Value(feed.stops[stop].coordinates.lng)
+                .Key("name").Value(feed.stops[stop].name)
+                .Key("road_distances").StartDict();
+            for (const auto& [to_stop, meters] : road_distances[stop]) {
+                writer.Key(to_stop).Value(meters);
+            }
+            writer.EndDict().Key("type").Value("Stop").EndDict();
+        }
+        for (const Feed::Bus& bus : feed.buses) {
+            writer.StartDict().Key("is_roundtrip").Value(bus.is_roundtrip).Key("name").Value(bus.name).Key("stops").StartArray();
+            for (const uint32_t stop : bus.stops) {
+                writer.Value(feed.stops[stop].name);
+            }
+            writer.EndArray().Key("type").Value("Bus").EndDict();
+        }
+        writer.EndArray();
+        writer.Key("routing_settings").StartDict().Key("bus_velocity").Value(40).Key("bus_wait_time").Value(6).EndDict()
+            .EndDict();
+        writer.Flush();
+        return text;
+    }
+
+}  // namespace bench
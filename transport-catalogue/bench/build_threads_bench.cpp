@@ -0,0 +1,40 @@
+#include "../json_reader.h"
+#include "bench.h"
+
+#include <algorithm>
+#include <iostream>
+#include <limits>
+#include <sstream>
+
+// Loading a large generated input and building its routing graph with build_settings.threads of 1, 2, 4 and 8,
+// both by the streaming loader and by ApplyBaseRequests on a parsed document
+
+int main() {
+    // about 200 thousand stops and 40 thousand buses
+    const bench::Feed feed = bench::MakeCityFeed(8, 447, 40000, 10);
+    for (const size_t thread_count : { 1, 2, 4, 8 }) {
+        const std::string text = bench::MakeFeedJson(feed, thread_count);
+        const double streaming_ms = bench::MeasureBest(3, [&] {
+            std::istringstream input(text);
+            transport_catalogue::TransportCatalogue catalogue;
+            const json_reader::JsonReader reader(input, catalogue);
+        });
+
+        double apply_ms = std::numeric_limits<double>::infinity();
+        double router_ms = std::numeric_limits<double>::infinity();
+        for (int i = 0; i < 3; ++i) {
+            std::istringstream input(text);
+            const json_reader::JsonReader reader(input);
+            transport_catalogue::TransportCatalogue catalogue;
+            apply_ms = std::min(apply_ms, bench::MeasureBest(1, [&] {
+                reader.ApplyBaseRequests(catalogue);
+            }));
+            router_ms = std::min(router_ms, bench::MeasureBest(1, [&] {
+                const transport_router::TransportRouter router(catalogue, reader.GetRoutingSettings(), reader.GetBuildThreadCount());
+            }));
+        }
+
+        std::cout << "threads " << thread_count << ": streaming load " << streaming_ms << " ms, ApplyBaseRequests "
+            << apply_ms << " ms, routing graph " << router_ms << " ms\n";
+    }
+}
@@ -0,0 +1,36 @@
+#include "../transport_catalogue.h"
+#include "bench.h"
+
+#include <iostream>
+
+// Bus requests: the first request for every bus of a generated city, and then many requests for a few hot buses
+
+int main() {
+    // 19881 stops and 5000 buses of 40 stops
+    const bench::Feed feed = bench::MakeCityFeed(1, 141, 5000, 40);
+    transport_catalogue::TransportCatalogue catalogue;
+    bench::FillCatalogue(feed, catalogue);
+
+    double sum = 0;
+    const double cold_ms = bench::MeasureBest(1, [&] {
+        for (const bench::Feed::Bus& bus : feed.buses) {
+            sum += catalogue.GetBusInfo(bus.name).curvature;
+        }
+    });
+
+    constexpr int QUERY_COUNT = 1000000;
+    constexpr size_t HOT_BUS_COUNT = 100;
+    std::mt19937 generator(2);
+    std::vector<std::string_view> queries;
+    for (int i = 0; i < QUERY_COUNT; ++i) {
+        queries.push_back(feed.buses[generator() % HOT_BUS_COUNT].name);
+    }
+    const double hot_ms = bench::MeasureBest(3, [&] {
+        for (const std::string_view bus : queries) {
+            sum += catalogue.GetBusInfo(bus).curvature;
+        }
+    });
+
+    std::cout << "first request for each of " << feed.buses.size() << " buses: " << cold_ms << " ms; "
+        << QUERY_COUNT << " requests for " << HOT_BUS_COUNT << " buses: " << hot_ms << " ms (" << sum << ")\n";
+}
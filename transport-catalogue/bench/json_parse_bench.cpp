@@ -0,0 +1,106 @@
+#include "../json.h"
+#include "bench.h"
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+// Throughput of json::Parse, and of json::Load for comparison, on a large generated input, indented and compact,
+// or on the file given as the argument
+
+namespace {
+
+    // counts the events so that the parser's work is not optimized away
+    class EventCounter : public json::EventHandler {
+    public:
+        size_t GetCount() const {
+            return count_;
+        }
+
+        void StartDict() override {
+            ++count_;
+        }
+        void Key(std::string_view key) override {
+            count_ += key.size();
+        }
+        void EndDict() override {
+        }
+        void StartArray() override {
+            ++count_;
+        }
+        void EndArray() override {
+        }
+        void Null() override {
+            ++count_;
+        }
+        void Bool(bool) override {
+            ++count_;
+        }
+        void Int(int) override {
+            ++count_;
+        }
+        void Double(double) override {
+            ++count_;
+        }
+        void String(std::string_view value) override {
+            count_ += value.size();
+        }
+
+    private:
+        size_t count_ = 0;
+    };
+
+    // the same document without the whitespace outside strings
+    std::string RemoveSpaces(std::string_view text) {
+        std::string result;
+        result.reserve(text.size());
+        bool is_in_string = false;
+        for (size_t i = 0; i < text.size(); ++i) {
+            const char c = text[i];
+            if (is_in_string) {
+                result.push_back(c);
+                if (c == '\\') {
+                    result.push_back(text[++i]);
+                }
+                else if (c == '"') {
+                    is_in_string = false;
+                }
+            }
+            else if (c != ' ' && c != '\n' && c != '\r' && c != '\t') {
+                result.push_back(c);
+                is_in_string = c == '"';
+            }
+        }
+        return result;
+    }
+
+    void MeasureParse(std::string_view name, const std::string& text) {
+        size_t count = 0;
+        const double parse_ms = bench::MeasureBest(5, [&] {
+            EventCounter counter;
+            json::Parse(text, counter);
+            count = counter.GetCount();
+        });
+        const double load_ms = bench::MeasureBest(1, [&] {
+            std::istringstream input(text);
+            json::Load(input);
+        });
+        std::cout << name << ' ' << text.size() / 1000000 << " MB: Parse " << parse_ms << " ms, "
+            << text.size() / 1000.0 / parse_ms << " MB/s; Load " << load_ms << " ms (" << count << ")\n";
+    }
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    if (argc > 1) {
+        std::ifstream input(argv[1], std::ios::binary);
+        std::ostringstream text;
+        text << input.rdbuf();
+        MeasureParse(argv[1], text.str());
+        return 0;
+    }
+    // about 200 thousand stops and 40 thousand buses
+    const std::string indented = bench::MakeFeedJson(bench::MakeCityFeed(8, 447, 40000, 10));
+    MeasureParse("indented", indented);
+    MeasureParse("compact", RemoveSpaces(indented));
+}
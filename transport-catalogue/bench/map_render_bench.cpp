@@ -0,0 +1,88 @@
+#include "../map_renderer.h"
+#include "allocations.h"
+#include "bench.h"
+
+#include <iostream>
+
+// Rendering of a large generated city: the whole map with the allocations it makes,
+// the level-of-detail options, and tiles of a few zoom levels
+
+namespace {
+
+    void SetUpRenderer(renderer::MapRenderer& renderer) {
+        renderer.width_ = 1200;
+        renderer.height_ = 1200;
+        renderer.padding_ = 50;
+        renderer.line_width_ = 14;
+        renderer.stop_radius_ = 5;
+        renderer.bus_label_font_size_ = 20;
+        renderer.bus_label_offset_ = { 7, 15 };
+        renderer.stop_label_font_size_ = 20;
+        renderer.stop_label_offset_ = { 7, -3 };
+        renderer.underlayer_color_ = svg::Rgba{ 255, 255, 255, 0.85 };
+        renderer.underlayer_width_ = 3;
+        renderer.color_palette_ = { svg::Color{ "green" }, svg::Rgb{ 255, 160, 0 }, svg::Color{ "red" } };
+    }
+
+    struct DetailLevel {
+        const char* name;
+        double simplify_tolerance;
+        bool merge_shared_segments;
+        double min_stop_distance;
+    };
+
+    // every run uses a new renderer, so that the map is not taken from the cache of the previous one
+    void MeasureMap(const transport_catalogue::TransportCatalogue& catalogue, const DetailLevel& level) {
+        size_t size = 0;
+        size_t allocation_count = 0;
+        const double ms = bench::MeasureBest(3, [&] {
+            renderer::MapRenderer renderer;
+            SetUpRenderer(renderer);
+            renderer.simplify_tolerance_ = level.simplify_tolerance;
+            renderer.merge_shared_segments_ = level.merge_shared_segments;
+            renderer.min_stop_distance_ = level.min_stop_distance;
+            const size_t allocations_before = bench::GetAllocationCounters().count;
+            size = renderer.RenderCatalogueMap(catalogue)->size();
+            allocation_count = bench::GetAllocationCounters().count - allocations_before;
+        });
+        std::cout << level.name << ": " << ms << " ms, " << size << " bytes, " << allocation_count << " allocations\n";
+    }
+
+}  // namespace
+
+int main() {
+    // 19881 stops and 5000 buses of 30 stops
+    const bench::Feed feed = bench::MakeCityFeed(42, 141, 5000, 30);
+    transport_catalogue::TransportCatalogue catalogue;
+    bench::FillCatalogue(feed, catalogue);
+
+    for (const DetailLevel& level : {
+        DetailLevel{ "full detail", 0, false, 0 },
+        DetailLevel{ "merged segments", 0, true, 0 },
+        DetailLevel{ "merged, simplified by 2 px, stops 20 px apart", 2, true, 20 },
+        DetailLevel{ "merged, simplified by 5 px, stops 40 px apart", 5, true, 40 } }) {
+        MeasureMap(catalogue, level);
+    }
+
+    renderer::MapRenderer renderer;
+    SetUpRenderer(renderer);
+    // the first area builds the layout and its index, later ones reuse them
+    const double index_ms = bench::MeasureBest(1, [&] {
+        renderer.RenderCatalogueMapArea(catalogue, { 0, 0, 0, 0 });
+    });
+    std::cout << "layout and index: " << index_ms << " ms\n";
+    std::mt19937 generator(43);
+    for (const int zoom : { 2, 4, 6 }) {
+        constexpr int TILE_COUNT = 64;
+        size_t size = 0;
+        const double ms = bench::MeasureBest(1, [&] {
+            for (int i = 0; i < TILE_COUNT; ++i) {
+                const int side = 1 << zoom;
+                const int x = static_cast<int>(generator() % side);
+                const int y = static_cast<int>(generator() % side);
+                size += renderer.RenderCatalogueMapArea(catalogue, renderer.GetTileViewport(zoom, x, y)).size();
+            }
+        });
+        std::cout << "tiles of zoom " << zoom << ": " << ms / TILE_COUNT << " ms, " << size / TILE_COUNT << " bytes per tile\n";
+    }
+}
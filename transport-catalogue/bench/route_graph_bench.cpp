@@ -0,0 +1,56 @@
+#include "../transport_router.h"
+#include "bench.h"
+
+#include <iostream>
+#include <random>
+
+// The size of the routing graph and the time to build it, with and without a contraction hierarchy,
+// and the time of Route queries on generated cities
+
+int main() {
+    struct Case {
+        size_t grid_side;
+        size_t bus_count;
+    };
+    for (const Case& city : { Case{ 25, 100 }, Case{ 45, 400 } }) {
+        const bench::Feed feed = bench::MakeCityFeed(3, city.grid_side, city.bus_count, 30);
+        TransportCatalogue catalogue;
+        bench::FillCatalogue(feed, catalogue);
+
+        transport_router::TranspRouteParams params;
+        params.bus_wait_time = 6;
+        params.bus_velocity = 40;
+        size_t vertex_count = 0;
+        size_t edge_count = 0;
+        const double graph_ms = bench::MeasureBest(3, [&] {
+            const transport_router::TransportRouter router(catalogue, params);
+            vertex_count = router.GetGraph().GetVertexCount();
+            edge_count = router.GetGraph().GetEdgeCount();
+        });
+
+        params.algorithm = graph::RouterAlgorithm::CONTRACTION_HIERARCHY;
+        const double hierarchy_ms = bench::MeasureBest(1, [&] {
+            const transport_router::TransportRouter router(catalogue, params);
+        });
+
+        params.algorithm = graph::RouterAlgorithm::DIJKSTRA;
+        const transport_router::TransportRouter router(catalogue, params);
+        std::mt19937 generator(4);
+        constexpr int QUERY_COUNT = 1000;
+        double total_time = 0;
+        const double query_ms = bench::MeasureBest(1, [&] {
+            for (int i = 0; i < QUERY_COUNT; ++i) {
+                // drawn one by one, the order of evaluating arguments is unspecified
+                const size_t from = generator() % feed.stops.size();
+                const size_t to = generator() % feed.stops.size();
+                const auto route = router.MakeRoute(feed.stops[from].name, feed.stops[to].name);
+                total_time += route ? route->total_time : 0;
+            }
+        });
+
+        std::cout << feed.stops.size() << " stops, " << feed.buses.size() << " buses: "
+            << vertex_count << " vertices, " << edge_count << " edges, graph " << graph_ms << " ms, "
+            << "with contraction hierarchy " << hierarchy_ms << " ms, "
+            << query_ms * 1000 / QUERY_COUNT << " us per Dijkstra route (" << total_time << ")\n";
+    }
+}
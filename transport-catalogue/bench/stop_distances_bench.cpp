@@ -0,0 +1,52 @@
+#include "../transport_catalogue.h"
+#include "allocations.h"
+#include "bench.h"
+
+#include <iostream>
+#include <utility>
+
+// Road distances between random pairs of many stops: the time and memory to set them and the time of lookups,
+// a third of them in the direction set, a third in the reverse one and a third for pairs with no distance
+
+int main() {
+    constexpr uint32_t STOP_COUNT = 200000;
+    constexpr size_t PAIR_COUNT = 1000000;
+    constexpr size_t LOOKUP_COUNT = 10000000;
+    std::mt19937 generator(7);
+
+    transport_catalogue::TransportCatalogue catalogue;
+    std::vector<std::string> names;
+    for (uint32_t stop = 0; stop < STOP_COUNT; ++stop) {
+        names.push_back("Stop " + std::to_string(stop));
+        catalogue.AddStop(names.back(), { 55.6, 37.5 });
+    }
+    std::vector<std::pair<uint32_t, uint32_t>> pairs(PAIR_COUNT);
+    for (auto& [from, to] : pairs) {
+        from = generator() % STOP_COUNT;
+        to = generator() % STOP_COUNT;
+    }
+
+    const size_t bytes_before = bench::GetAllocationCounters().bytes_in_use;
+    const double set_ms = bench::MeasureBest(1, [&] {
+        for (const auto& [from, to] : pairs) {
+            catalogue.SetStopDistances(names[from], names[to], static_cast<int>(from % 1000) + 1);
+        }
+    });
+    const size_t bytes = bench::GetAllocationCounters().bytes_in_use - bytes_before;
+
+    // stops are numbered in the order they are added
+    std::vector<std::pair<uint32_t, uint32_t>> lookups(LOOKUP_COUNT);
+    for (size_t i = 0; i < LOOKUP_COUNT; ++i) {
+        const auto [from, to] = pairs[generator() % PAIR_COUNT];
+        lookups[i] = i % 3 == 0 ? std::pair{ from, to } : i % 3 == 1 ? std::pair{ to, from } : std::pair{ from, (to + 1) % STOP_COUNT };
+    }
+    long long sum = 0;
+    const double lookup_ms = bench::MeasureBest(3, [&] {
+        for (const auto& [from, to] : lookups) {
+            sum += catalogue.GetStopsDistance(from, to);
+        }
+    });
+
+    std::cout << PAIR_COUNT << " SetStopDistances: " << set_ms << " ms, " << bytes / 1e6 << " MB; "
+        << LOOKUP_COUNT << " GetStopsDistance: " << lookup_ms << " ms (" << sum << ")\n";
+}
@@ -0,0 +1,46 @@
+#include "../svg.h"
+#include "allocations.h"
+#include "bench.h"
+
+#include <iostream>
+
+// Time and allocations of writing one svg::Text, plain and with characters to escape
+
+int main() {
+    struct Case {
+        const char* name;
+        std::string data;
+    };
+    std::string quotes;
+    std::string ampersands;
+    for (int i = 0; i < 1024; ++i) {
+        quotes += "ab\"'";
+        ampersands += "a&<>";
+    }
+    const Case cases[] = {
+        { "plain 24 B", "Ulitsa Lizy Chaikinoi 12" },
+        { "plain 4 KB", std::string(4096, 'x') },
+        { "quotes 4 KB", quotes },
+        { "ampersands and brackets 4 KB", ampersands },
+    };
+
+    for (const Case& text_case : cases) {
+        svg::Text text;
+        text.SetData(text_case.data);
+        std::string out;
+        out.reserve(1 << 20);
+        const int repeat_count = text_case.data.size() > 100 ? 20000 : 1000000;
+        size_t allocation_count = 0;
+        const double ms = bench::MeasureBest(3, [&] {
+            const size_t allocations_before = bench::GetAllocationCounters().count;
+            for (int i = 0; i < repeat_count; ++i) {
+                out.clear();
+                svg::DocumentWriter writer(out);
+                writer.Add(text);
+            }
+            allocation_count = bench::GetAllocationCounters().count - allocations_before;
+        });
+        std::cout << text_case.name << ": " << ms * 1000000 / repeat_count << " ns, "
+            << static_cast<double>(allocation_count) / repeat_count << " allocations per text\n";
+    }
+}
@@ -0,0 +1,556 @@
+#pragma once
+
+#include "graph.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <optional>
+#include <queue>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+    // Contraction hierarchy over DirectedWeightedGraph.
+    // Vertices are contracted one by one, least important first. When a vertex is contracted,
+    // shortcut edges are added between its neighbours wherever it lay on the only shortest path
+    // between them. Every shortcut remembers the two edges it replaces, so a route found in the
+    // hierarchy is unpacked back into the edges of the original graph.
+    // Searches keep their labels in flat per-vertex arrays, reset through the list of touched vertices;
+    // a query thread reuses its arrays from one query to the next
+    template <typename Weight>
+    class ContractionHierarchy {
+    private:
+        using Graph = DirectedWeightedGraph<Weight>;
+
+    public:
+        static constexpr EdgeId NO_EDGE = std::numeric_limits<EdgeId>::max();
+
+        struct HierarchyEdge {
+            VertexId from;
+            VertexId to;
+            Weight weight;
+            // edges replaced by a shortcut, NO_EDGE for edges of the original graph
+            EdgeId first = NO_EDGE;
+            EdgeId second = NO_EDGE;
+        };
+
+        // Everything a query needs. Edges of the original graph come first and keep their ids.
+        // The CSR arrays may refer to a mapped snapshot instead of owning their memory
+        struct SearchIndex {
+            ArrayStorage<HierarchyEdge> edges;
+            // edges leading from a vertex to higher ranked ones
+            ArrayStorage<EdgeId> upward_offsets;
+            ArrayStorage<EdgeId> upward_edges;
+            // edges leading into a vertex from higher ranked ones
+            ArrayStorage<EdgeId> downward_offsets;
+            ArrayStorage<EdgeId> downward_edges;
+        };
+
+        // the initial priorities of the vertices are computed on thread_count threads, 0 for one per hardware thread
+        explicit ContractionHierarchy(const Graph& graph, size_t thread_count = 1);
+        explicit ContractionHierarchy(SearchIndex index);
+
+        struct Route {
+            Weight weight;
+            std::vector<EdgeId> edges;
+        };
+
+        std::optional<Route> BuildRoute(VertexId from, VertexId to) const;
+
+        const SearchIndex& GetSearchIndex() const;
+
+    private:
+        // witness search gives up after settling this many vertices and keeps the shortcut
+        static constexpr size_t WITNESS_SETTLE_LIMIT = 64;
+        static constexpr Weight ZERO_WEIGHT{};
+        static constexpr size_t NO_ARC = std::numeric_limits<size_t>::max();
+
+        struct Shortcut {
+            VertexId from;
+            VertexId to;
+            Weight weight;
+            EdgeId in_edge;
+            EdgeId out_edge;
+        };
+
+        struct Label {
+            Weight weight;
+            EdgeId prev_edge;
+        };
+        // a binary heap kept with std::push_heap and std::pop_heap, so that its memory is reused
+        using QueueItem = std::pair<Weight, VertexId>;
+        using QueueOrder = std::greater<QueueItem>;
+
+        // labels of one direction of a query, nullopt for vertices not reached yet
+        struct SearchSpace {
+            std::vector<std::optional<Label>> labels;
+            std::vector<VertexId> touched;
+            std::vector<QueueItem> queue;
+
+            void Reset(size_t vertex_count);
+            void Push(VertexId vertex, Label label);
+        };
+
+        // storage of the searches of one contracting thread, reused between searches
+        struct WitnessStorage {
+            std::vector<std::optional<Weight>> weights;
+            std::vector<VertexId> touched;
+            std::vector<bool> targets;
+            std::vector<QueueItem> queue;
+            // where the lightest arc to every neighbour of the vertex being contracted lies among its arcs,
+            // NO_ARC for the other vertices
+            std::vector<size_t> lightest_arcs;
+
+            explicit WitnessStorage(size_t vertex_count);
+        };
+
+        // an edge in the adjacency of one of its ends, with the other end and the weight at hand,
+        // so that searches do not have to look the edge up
+        struct Arc {
+            EdgeId edge_id;
+            VertexId neighbour;
+            Weight weight;
+        };
+
+        // adjacency of the graph being contracted, without edges of contracted vertices
+        struct ContractionState {
+            std::vector<HierarchyEdge> edges;
+            std::vector<size_t> rank;
+            std::vector<std::vector<Arc>> out_edges;
+            std::vector<std::vector<Arc>> in_edges;
+            std::vector<int> contracted_neighbours;
+            WitnessStorage witness;
+        };
+
+        static void Contract(ContractionState& state, size_t thread_count);
+        static std::vector<Shortcut> FindShortcuts(VertexId vertex, const ContractionState& state,
+            WitnessStorage& witness);
+        static void RunWitnessSearch(VertexId source, VertexId excluded, Weight max_weight, size_t target_count,
+            const ContractionState& state, WitnessStorage& witness);
+        static int ComputePriority(VertexId vertex, size_t shortcut_count, const ContractionState& state);
+        static SearchIndex BuildSearchIndex(ContractionState& state);
+
+        void UnpackEdge(EdgeId edge_id, std::vector<EdgeId>& edges) const;
+
+        SearchIndex index_;
+    };
+
+    template <typename Weight>
+    ContractionHierarchy<Weight>::ContractionHierarchy(const Graph& graph, size_t thread_count) {
+        const size_t vertex_count = graph.GetVertexCount();
+        ContractionState state{
+            {},
+            std::vector<size_t>(vertex_count, 0),
+            std::vector<std::vector<Arc>>(vertex_count),
+            std::vector<std::vector<Arc>>(vertex_count),
+            std::vector<int>(vertex_count, 0),
+            WitnessStorage(vertex_count)
+        };
+
+        state.edges.reserve(graph.GetEdgeCount());
+        for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+            const auto& edge = graph.GetEdge(edge_id);
+            state.edges.push_back({ edge.from, edge.to, edge.weight });
+            // loops never lie on a shortest route
+            if (edge.from != edge.to) {
+                state.out_edges[edge.from].push_back({ edge_id, edge.to, edge.weight });
+                state.in_edges[edge.to].push_back({ edge_id, edge.from, edge.weight });
+            }
+        }
+
+        Contract(state, thread_count);
+        index_ = BuildSearchIndex(state);
+    }
+
+    template <typename Weight>
+    ContractionHierarchy<Weight>::ContractionHierarchy(SearchIndex index)
+        : index_(std::move(index))
+    {
+        if (index_.upward_offsets.size() != index_.downward_offsets.size()
+            || index_.upward_offsets.empty()
+            || index_.upward_offsets.back() != index_.upward_edges.size()
+            || index_.downward_offsets.back() != index_.downward_edges.size()) {
+            throw std::invalid_argument("Inconsistent contraction hierarchy index");
+        }
+    }
+
+    template <typename Weight>
+    const typename ContractionHierarchy<Weight>::SearchIndex& ContractionHierarchy<Weight>::GetSearchIndex() const {
+        return index_;
+    }
+
+    template <typename Weight>
+    ContractionHierarchy<Weight>::WitnessStorage::WitnessStorage(size_t vertex_count)
+        : weights(vertex_count)
+        , targets(vertex_count, false)
+        , lightest_arcs(vertex_count, NO_ARC)
+    {
+    }
+
+    template <typename Weight>
+    void ContractionHierarchy<Weight>::RunWitnessSearch(VertexId source, VertexId excluded, Weight max_weight,
+        size_t target_count, const ContractionState& state, WitnessStorage& witness) {
+        for (const VertexId vertex : witness.touched) {
+            witness.weights[vertex].reset();
+        }
+        witness.touched.clear();
+
+        auto& queue = witness.queue;
+        queue.clear();
+        witness.weights[source] = ZERO_WEIGHT;
+        witness.touched.push_back(source);
+        queue.emplace_back(ZERO_WEIGHT, source);
+        size_t settled_count = 0;
+        while (!queue.empty() && settled_count < WITNESS_SETTLE_LIMIT && target_count > 0) {
+            std::pop_heap(queue.begin(), queue.end(), QueueOrder{});
+            const auto [weight, vertex] = queue.back();
+            queue.pop_back();
+            if (weight > *witness.weights[vertex]) {
+                continue;
+            }
+            if (weight > max_weight) {
+                break;
+            }
+            ++settled_count;
+            if (witness.targets[vertex]) {
+                --target_count;
+            }
+            for (const Arc& arc : state.out_edges[vertex]) {
+                if (arc.neighbour == excluded) {
+                    continue;
+                }
+                const Weight candidate_weight = weight + arc.weight;
+                // too heavy to be a witness: such vertices would only be popped after the search stops
+                if (candidate_weight > max_weight) {
+                    continue;
+                }
+                auto& witness_weight = witness.weights[arc.neighbour];
+                if (!witness_weight) {
+                    witness.touched.push_back(arc.neighbour);
+                }
+                if (!witness_weight || candidate_weight < *witness_weight) {
+                    witness_weight = candidate_weight;
+                    queue.emplace_back(candidate_weight, arc.neighbour);
+                    std::push_heap(queue.begin(), queue.end(), QueueOrder{});
+                }
+            }
+        }
+    }
+
+    template <typename Weight>
+    std::vector<typename ContractionHierarchy<Weight>::Shortcut> ContractionHierarchy<Weight>::FindShortcuts(
+        VertexId vertex, const ContractionState& state, WitnessStorage& witness) {
+        // keep only the lightest arc to every neighbour, in the order the neighbours first appear
+        auto lightest_arcs = [&witness](const std::vector<Arc>& arcs) {
+            std::vector<Arc> result;
+            for (const Arc& arc : arcs) {
+                size_t& position = witness.lightest_arcs[arc.neighbour];
+                if (position == NO_ARC) {
+                    position = result.size();
+                    result.push_back(arc);
+                }
+                else if (arc.weight < result[position].weight) {
+                    result[position] = arc;
+                }
+            }
+            for (const Arc& arc : result) {
+                witness.lightest_arcs[arc.neighbour] = NO_ARC;
+            }
+            return result;
+        };
+        const auto in_arcs = lightest_arcs(state.in_edges[vertex]);
+        const auto out_arcs = lightest_arcs(state.out_edges[vertex]);
+
+        std::vector<Shortcut> shortcuts;
+        for (const Arc& in_arc : in_arcs) {
+            Weight max_weight = ZERO_WEIGHT;
+            size_t target_count = 0;
+            for (const Arc& out_arc : out_arcs) {
+                if (out_arc.neighbour != in_arc.neighbour) {
+                    max_weight = std::max(max_weight, in_arc.weight + out_arc.weight);
+                    witness.targets[out_arc.neighbour] = true;
+                    ++target_count;
+                }
+            }
+            if (target_count == 0) {
+                continue;
+            }
+
+            RunWitnessSearch(in_arc.neighbour, vertex, max_weight, target_count, state, witness);
+            for (const Arc& out_arc : out_arcs) {
+                witness.targets[out_arc.neighbour] = false;
+            }
+            for (const Arc& out_arc : out_arcs) {
+                if (out_arc.neighbour == in_arc.neighbour) {
+                    continue;
+                }
+                const Weight via_weight = in_arc.weight + out_arc.weight;
+                const auto& witness_weight = witness.weights[out_arc.neighbour];
+                if (!witness_weight || via_weight < *witness_weight) {
+                    shortcuts.push_back({ in_arc.neighbour, out_arc.neighbour, via_weight, in_arc.edge_id, out_arc.edge_id });
+                }
+            }
+        }
+        return shortcuts;
+    }
+
+    template <typename Weight>
+    int ContractionHierarchy<Weight>::ComputePriority(VertexId vertex, size_t shortcut_count,
+        const ContractionState& state) {
+        // the arcs of contracted vertices are detached, so all the arcs left are removed with the vertex
+        const int removed_count = static_cast<int>(state.in_edges[vertex].size() + state.out_edges[vertex].size());
+        // edge difference plus the number of contracted neighbours to keep the hierarchy uniform
+        return static_cast<int>(shortcut_count) - removed_count + state.contracted_neighbours[vertex];
+    }
+
+    template <typename Weight>
+    void ContractionHierarchy<Weight>::Contract(ContractionState& state, size_t thread_count) {
+        auto& edges = state.edges;
+        const size_t vertex_count = state.rank.size();
+
+        // the initial priorities only read the state, so blocks of vertices are handled in parallel,
+        // each block with its own witness storage
+        std::vector<std::pair<int, VertexId>> priorities(vertex_count);
+        const auto compute_priorities = [&state, &priorities](VertexId first, VertexId last, WitnessStorage& witness) {
+            for (VertexId vertex = first; vertex < last; ++vertex) {
+                priorities[vertex] = { ComputePriority(vertex, FindShortcuts(vertex, state, witness).size(), state), vertex };
+            }
+        };
+        if (thread_count == 1 || vertex_count == 0) {
+            compute_priorities(0, static_cast<VertexId>(vertex_count), state.witness);
+        }
+        else {
+            thread_pool::ThreadPool pool(thread_count);
+            // a few blocks per thread even out the vertices of different degree
+            const size_t block_count = std::min(vertex_count, pool.GetThreadCount() * 4);
+            thread_pool::ParallelFor(pool, block_count, [&](size_t block) {
+                WitnessStorage witness(vertex_count);
+                compute_priorities(static_cast<VertexId>(vertex_count * block / block_count),
+                    static_cast<VertexId>(vertex_count * (block + 1) / block_count), witness);
+            });
+        }
+        std::priority_queue<std::pair<int, VertexId>, std::vector<std::pair<int, VertexId>>,
+            std::greater<std::pair<int, VertexId>>> queue(std::greater<std::pair<int, VertexId>>{}, std::move(priorities));
+
+        size_t next_rank = 0;
+        while (!queue.empty()) {
+            const VertexId vertex = queue.top().second;
+            queue.pop();
+
+            // priorities are updated lazily: postpone the vertex if it is no longer the least important
+            std::vector<Shortcut> shortcuts = FindShortcuts(vertex, state, state.witness);
+            const int priority = ComputePriority(vertex, shortcuts.size(), state);
+            if (!queue.empty() && priority > queue.top().first) {
+                queue.emplace(priority, vertex);
+                continue;
+            }
+
+            for (const Shortcut& shortcut : shortcuts) {
+                const EdgeId edge_id = static_cast<EdgeId>(edges.size());
+                edges.push_back({ shortcut.from, shortcut.to, shortcut.weight, shortcut.in_edge, shortcut.out_edge });
+                state.out_edges[shortcut.from].push_back({ edge_id, shortcut.to, shortcut.weight });
+                state.in_edges[shortcut.to].push_back({ edge_id, shortcut.from, shortcut.weight });
+            }
+            state.rank[vertex] = next_rank++;
+
+            // detach the vertex so that witness searches no longer walk its edges
+            auto is_vertex = [vertex](const Arc& arc) { return arc.neighbour == vertex; };
+            for (const Arc& in_arc : state.in_edges[vertex]) {
+                auto& neighbour_arcs = state.out_edges[in_arc.neighbour];
+                neighbour_arcs.erase(std::remove_if(neighbour_arcs.begin(), neighbour_arcs.end(), is_vertex),
+                    neighbour_arcs.end());
+                ++state.contracted_neighbours[in_arc.neighbour];
+            }
+            for (const Arc& out_arc : state.out_edges[vertex]) {
+                auto& neighbour_arcs = state.in_edges[out_arc.neighbour];
+                neighbour_arcs.erase(std::remove_if(neighbour_arcs.begin(), neighbour_arcs.end(), is_vertex),
+                    neighbour_arcs.end());
+                ++state.contracted_neighbours[out_arc.neighbour];
+            }
+            state.in_edges[vertex].clear();
+            state.out_edges[vertex].clear();
+        }
+    }
+
+    template <typename Weight>
+    typename ContractionHierarchy<Weight>::SearchIndex ContractionHierarchy<Weight>::BuildSearchIndex(
+        ContractionState& state) {
+        const auto& edges = state.edges;
+        const auto& rank = state.rank;
+        const size_t vertex_count = rank.size();
+        std::vector<EdgeId> upward_offsets(vertex_count + 1, 0);
+        std::vector<EdgeId> downward_offsets(vertex_count + 1, 0);
+        for (const auto& edge : edges) {
+            if (rank[edge.from] < rank[edge.to]) {
+                ++upward_offsets[edge.from + 1];
+            }
+            else if (rank[edge.from] > rank[edge.to]) {
+                ++downward_offsets[edge.to + 1];
+            }
+        }
+        for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+            upward_offsets[vertex + 1] += upward_offsets[vertex];
+            downward_offsets[vertex + 1] += downward_offsets[vertex];
+        }
+
+        std::vector<EdgeId> upward_edges(upward_offsets.back());
+        std::vector<EdgeId> downward_edges(downward_offsets.back());
+        std::vector<EdgeId> upward_positions(upward_offsets.begin(), upward_offsets.end() - 1);
+        std::vector<EdgeId> downward_positions(downward_offsets.begin(), downward_offsets.end() - 1);
+        for (EdgeId edge_id = 0; edge_id < edges.size(); ++edge_id) {
+            const auto& edge = edges[edge_id];
+            if (rank[edge.from] < rank[edge.to]) {
+                upward_edges[upward_positions[edge.from]++] = edge_id;
+            }
+            else if (rank[edge.from] > rank[edge.to]) {
+                downward_edges[downward_positions[edge.to]++] = edge_id;
+            }
+        }
+
+        return SearchIndex{
+            ArrayStorage<HierarchyEdge>(std::move(state.edges)),
+            ArrayStorage<EdgeId>(std::move(upward_offsets)),
+            ArrayStorage<EdgeId>(std::move(upward_edges)),
+            ArrayStorage<EdgeId>(std::move(downward_offsets)),
+            ArrayStorage<EdgeId>(std::move(downward_edges))
+        };
+    }
+
+    template <typename Weight>
+    void ContractionHierarchy<Weight>::UnpackEdge(EdgeId edge_id, std::vector<EdgeId>& edges) const {
+        std::vector<EdgeId> stack{ edge_id };
+        while (!stack.empty()) {
+            const EdgeId current = stack.back();
+            stack.pop_back();
+            const auto& edge = index_.edges[current];
+            if (edge.first == NO_EDGE) {
+                edges.push_back(current);
+            }
+            else {
+                stack.push_back(edge.second);
+                stack.push_back(edge.first);
+            }
+        }
+    }
+
+    template <typename Weight>
+    void ContractionHierarchy<Weight>::SearchSpace::Reset(size_t vertex_count) {
+        for (const VertexId vertex : touched) {
+            labels[vertex].reset();
+        }
+        touched.clear();
+        queue.clear();
+        // the arrays of the thread may have served a smaller hierarchy before
+        if (labels.size() < vertex_count) {
+            labels.resize(vertex_count);
+        }
+    }
+
+    template <typename Weight>
+    void ContractionHierarchy<Weight>::SearchSpace::Push(VertexId vertex, Label label) {
+        if (!labels[vertex]) {
+            touched.push_back(vertex);
+        }
+        labels[vertex] = label;
+        queue.emplace_back(label.weight, vertex);
+        std::push_heap(queue.begin(), queue.end(), QueueOrder{});
+    }
+
+    template <typename Weight>
+    std::optional<typename ContractionHierarchy<Weight>::Route> ContractionHierarchy<Weight>::BuildRoute(
+        VertexId from, VertexId to) const {
+        if (from == to) {
+            return Route{ ZERO_WEIGHT, {} };
+        }
+
+        // forward search climbs up from the source, backward search climbs up from the target
+        static thread_local SearchSpace forward_space;
+        static thread_local SearchSpace backward_space;
+        const size_t vertex_count = index_.upward_offsets.size() - 1;
+        forward_space.Reset(vertex_count);
+        backward_space.Reset(vertex_count);
+        forward_space.Push(from, Label{ ZERO_WEIGHT, NO_EDGE });
+        backward_space.Push(to, Label{ ZERO_WEIGHT, NO_EDGE });
+
+        std::optional<Weight> best_weight;
+        VertexId meeting_vertex = from;
+        while (!forward_space.queue.empty() || !backward_space.queue.empty()) {
+            const bool is_forward = backward_space.queue.empty()
+                || (!forward_space.queue.empty() && forward_space.queue.front().first <= backward_space.queue.front().first);
+            SearchSpace& space = is_forward ? forward_space : backward_space;
+            const SearchSpace& opposite_space = is_forward ? backward_space : forward_space;
+            auto& queue = space.queue;
+            const auto& labels = space.labels;
+
+            const auto [weight, vertex] = queue.front();
+            if (best_weight && !(weight < *best_weight)) {
+                break;
+            }
+            std::pop_heap(queue.begin(), queue.end(), QueueOrder{});
+            queue.pop_back();
+            if (labels[vertex]->weight < weight) {
+                continue;
+            }
+
+            if (const auto& opposite_label = opposite_space.labels[vertex]) {
+                const Weight candidate_weight = weight + opposite_label->weight;
+                if (!best_weight || candidate_weight < *best_weight) {
+                    best_weight = candidate_weight;
+                    meeting_vertex = vertex;
+                }
+            }
+
+            // stall-on-demand: a higher vertex reaches this one cheaper, so it is not on a shortest route
+            const auto& stall_offsets = is_forward ? index_.downward_offsets : index_.upward_offsets;
+            const auto& stall_edge_ids = is_forward ? index_.downward_edges : index_.upward_edges;
+            bool is_stalled = false;
+            for (size_t i = stall_offsets[vertex]; i < stall_offsets[vertex + 1] && !is_stalled; ++i) {
+                const auto& edge = index_.edges[stall_edge_ids[i]];
+                const auto& label = labels[is_forward ? edge.from : edge.to];
+                is_stalled = label && label->weight + edge.weight < weight;
+            }
+            if (is_stalled) {
+                continue;
+            }
+
+            const auto& offsets = is_forward ? index_.upward_offsets : index_.downward_offsets;
+            const auto& edge_ids = is_forward ? index_.upward_edges : index_.downward_edges;
+            for (size_t i = offsets[vertex]; i < offsets[vertex + 1]; ++i) {
+                const auto& edge = index_.edges[edge_ids[i]];
+                const VertexId next_vertex = is_forward ? edge.to : edge.from;
+                const Weight candidate_weight = weight + edge.weight;
+                const auto& label = labels[next_vertex];
+                if (!label || candidate_weight < label->weight) {
+                    space.Push(next_vertex, Label{ candidate_weight, edge_ids[i] });
+                }
+            }
+        }
+
+        if (!best_weight) {
+            return std::nullopt;
+        }
+
+        std::vector<EdgeId> forward_edges;
+        for (VertexId vertex = meeting_vertex; vertex != from;) {
+            const EdgeId edge_id = forward_space.labels[vertex]->prev_edge;
+            forward_edges.push_back(edge_id);
+            vertex = index_.edges[edge_id].from;
+        }
+        std::vector<EdgeId> edges;
+        for (auto it = forward_edges.rbegin(); it != forward_edges.rend(); ++it) {
+            UnpackEdge(*it, edges);
+        }
+        for (VertexId vertex = meeting_vertex; vertex != to;) {
+            const EdgeId edge_id = backward_space.labels[vertex]->prev_edge;
+            UnpackEdge(edge_id, edges);
+            vertex = index_.edges[edge_id].to;
+        }
+
+        return Route{ *best_weight, std::move(edges) };
+    }
+
+}  // namespace graph
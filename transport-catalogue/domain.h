@@ -1,23 +1,29 @@
 #pragma once
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include "geo.h"
 
-struct DistanceToStop {
-	std::string stop_name;
-	int distance;
-};
+using StopId = uint32_t;
+using BusId = uint32_t;
 
 struct Stop {
-	std::string name;
+	// название хранится в пуле строк справочника
+	std::string_view name;
 	geo::Coordinates coordinates;
+	// порядковый номер в справочнике
+	StopId id = 0;
 };
 
 struct Bus {
-	std::string name;
-	std::vector<Stop*> route;
-	bool is_roundtrip;
+	std::string_view name;
+	BusId id = 0;
+	// остановки маршрута лежат в общем массиве справочника, см. TransportCatalogue::GetRoute
+	uint32_t route_offset = 0;
+	uint32_t route_size = 0;
+	bool is_roundtrip = false;
 };
 
 struct BusSetCmp {
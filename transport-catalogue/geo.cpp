@@ -5,12 +5,64 @@
 
 using namespace geo;
 
+namespace {
+    const double DR = M_PI / 180.0;
+    const double EARTH_RADIUS = 6371000;
+
+    // spherical law of cosines; ComputeDistance and PointBatch share it, so their results match bit for bit
+    double ComputeCosineLaw(double sin_from_lat, double sin_to_lat, double cos_from_lat, double cos_to_lat, double from_lng, double to_lng) {
+        return std::acos(sin_from_lat * sin_to_lat + cos_from_lat * cos_to_lat * std::cos(std::abs(from_lng - to_lng) * DR))
+            * EARTH_RADIUS;
+    }
+
+    double ComputeHaversine(double from_lat, double to_lat, double cos_from_lat, double cos_to_lat, double delta_lng) {
+        const double sin_half_lat = std::sin((to_lat - from_lat) / 2);
+        const double sin_half_lng = std::sin(delta_lng / 2);
+        const double h = sin_half_lat * sin_half_lat + cos_from_lat * cos_to_lat * sin_half_lng * sin_half_lng;
+        // h can leave [0, 1] by a rounding error for antipodal points
+        return 2 * std::asin(std::sqrt(std::fmin(h, 1.0))) * EARTH_RADIUS;
+    }
+}
+
 double geo::ComputeDistance(Coordinates from, Coordinates to) {
-    using namespace std;
-    const double dr = M_PI / 180.0;
-    return acos(sin(from.lat * dr) * sin(to.lat * dr)
-        + cos(from.lat * dr) * cos(to.lat * dr) * cos(abs(from.lng - to.lng) * dr))
-        * 6371000;
+    return ComputeCosineLaw(std::sin(from.lat * DR), std::sin(to.lat * DR), std::cos(from.lat * DR), std::cos(to.lat * DR), from.lng, to.lng);
+}
+
+double geo::ComputeHaversineDistance(Coordinates from, Coordinates to) {
+    return ComputeHaversine(from.lat * DR, to.lat * DR, std::cos(from.lat * DR), std::cos(to.lat * DR), (to.lng - from.lng) * DR);
+}
+
+void PointBatch::Reserve(size_t size) {
+    lat_.reserve(size);
+    lng_.reserve(size);
+    sin_lat_.reserve(size);
+    cos_lat_.reserve(size);
+}
+
+uint32_t PointBatch::Add(Coordinates point) {
+    lat_.push_back(point.lat * DR);
+    // longitudes stay in degrees: ComputeDistance converts their difference, not each of them
+    lng_.push_back(point.lng);
+    sin_lat_.push_back(std::sin(point.lat * DR));
+    cos_lat_.push_back(std::cos(point.lat * DR));
+    return static_cast<uint32_t>(lng_.size() - 1);
+}
+
+void PointBatch::ComputeDistances(const uint32_t* route, size_t route_size, double* distances) const {
+    // only the cosine of the longitude difference and acos remain per segment
+    for (size_t i = 0; i + 1 < route_size; ++i) {
+        const uint32_t from = route[i];
+        const uint32_t to = route[i + 1];
+        distances[i] = ComputeCosineLaw(sin_lat_[from], sin_lat_[to], cos_lat_[from], cos_lat_[to], lng_[from], lng_[to]);
+    }
+}
+
+void PointBatch::ComputeHaversineDistances(const uint32_t* route, size_t route_size, double* distances) const {
+    for (size_t i = 0; i + 1 < route_size; ++i) {
+        const uint32_t from = route[i];
+        const uint32_t to = route[i + 1];
+        distances[i] = ComputeHaversine(lat_[from], lat_[to], cos_lat_[from], cos_lat_[to], (lng_[to] - lng_[from]) * DR);
+    }
 }
 
- // namespace geo
\ No newline at end of file
+ // namespace geo
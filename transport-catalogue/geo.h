@@ -1,18 +1,47 @@
-#pragma once
-
-#include <cmath>
-
-namespace geo {
-    struct Coordinates {
-        double lat;
-        double lng;
-        bool operator==(const Coordinates& other) const {
-            return lat == other.lat && lng == other.lng;
-        }
-        bool operator!=(const Coordinates& other) const {
-            return !(*this == other);
-        }
-    };
-    double ComputeDistance(Coordinates from, Coordinates to);
-}
-
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace geo {
+    struct Coordinates {
+        double lat;
+        double lng;
+        bool operator==(const Coordinates& other) const {
+            return lat == other.lat && lng == other.lng;
+        }
+        bool operator!=(const Coordinates& other) const {
+            return !(*this == other);
+        }
+    };
+    double ComputeDistance(Coordinates from, Coordinates to);
+    // haversine formula: the same sphere, but it keeps its precision on short
+    // distances, where the acos of ComputeDistance loses about half the digits
+    double ComputeHaversineDistance(Coordinates from, Coordinates to);
+
+    // Points stored as separate arrays, with the latitude's radians, sine and cosine
+    // computed once per point instead of once per segment
+    class PointBatch {
+    public:
+        void Reserve(size_t size);
+        // returns the index of the point
+        uint32_t Add(Coordinates point);
+        size_t Size() const {
+            return lng_.size();
+        }
+
+        // distances[i] is the distance from points[route[i]] to points[route[i + 1]],
+        // so distances has route_size - 1 elements. The values are bit for bit those of ComputeDistance
+        void ComputeDistances(const uint32_t* route, size_t route_size, double* distances) const;
+        // the same with the values of ComputeHaversineDistance
+        void ComputeHaversineDistances(const uint32_t* route, size_t route_size, double* distances) const;
+
+    private:
+        std::vector<double> lat_;
+        std::vector<double> lng_;
+        std::vector<double> sin_lat_;
+        std::vector<double> cos_lat_;
+    };
+}
@@ -2,66 +2,190 @@
 
 #include "ranges.h"
 
+#include <cstdint>
 #include <cstdlib>
+#include <stdexcept>
+#include <utility>
 #include <vector>
 
 namespace graph {
 
-    using VertexId = size_t;
-    using EdgeId = size_t;
+    using VertexId = uint32_t;
+    using EdgeId = uint32_t;
 
     enum EdgeType {
         WAIT,
-        BUS
+        BUS,
+        BOARD,
+        ALIGHT
+    };
+
+    // Contiguous array that either owns its elements or refers to memory owned elsewhere,
+    // e.g. to a mapped snapshot file, which then has to outlive the array
+    template <typename T>
+    class ArrayStorage {
+    public:
+        ArrayStorage() = default;
+        explicit ArrayStorage(std::vector<T> elements)
+            : elements_(std::move(elements))
+            , data_(elements_.data())
+            , size_(elements_.size()) {
+        }
+        ArrayStorage(const T* data, size_t size)
+            : data_(data)
+            , size_(size)
+            , is_view_(true) {
+        }
+
+        ArrayStorage(const ArrayStorage& other)
+            : elements_(other.elements_)
+            , data_(other.is_view_ ? other.data_ : elements_.data())
+            , size_(other.size_)
+            , is_view_(other.is_view_) {
+        }
+        ArrayStorage(ArrayStorage&& other) noexcept {
+            *this = std::move(other);
+        }
+        ArrayStorage& operator=(const ArrayStorage& other) {
+            return *this = ArrayStorage(other);
+        }
+        ArrayStorage& operator=(ArrayStorage&& other) noexcept {
+            // moving a vector keeps its buffer, so the data pointer stays valid
+            elements_ = std::move(other.elements_);
+            data_ = other.is_view_ ? other.data_ : elements_.data();
+            size_ = other.size_;
+            is_view_ = other.is_view_;
+            return *this;
+        }
+
+        const T* data() const {
+            return data_;
+        }
+        size_t size() const {
+            return size_;
+        }
+        bool empty() const {
+            return size_ == 0;
+        }
+        const T* begin() const {
+            return data_;
+        }
+        const T* end() const {
+            return data_ + size_;
+        }
+        const T& back() const {
+            return data_[size_ - 1];
+        }
+        const T& operator[](size_t index) const {
+            return data_[index];
+        }
+        const T& at(size_t index) const {
+            if (index >= size_) {
+                throw std::out_of_range("Index is out of array");
+            }
+            return data_[index];
+        }
+
+    private:
+        std::vector<T> elements_;
+        const T* data_ = nullptr;
+        size_t size_ = 0;
+        bool is_view_ = false;
     };
 
     template <typename Weight>
     struct Edge {
+        static constexpr uint32_t TYPE_BITS = 2;
+        static constexpr uint32_t TYPE_MASK = (1u << TYPE_BITS) - 1;
+
+        Edge() = default;
+        Edge(VertexId from, VertexId to, Weight weight, EdgeType type, uint32_t entity_id, uint32_t span_count)
+            : from(from)
+            , to(to)
+            , weight(weight)
+            , entity_id(entity_id)
+            , type_and_span((span_count << TYPE_BITS) | static_cast<uint32_t>(type)) {
+        }
+
+        EdgeType GetType() const {
+            return static_cast<EdgeType>(type_and_span & TYPE_MASK);
+        }
+        uint32_t GetSpanCount() const {
+            return type_and_span >> TYPE_BITS;
+        }
+
         VertexId from;
         VertexId to;
         Weight weight;
-        EdgeType type;
-        std::string entity_name;
-        int64_t span_count;
+        // index of the stop or bus the edge belongs to, names are resolved by the graph owner
+        uint32_t entity_id;
+        // edge type in the lower TYPE_BITS, span count in the rest
+        uint32_t type_and_span;
     };
 
+    // Immutable graph in compressed sparse row form: edges are stored sorted by their source,
+    // so the incident edges of a vertex are a contiguous range of edge ids
     template <typename Weight>
     class DirectedWeightedGraph {
     private:
-        using IncidenceList = std::vector<EdgeId>;
-        using IncidentEdgesRange = ranges::Range<typename IncidenceList::const_iterator>;
+        using IncidentEdgesRange = ranges::Range<ranges::IdIterator<EdgeId>>;
 
     public:
         DirectedWeightedGraph() = default;
-        explicit DirectedWeightedGraph(size_t vertex_count);
-        EdgeId AddEdge(const Edge<Weight>& edge);
+        DirectedWeightedGraph(size_t vertex_count, const std::vector<Edge<Weight>>& edges);
+        // adopts arrays that are already in CSR form, e.g. the ones returned by GetEdges and GetIncidenceOffsets
+        DirectedWeightedGraph(ArrayStorage<Edge<Weight>> edges, ArrayStorage<EdgeId> incidence_offsets);
 
         size_t GetVertexCount() const;
         size_t GetEdgeCount() const;
         const Edge<Weight>& GetEdge(EdgeId edge_id) const;
         IncidentEdgesRange GetIncidentEdges(VertexId vertex) const;
 
+        const ArrayStorage<Edge<Weight>>& GetEdges() const;
+        const ArrayStorage<EdgeId>& GetIncidenceOffsets() const;
+
     private:
-        std::vector<Edge<Weight>> edges_;
-        std::vector<IncidenceList> incidence_lists_;
+        ArrayStorage<Edge<Weight>> edges_;
+        // incident edges of vertex v are [incidence_offsets_[v], incidence_offsets_[v + 1])
+        ArrayStorage<EdgeId> incidence_offsets_;
     };
 
     template <typename Weight>
-    DirectedWeightedGraph<Weight>::DirectedWeightedGraph(size_t vertex_count)
-        : incidence_lists_(vertex_count) {
+    DirectedWeightedGraph<Weight>::DirectedWeightedGraph(size_t vertex_count, const std::vector<Edge<Weight>>& edges) {
+        // counting sort by source vertex keeps the insertion order of edges of the same vertex
+        std::vector<EdgeId> incidence_offsets(vertex_count + 1, 0);
+        for (const auto& edge : edges) {
+            if (edge.from >= vertex_count || edge.to >= vertex_count) {
+                throw std::out_of_range("Edge vertex is out of graph");
+            }
+            ++incidence_offsets[edge.from + 1];
+        }
+        for (size_t vertex = 0; vertex < vertex_count; ++vertex) {
+            incidence_offsets[vertex + 1] += incidence_offsets[vertex];
+        }
+        std::vector<Edge<Weight>> sorted_edges(edges.size());
+        std::vector<EdgeId> positions(incidence_offsets.begin(), incidence_offsets.end() - 1);
+        for (const auto& edge : edges) {
+            sorted_edges[positions[edge.from]++] = edge;
+        }
+        edges_ = ArrayStorage<Edge<Weight>>(std::move(sorted_edges));
+        incidence_offsets_ = ArrayStorage<EdgeId>(std::move(incidence_offsets));
     }
 
     template <typename Weight>
-    EdgeId DirectedWeightedGraph<Weight>::AddEdge(const Edge<Weight>& edge) {
-        edges_.push_back(edge);
-        const EdgeId id = edges_.size() - 1;
-        incidence_lists_.at(edge.from).push_back(id);
-        return id;
+    DirectedWeightedGraph<Weight>::DirectedWeightedGraph(ArrayStorage<Edge<Weight>> edges,
+        ArrayStorage<EdgeId> incidence_offsets)
+        : edges_(std::move(edges))
+        , incidence_offsets_(std::move(incidence_offsets))
+    {
+        if (incidence_offsets_.empty() || incidence_offsets_.back() != edges_.size()) {
+            throw std::invalid_argument("Incidence offsets do not match edges");
+        }
     }
 
     template <typename Weight>
     size_t DirectedWeightedGraph<Weight>::GetVertexCount() const {
-        return incidence_lists_.size();
+        return incidence_offsets_.empty() ? 0 : incidence_offsets_.size() - 1;
     }
 
     template <typename Weight>
@@ -74,9 +198,22 @@ namespace graph {
         return edges_.at(edge_id);
     }
 
+    template <typename Weight>
+    const ArrayStorage<Edge<Weight>>& DirectedWeightedGraph<Weight>::GetEdges() const {
+        return edges_;
+    }
+
+    template <typename Weight>
+    const ArrayStorage<EdgeId>& DirectedWeightedGraph<Weight>::GetIncidenceOffsets() const {
+        return incidence_offsets_;
+    }
+
     template <typename Weight>
     typename DirectedWeightedGraph<Weight>::IncidentEdgesRange
         DirectedWeightedGraph<Weight>::GetIncidentEdges(VertexId vertex) const {
-        return ranges::AsRange(incidence_lists_.at(vertex));
+        if (vertex >= GetVertexCount()) {
+            throw std::out_of_range("Vertex is out of graph");
+        }
+        return ranges::AsIdRange(incidence_offsets_[vertex], incidence_offsets_[vertex + 1]);
     }
-}  // namespace graph
\ No newline at end of file
+}  // namespace graph
@@ -0,0 +1,222 @@
+#include "grid_index.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+using namespace renderer;
+
+namespace {
+
+	// сетка не мельче точки на ячейку и не больше MAX_SIDE ячеек по стороне
+	constexpr size_t MAX_SIDE = 1024;
+
+	// Раскладывает элементы по ячейкам: cells_of_item(item, add) вызывает add(cell) для каждой ячейки элемента
+	template <typename CellsOfItem>
+	void FillCells(size_t cell_count, size_t item_count, CellsOfItem cells_of_item,
+		std::vector<size_t>& offsets, std::vector<uint32_t>& items) {
+		offsets.assign(cell_count + 1, 0);
+		for (size_t item = 0; item < item_count; ++item) {
+			cells_of_item(item, [&offsets](size_t cell) { ++offsets[cell + 1]; });
+		}
+		for (size_t cell = 0; cell < cell_count; ++cell) {
+			offsets[cell + 1] += offsets[cell];
+		}
+		items.resize(offsets.back());
+		std::vector<size_t> next(offsets.begin(), offsets.end() - 1);
+		for (size_t item = 0; item < item_count; ++item) {
+			cells_of_item(item, [&](size_t cell) { items[next[cell]++] = static_cast<uint32_t>(item); });
+		}
+	}
+
+	// ячейка, в которую попадает координата; координаты за краями сетки попадают в крайние ячейки.
+	// Номер ограничивается ещё в double: приведение огромного значения к size_t — неопределённое поведение
+	size_t GetCell(double value, double start, double size, size_t count) {
+		const double cell = std::floor((value - start) / size);
+		if (!(cell > 0)) {
+			return 0;
+		}
+		return static_cast<size_t>(std::min(cell, static_cast<double>(count - 1)));
+	}
+
+	void SortUnique(std::vector<uint32_t>& values) {
+		std::sort(values.begin(), values.end());
+		values.erase(std::unique(values.begin(), values.end()), values.end());
+	}
+
+}
+
+bool Viewport::Contains(svg::Point point) const {
+	return min_x <= point.x && point.x <= max_x && min_y <= point.y && point.y <= max_y;
+}
+
+bool Viewport::Intersects(svg::Point from, svg::Point to) const {
+	// отсечение Лианга — Барски: ищем часть отрезка from + t * (to - from), t из [0, 1], внутри области
+	const double dx = to.x - from.x;
+	const double dy = to.y - from.y;
+	double t_min = 0;
+	double t_max = 1;
+	const std::pair<double, double> bounds[] = {
+		{ -dx, from.x - min_x }, { dx, max_x - from.x },
+		{ -dy, from.y - min_y }, { dy, max_y - from.y }
+	};
+	for (const auto& [p, q] : bounds) {
+		if (p == 0) {
+			// отрезок параллелен границе и лежит снаружи
+			if (q < 0) {
+				return false;
+			}
+			continue;
+		}
+		const double t = q / p;
+		if (p < 0) {
+			t_min = std::max(t_min, t);
+		}
+		else {
+			t_max = std::min(t_max, t);
+		}
+		if (t_min > t_max) {
+			return false;
+		}
+	}
+	return true;
+}
+
+GridIndex::GridIndex(std::vector<svg::Point> points, const std::vector<size_t>& route_offsets, const std::vector<uint32_t>& route_points)
+	: points_(std::move(points)) {
+	for (size_t route = 0; route + 1 < route_offsets.size(); ++route) {
+		const size_t first = route_offsets[route];
+		const size_t last = route_offsets[route + 1];
+		if (first == last) {
+			continue;
+		}
+		// у маршрута из одной остановки один вырожденный отрезок
+		if (last - first == 1) {
+			segments_.push_back({ static_cast<uint32_t>(route), route_points[first], route_points[first] });
+		}
+		for (size_t i = first + 1; i < last; ++i) {
+			segments_.push_back({ static_cast<uint32_t>(route), route_points[i - 1], route_points[i] });
+		}
+	}
+	if (points_.empty()) {
+		return;
+	}
+
+	const auto [left, right] = std::minmax_element(points_.begin(), points_.end(),
+		[](svg::Point lhs, svg::Point rhs) { return lhs.x < rhs.x; });
+	const auto [top, bottom] = std::minmax_element(points_.begin(), points_.end(),
+		[](svg::Point lhs, svg::Point rhs) { return lhs.y < rhs.y; });
+	min_x_ = left->x;
+	min_y_ = top->y;
+	max_x_ = right->x;
+	max_y_ = bottom->y;
+	const size_t side = std::clamp<size_t>(static_cast<size_t>(std::sqrt(static_cast<double>(points_.size()))), 1, MAX_SIDE);
+	columns_ = side;
+	rows_ = side;
+	// на вырожденной по ширине или высоте карте ячейка всё равно имеет ненулевой размер
+	cell_width_ = max_x_ > min_x_ ? (max_x_ - min_x_) / columns_ : 1;
+	cell_height_ = max_y_ > min_y_ ? (max_y_ - min_y_) / rows_ : 1;
+
+	FillCells(columns_ * rows_, points_.size(), [this](size_t point, auto add) {
+		CellRange cells;
+		const svg::Point p = points_[point];
+		if (GetCells(p.x, p.y, p.x, p.y, cells)) {
+			add(cells.min_row * columns_ + cells.min_column);
+		}
+	}, point_offsets_, cell_points_);
+
+	// отрезок попадает в ячейки, через которые проходит: по каждому столбцу берутся строки,
+	// которые отрезок пересекает в пределах столбца, и ещё по одной с краёв на случай округления
+	FillCells(columns_ * rows_, segments_.size(), [this](size_t segment, auto add) {
+		svg::Point from = points_[segments_[segment].from];
+		svg::Point to = points_[segments_[segment].to];
+		if (from.x > to.x) {
+			std::swap(from, to);
+		}
+		CellRange cells;
+		if (!GetCells(from.x, std::min(from.y, to.y), to.x, std::max(from.y, to.y), cells)) {
+			return;
+		}
+		const double slope = to.x > from.x ? (to.y - from.y) / (to.x - from.x) : 0;
+		for (size_t column = cells.min_column; column <= cells.max_column; ++column) {
+			double y_first = from.y;
+			double y_last = to.y;
+			if (to.x > from.x) {
+				const double x_first = std::max(from.x, min_x_ + cell_width_ * column);
+				const double x_last = std::min(to.x, min_x_ + cell_width_ * (column + 1));
+				y_first = from.y + slope * (x_first - from.x);
+				y_last = from.y + slope * (x_last - from.x);
+			}
+			const size_t min_row = std::max(GetRow(std::min(y_first, y_last)), cells.min_row + 1) - 1;
+			const size_t max_row = std::min(GetRow(std::max(y_first, y_last)) + 1, cells.max_row);
+			for (size_t row = min_row; row <= max_row; ++row) {
+				add(row * columns_ + column);
+			}
+		}
+	}, segment_offsets_, cell_segments_);
+}
+
+bool GridIndex::GetCells(double min_x, double min_y, double max_x, double max_y, CellRange& cells) const {
+	if (columns_ == 0) {
+		return false;
+	}
+	// сравнение с границами точек, а не с краем последней ячейки: тот из-за округления может оказаться левее самой правой точки
+	if (max_x < min_x_ || max_y < min_y_ || min_x > max_x_ || min_y > max_y_) {
+		return false;
+	}
+	cells.min_column = GetColumn(min_x);
+	cells.max_column = GetColumn(max_x);
+	cells.min_row = GetRow(min_y);
+	cells.max_row = GetRow(max_y);
+	return true;
+}
+
+size_t GridIndex::GetColumn(double x) const {
+	return GetCell(x, min_x_, cell_width_, columns_);
+}
+
+size_t GridIndex::GetRow(double y) const {
+	return GetCell(y, min_y_, cell_height_, rows_);
+}
+
+std::vector<uint32_t> GridIndex::FindPoints(const Viewport& area) const {
+	std::vector<uint32_t> result;
+	CellRange cells;
+	if (!GetCells(area.min_x, area.min_y, area.max_x, area.max_y, cells)) {
+		return result;
+	}
+	for (size_t row = cells.min_row; row <= cells.max_row; ++row) {
+		for (size_t column = cells.min_column; column <= cells.max_column; ++column) {
+			const size_t cell = row * columns_ + column;
+			for (size_t i = point_offsets_[cell]; i < point_offsets_[cell + 1]; ++i) {
+				if (area.Contains(points_[cell_points_[i]])) {
+					result.push_back(cell_points_[i]);
+				}
+			}
+		}
+	}
+	// каждая точка лежит в одной ячейке, повторов нет
+	std::sort(result.begin(), result.end());
+	return result;
+}
+
+std::vector<uint32_t> GridIndex::FindRoutes(const Viewport& area) const {
+	std::vector<uint32_t> result;
+	CellRange cells;
+	if (!GetCells(area.min_x, area.min_y, area.max_x, area.max_y, cells)) {
+		return result;
+	}
+	for (size_t row = cells.min_row; row <= cells.max_row; ++row) {
+		for (size_t column = cells.min_column; column <= cells.max_column; ++column) {
+			const size_t cell = row * columns_ + column;
+			for (size_t i = segment_offsets_[cell]; i < segment_offsets_[cell + 1]; ++i) {
+				const Segment& segment = segments_[cell_segments_[i]];
+				if (area.Intersects(points_[segment.from], points_[segment.to])) {
+					result.push_back(segment.route);
+				}
+			}
+		}
+	}
+	SortUnique(result);
+	return result;
+}
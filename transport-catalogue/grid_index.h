@@ -0,0 +1,75 @@
+#pragma once
+
+#include "svg.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace renderer {
+
+	// Прямоугольная область карты в координатах SVG, границы входят в область
+	struct Viewport {
+		double min_x = 0;
+		double min_y = 0;
+		double max_x = 0;
+		double max_y = 0;
+
+		bool Contains(svg::Point point) const;
+		// задевает ли отрезок from-to область
+		bool Intersects(svg::Point from, svg::Point to) const;
+	};
+
+	/*
+	 * Равномерная сетка над точками и ломаными карты. В каждой ячейке лежат точки
+	 * и отрезки ломаных, которые её задевают, поэтому поиск в области проверяет
+	 * только содержимое накрытых ею ячеек, а не всю карту.
+	 * Ломаная i состоит из точек route_points с route_offsets[i] по route_offsets[i + 1]
+	 */
+	class GridIndex {
+	public:
+		GridIndex() = default;
+		GridIndex(std::vector<svg::Point> points, const std::vector<size_t>& route_offsets, const std::vector<uint32_t>& route_points);
+
+		// индексы точек внутри области по возрастанию
+		std::vector<uint32_t> FindPoints(const Viewport& area) const;
+		// индексы ломаных, задевающих область, по возрастанию
+		std::vector<uint32_t> FindRoutes(const Viewport& area) const;
+
+	private:
+		struct Segment {
+			uint32_t route;
+			uint32_t from;
+			uint32_t to;
+		};
+		struct CellRange {
+			size_t min_column;
+			size_t min_row;
+			size_t max_column;
+			size_t max_row;
+		};
+
+		std::vector<svg::Point> points_;
+		std::vector<Segment> segments_;
+		// границы всех точек
+		double min_x_ = 0;
+		double min_y_ = 0;
+		double max_x_ = 0;
+		double max_y_ = 0;
+		double cell_width_ = 1;
+		double cell_height_ = 1;
+		size_t columns_ = 0;
+		size_t rows_ = 0;
+		// содержимое ячейки i лежит с *_offsets_[i] по *_offsets_[i + 1]
+		std::vector<size_t> point_offsets_;
+		std::vector<uint32_t> cell_points_;
+		std::vector<size_t> segment_offsets_;
+		std::vector<uint32_t> cell_segments_;
+
+		// ячейки, которые задевает прямоугольник; false, если он весь вне сетки
+		bool GetCells(double min_x, double min_y, double max_x, double max_y, CellRange& cells) const;
+		size_t GetColumn(double x) const;
+		size_t GetRow(double y) const;
+	};
+
+}
@@ -1,4 +1,16 @@
 #include "json.h"
+#include "json_writer.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <stdexcept>
+
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__)
+#include <immintrin.h>
+// SSE2 is always available on x86-64, AVX2 is chosen at run time
+#define JSON_X86_SIMD
+#endif
 
 using namespace std;
 
@@ -230,6 +242,422 @@ namespace json {
 
         }
 
+        // Byte scanners of EventParser. Each returns the first position in [begin, end)
+        // satisfying its condition, or end
+
+        bool IsJsonSpace(char c) {
+            return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+        }
+
+        // finds a character that ends a string or needs a special treatment in it
+        const char* FindStringSpecialScalar(const char* begin, const char* end) {
+            while (begin != end && *begin != '"' && *begin != '\\' && *begin != '\n' && *begin != '\r') {
+                ++begin;
+            }
+            return begin;
+        }
+
+        const char* SkipSpacesScalar(const char* begin, const char* end) {
+            while (begin != end && IsJsonSpace(*begin)) {
+                ++begin;
+            }
+            return begin;
+        }
+
+#ifdef JSON_X86_SIMD
+        __m128i StringSpecialMask(__m128i block) {
+            const __m128i quotes = _mm_cmpeq_epi8(block, _mm_set1_epi8('"'));
+            const __m128i backslashes = _mm_cmpeq_epi8(block, _mm_set1_epi8('\\'));
+            const __m128i line_feeds = _mm_cmpeq_epi8(block, _mm_set1_epi8('\n'));
+            const __m128i carriage_returns = _mm_cmpeq_epi8(block, _mm_set1_epi8('\r'));
+            return _mm_or_si128(_mm_or_si128(quotes, backslashes), _mm_or_si128(line_feeds, carriage_returns));
+        }
+
+        __m128i SpaceMask(__m128i block) {
+            const __m128i spaces = _mm_cmpeq_epi8(block, _mm_set1_epi8(' '));
+            // '\t', '\n', '\v', '\f' and '\r' are the consecutive codes 9..13
+            const __m128i controls = _mm_cmpeq_epi8(_mm_min_epu8(_mm_sub_epi8(block, _mm_set1_epi8('\t')), _mm_set1_epi8(4)),
+                _mm_sub_epi8(block, _mm_set1_epi8('\t')));
+            return _mm_or_si128(spaces, controls);
+        }
+
+        const char* FindStringSpecialSse2(const char* begin, const char* end) {
+            for (; end - begin >= 16; begin += 16) {
+                const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+                if (const int mask = _mm_movemask_epi8(StringSpecialMask(block)); mask != 0) {
+                    return begin + __builtin_ctz(mask);
+                }
+            }
+            return FindStringSpecialScalar(begin, end);
+        }
+
+        const char* SkipSpacesSse2(const char* begin, const char* end) {
+            for (; end - begin >= 16; begin += 16) {
+                const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+                if (const int mask = ~_mm_movemask_epi8(SpaceMask(block)) & 0xFFFF; mask != 0) {
+                    return begin + __builtin_ctz(mask);
+                }
+            }
+            return SkipSpacesScalar(begin, end);
+        }
+
+        __attribute__((target("avx2")))
+        const char* FindStringSpecialAvx2(const char* begin, const char* end) {
+            const __m256i quote = _mm256_set1_epi8('"');
+            const __m256i backslash = _mm256_set1_epi8('\\');
+            const __m256i line_feed = _mm256_set1_epi8('\n');
+            const __m256i carriage_return = _mm256_set1_epi8('\r');
+            for (; end - begin >= 32; begin += 32) {
+                const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(begin));
+                const __m256i hits = _mm256_or_si256(
+                    _mm256_or_si256(_mm256_cmpeq_epi8(block, quote), _mm256_cmpeq_epi8(block, backslash)),
+                    _mm256_or_si256(_mm256_cmpeq_epi8(block, line_feed), _mm256_cmpeq_epi8(block, carriage_return)));
+                if (const unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(hits)); mask != 0) {
+                    return begin + __builtin_ctz(mask);
+                }
+            }
+            return FindStringSpecialSse2(begin, end);
+        }
+
+        __attribute__((target("avx2")))
+        const char* SkipSpacesAvx2(const char* begin, const char* end) {
+            const __m256i space = _mm256_set1_epi8(' ');
+            const __m256i tab = _mm256_set1_epi8('\t');
+            const __m256i max_control_offset = _mm256_set1_epi8(4);
+            for (; end - begin >= 32; begin += 32) {
+                const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(begin));
+                const __m256i control_offset = _mm256_sub_epi8(block, tab);
+                const __m256i spaces = _mm256_or_si256(_mm256_cmpeq_epi8(block, space),
+                    _mm256_cmpeq_epi8(_mm256_min_epu8(control_offset, max_control_offset), control_offset));
+                if (const unsigned mask = ~static_cast<unsigned>(_mm256_movemask_epi8(spaces)); mask != 0) {
+                    return begin + __builtin_ctz(mask);
+                }
+            }
+            return SkipSpacesSse2(begin, end);
+        }
+#endif
+
+        struct Scanners {
+            const char* (*find_string_special)(const char* begin, const char* end);
+            const char* (*skip_spaces)(const char* begin, const char* end);
+        };
+
+        Scanners GetScanners(Scanner scanner) {
+            switch (scanner) {
+#ifdef JSON_X86_SIMD
+            case Scanner::AVX2:
+                return { FindStringSpecialAvx2, SkipSpacesAvx2 };
+            case Scanner::SSE2:
+                return { FindStringSpecialSse2, SkipSpacesSse2 };
+#endif
+            default:
+                return { FindStringSpecialScalar, SkipSpacesScalar };
+            }
+        }
+
+        Scanners& GetCurrentScanners() {
+            static Scanners scanners = GetScanners(
+                IsScannerSupported(Scanner::AVX2) ? Scanner::AVX2
+                : IsScannerSupported(Scanner::SSE2) ? Scanner::SSE2
+                : Scanner::SCALAR);
+            return scanners;
+        }
+
+        // Recursive descent over a contiguous buffer, accepting the same syntax as LoadNode.
+        // The buffer is either the whole input or a window of a stream, refilled when the parser reaches its end
+        class EventParser {
+        public:
+            EventParser(std::string_view input, EventHandler& handler)
+                : pos_(input.data())
+                , end_(input.data() + input.size())
+                , handler_(handler)
+                , scanners_(GetCurrentScanners()) {
+            }
+
+            EventParser(std::istream& input, size_t buffer_size, EventHandler& handler)
+                : pos_(nullptr)
+                , end_(nullptr)
+                , handler_(handler)
+                , scanners_(GetCurrentScanners())
+                , stream_(&input)
+                , buffer_(std::max<size_t>(buffer_size, 1)) {
+                pos_ = end_ = buffer_.data();
+            }
+
+            void ParseDocument() {
+                SkipWhitespace();
+                ParseValue();
+            }
+
+        private:
+            const char* pos_;
+            const char* end_;
+            EventHandler& handler_;
+            const Scanners scanners_;
+            // unescaped string, when it cannot be passed as a part of the input
+            std::string scratch_;
+            // nullptr when the whole input is in the buffer
+            std::istream* stream_ = nullptr;
+            std::vector<char> buffer_;
+
+            static bool IsDigit(char c) {
+                return c >= '0' && c <= '9';
+            }
+
+            // Reads the next part of the stream once the parser is at the end of the buffer. The bytes
+            // [token_begin, end_) of an unfinished token are moved to the start of the buffer first,
+            // which grows only if the token fills it. False at the end of the input
+            bool Refill(const char*& token_begin) {
+                if (stream_ == nullptr) {
+                    return false;
+                }
+                const size_t kept_offset = token_begin - buffer_.data();
+                const size_t kept_size = end_ - token_begin;
+                if (kept_size == buffer_.size()) {
+                    buffer_.resize(buffer_.size() * 2);
+                }
+                std::memmove(buffer_.data(), buffer_.data() + kept_offset, kept_size);
+                stream_->read(buffer_.data() + kept_size, static_cast<std::streamsize>(buffer_.size() - kept_size));
+                token_begin = buffer_.data();
+                pos_ = token_begin + kept_size;
+                end_ = pos_ + stream_->gcount();
+                return pos_ != end_;
+            }
+
+            // whether there is a byte at pos_, refilling the buffer if needed
+            bool HasByte() {
+                const char* token_begin = end_;
+                return pos_ != end_ || Refill(token_begin);
+            }
+
+            bool HasByte(const char*& token_begin) {
+                return pos_ != end_ || Refill(token_begin);
+            }
+
+            void SkipWhitespace() {
+                // most tokens are not preceded by whitespace at all
+                if (HasByte() && IsJsonSpace(*pos_)) {
+                    pos_ = scanners_.skip_spaces(pos_ + 1, end_);
+                    while (pos_ == end_ && HasByte()) {
+                        pos_ = scanners_.skip_spaces(pos_, end_);
+                    }
+                }
+            }
+
+            char Peek() {
+                if (!HasByte()) {
+                    throw ParsingError("Unexpected end of input"s);
+                }
+                return *pos_;
+            }
+
+            void Expect(char c) {
+                if (Peek() != c) {
+                    throw ParsingError("'"s + c + "' expected. but '"s + *pos_ + "' found"s);
+                }
+                ++pos_;
+            }
+
+            void ParseValue() {
+                switch (Peek()) {
+                case '{':
+                    ParseDict();
+                    break;
+                case '[':
+                    ParseArray();
+                    break;
+                case '"':
+                    ++pos_;
+                    handler_.String(ParseString());
+                    break;
+                case 't':
+                    ParseLiteral("true"sv);
+                    handler_.Bool(true);
+                    break;
+                case 'f':
+                    ParseLiteral("false"sv);
+                    handler_.Bool(false);
+                    break;
+                case 'n':
+                    ParseLiteral("null"sv);
+                    handler_.Null();
+                    break;
+                default:
+                    ParseNumber();
+                    break;
+                }
+            }
+
+            void ParseLiteral(std::string_view literal) {
+                const char* begin = pos_;
+                while (HasByte(begin) && std::isalpha(static_cast<unsigned char>(*pos_))) {
+                    ++pos_;
+                }
+                if (std::string_view(begin, pos_ - begin) != literal) {
+                    throw ParsingError("Failed to parse '"s + std::string(begin, pos_) + "' as "s + std::string(literal));
+                }
+            }
+
+            void ParseDict() {
+                ++pos_;
+                handler_.StartDict();
+                SkipWhitespace();
+                if (Peek() == '}') {
+                    ++pos_;
+                    handler_.EndDict();
+                    return;
+                }
+                while (true) {
+                    SkipWhitespace();
+                    Expect('"');
+                    handler_.Key(ParseString());
+                    SkipWhitespace();
+                    Expect(':');
+                    SkipWhitespace();
+                    ParseValue();
+                    SkipWhitespace();
+                    if (Peek() == '}') {
+                        ++pos_;
+                        break;
+                    }
+                    Expect(',');
+                }
+                handler_.EndDict();
+            }
+
+            void ParseArray() {
+                ++pos_;
+                handler_.StartArray();
+                SkipWhitespace();
+                if (Peek() == ']') {
+                    ++pos_;
+                    handler_.EndArray();
+                    return;
+                }
+                while (true) {
+                    SkipWhitespace();
+                    ParseValue();
+                    SkipWhitespace();
+                    if (Peek() == ']') {
+                        ++pos_;
+                        break;
+                    }
+                    Expect(',');
+                }
+                handler_.EndArray();
+            }
+
+            // the opening quote is already consumed
+            std::string_view ParseString() {
+                const char* begin = pos_;
+                pos_ = scanners_.find_string_special(pos_, end_);
+                while (pos_ == end_ && HasByte(begin)) {
+                    pos_ = scanners_.find_string_special(pos_, end_);
+                }
+                if (pos_ != end_ && *pos_ == '"') {
+                    return std::string_view(begin, pos_++ - begin);
+                }
+
+                scratch_.assign(begin, pos_);
+                while (true) {
+                    if (!HasByte()) {
+                        throw ParsingError("String parsing error");
+                    }
+                    const char ch = *pos_++;
+                    if (ch == '"') {
+                        break;
+                    }
+                    else if (ch == '\\') {
+                        if (!HasByte()) {
+                            throw ParsingError("String parsing error");
+                        }
+                        const char escaped_char = *pos_++;
+                        switch (escaped_char) {
+                        case 'n':
+                            scratch_.push_back('\n');
+                            break;
+                        case 't':
+                            scratch_.push_back('\t');
+                            break;
+                        case 'r':
+                            scratch_.push_back('\r');
+                            break;
+                        case '"':
+                            scratch_.push_back('"');
+                            break;
+                        case '\\':
+                            scratch_.push_back('\\');
+                            break;
+                        default:
+                            throw ParsingError("Unrecognized escape sequence \\"s + escaped_char);
+                        }
+                    }
+                    else if (ch == '\n' || ch == '\r') {
+                        throw ParsingError("Unexpected end of line"s);
+                    }
+                    else {
+                        // the run was cut by the end of the buffer
+                        scratch_.push_back(ch);
+                    }
+                    // copy the run up to the next special character at once
+                    const char* run_end = scanners_.find_string_special(pos_, end_);
+                    scratch_.append(pos_, run_end);
+                    pos_ = run_end;
+                }
+                return scratch_;
+            }
+
+            void ParseNumber() {
+                const char* begin = pos_;
+                auto read_digits = [this, &begin] {
+                    if (!HasByte(begin) || !IsDigit(*pos_)) {
+                        throw ParsingError("A digit is expected"s);
+                    }
+                    while (HasByte(begin) && IsDigit(*pos_)) {
+                        ++pos_;
+                    }
+                };
+
+                if (HasByte(begin) && *pos_ == '-') {
+                    ++pos_;
+                }
+                if (HasByte(begin) && *pos_ == '0') {
+                    ++pos_;
+                }
+                else {
+                    read_digits();
+                }
+
+                bool is_int = true;
+                if (HasByte(begin) && *pos_ == '.') {
+                    ++pos_;
+                    read_digits();
+                    is_int = false;
+                }
+                if (HasByte(begin) && (*pos_ == 'e' || *pos_ == 'E')) {
+                    ++pos_;
+                    if (HasByte(begin) && (*pos_ == '+' || *pos_ == '-')) {
+                        ++pos_;
+                    }
+                    read_digits();
+                    is_int = false;
+                }
+
+                if (is_int) {
+                    int value;
+                    if (std::from_chars(begin, pos_, value).ec == std::errc{}) {
+                        handler_.Int(value);
+                        return;
+                    }
+                }
+                double value;
+                if (std::from_chars(begin, pos_, value).ec != std::errc{}) {
+                    throw ParsingError("Failed to convert "s + std::string(begin, pos_) + " to number"s);
+                }
+                handler_.Double(value);
+            }
+        };
+
     }  // namespace
 
     // ============ Constructors ============
@@ -314,127 +742,43 @@ namespace json {
         return Document{ LoadNode(input) };
     }
 
-    // ========= printing json ==============
-
-    struct PrintContext {
-        std::ostream& out;
-        int indent_step = 4;
-        int indent = 0;
-
-        void PrintIndent() const {
-            for (int i = 0; i < indent; ++i) {
-                out.put(' ');
-            }
-        }
-
-        [[nodiscard]] PrintContext Indented() const {
-            return { out, indent_step, indent_step + indent };
-        }
-    };
-
-    void PrintString(const std::string& value, std::ostream& out) {
-        out.put('"');
-        for (const char c : value) {
-            switch (c) {
-            case '\r':
-                out << "\\r"sv;
-                break;
-            case '\n':
-                out << "\\n"sv;
-                break;
-            case '\t':
-                out << "\\t"sv;
-                break;
-            case '"':
-                [[fallthrough]];
-            case '\\':
-                out.put('\\');
-                [[fallthrough]];
-            default:
-                out.put(c);
-                break;
-            }
-        }
-        out.put('"');
+    void Parse(std::string_view input, EventHandler& handler) {
+        EventParser(input, handler).ParseDocument();
     }
 
-    void PrintNode(const Node& node, const PrintContext& context);
-
-    struct PrintValue {
-        const PrintContext& ctx;
-
-        void operator()(const int value) const {
-            ctx.out << value;
-        }
-        void operator()(const double value) const {
-            ctx.out << value;
-        }
-        void operator()(const string& value) const {
-            PrintString(value, ctx.out);
-        }
-        void operator()(const nullptr_t) const {
-            ctx.out << "null"sv;
-        }
-        void operator()(const bool value) const {
-            ctx.out << boolalpha << value;
-        }
-        void operator()(const Array& arr) const {
-            std::ostream& out = ctx.out;
-            out << "[\n"sv;
-            bool first = true;
-            auto inner_context = ctx.Indented();
-
-            for (const Node& node : arr) {
-                if (first) {
-                    first = false;
-                }
-                else {
-                    out << ",\n"sv;
-                }
-
-                inner_context.PrintIndent();
-                PrintNode(node, inner_context);
-            }
+    void Parse(std::istream& input, EventHandler& handler, size_t buffer_size) {
+        EventParser(input, buffer_size, handler).ParseDocument();
+    }
 
-            out.put('\n');
-            ctx.PrintIndent();
-            out.put(']');
+    bool IsScannerSupported(Scanner scanner) {
+        switch (scanner) {
+        case Scanner::SCALAR:
+            return true;
+#ifdef JSON_X86_SIMD
+        case Scanner::SSE2:
+            return true;
+        case Scanner::AVX2:
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx2");
+#endif
+        default:
+            return false;
         }
-        void operator()(const Dict& dict) const {
-            std::ostream& out = ctx.out;
-            out << "{\n"sv;
-            bool first = true;
-            auto inner_context = ctx.Indented();
-
-            for (const auto& [key, node] : dict) {
-                if (first) {
-                    first = false;
-                }
-                else {
-                    out << ",\n"sv;
-                }
-
-                inner_context.PrintIndent();
-                PrintString(key, ctx.out);
-                out << ": "sv;
-                PrintNode(node, inner_context);
-            }
+    }
 
-            out.put('\n');
-            ctx.PrintIndent();
-            out.put('}');
+    void SetScanner(Scanner scanner) {
+        if (!IsScannerSupported(scanner)) {
+            throw std::invalid_argument("the JSON scanner is not supported"s);
         }
-    };
-
-    void PrintNode(const Node& node, const PrintContext& ctx) {
-        visit(PrintValue{ ctx }, node.GetValue());
+        GetCurrentScanners() = GetScanners(scanner);
     }
 
-    void Print(const Document& doc, std::ostream& output) {
-
-        PrintNode(doc.GetRoot(), PrintContext{ output });
+    // ========= printing json ==============
 
+    void Print(const Document& doc, std::ostream& output) {
+        Writer(output).WriteNode(doc.GetRoot());
     }
+
     //========== comparison operators ==============
     bool operator==(const Node& left, const Node& right) {
         return left.GetValue() == right.GetValue();
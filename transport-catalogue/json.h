@@ -3,6 +3,7 @@
 #include <iostream>
 #include <map>
 #include <string>
+#include <string_view>
 #include <variant>
 #include <vector>
 
@@ -67,6 +68,43 @@ namespace json {
 
     Document Load(std::istream& input);
 
+    // Receives the values of a document in order as Parse recognizes them.
+    // Strings passed to Key and String are valid only during the call
+    class EventHandler {
+    public:
+        virtual ~EventHandler() = default;
+
+        virtual void StartDict() = 0;
+        virtual void Key(std::string_view key) = 0;
+        virtual void EndDict() = 0;
+        virtual void StartArray() = 0;
+        virtual void EndArray() = 0;
+        virtual void Null() = 0;
+        virtual void Bool(bool value) = 0;
+        virtual void Int(int value) = 0;
+        virtual void Double(double value) = 0;
+        virtual void String(std::string_view value) = 0;
+    };
+
+    // Parses the document in one pass without building Nodes
+    void Parse(std::string_view input, EventHandler& handler);
+    // The same over a buffer of buffer_size bytes refilled from the stream, so the input is never held whole;
+    // the buffer grows only to fit a token longer than it
+    void Parse(std::istream& input, EventHandler& handler, size_t buffer_size = 64 * 1024);
+
+    // Byte scanners Parse uses to find the ends of strings and whitespace.
+    // By default it takes the widest one the processor supports
+    enum class Scanner {
+        SCALAR,
+        SSE2,
+        AVX2,
+    };
+
+    bool IsScannerSupported(Scanner scanner);
+    // makes later calls of Parse use the scanner, e.g. to test each of them;
+    // must not run together with Parse. std::invalid_argument if it is not supported
+    void SetScanner(Scanner scanner);
+
     void Print(const Document& doc, std::ostream& output);
 
     bool operator==(const Document& lhs, const Document& rhs);
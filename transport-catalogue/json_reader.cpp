@@ -1,194 +1,817 @@
 #include "json_reader.h"
-#include "json_builder.h"
+#include "json_writer.h"
+#include "thread_pool.h"
 
-#include <sstream>
+#include <algorithm>
+#include <future>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <unordered_map>
 
 using namespace std::literals;
 using namespace json_reader;
 
-std::vector<DistanceToStop> detail::ParseDistanceToStop(const Node& stop_info) {
-	std::vector<DistanceToStop> result;
-	for (const auto& [key, val] : stop_info.AsMap()) {
-		result.emplace_back(DistanceToStop { key, val.AsInt()});
-	}
-	return result;
-}
+namespace {
+
+	// A run of consecutive base requests read without the catalogue. Names are views into the input or into strings
+	struct BaseRequestsChunk {
+		struct StopRequest {
+			std::string_view name;
+			geo::Coordinates coordinates;
+		};
+		struct DistanceRequest {
+			std::string_view from_stop;
+			std::string_view to_stop;
+			int distance;
+		};
+		struct BusRequest {
+			std::string_view name;
+			// the stops as listed in the input are bus_stops[first_stop, first_stop + stop_count)
+			size_t first_stop;
+			size_t stop_count;
+			bool is_roundtrip;
+		};
 
+		std::vector<StopRequest> stops;
+		std::vector<DistanceRequest> distances;
+		std::vector<BusRequest> buses;
+		std::vector<std::string_view> bus_stops;
+		size_t request_count = 0;
+		// names read from a stream, which are not kept in any input
+		view::Arena strings;
+	};
 
-std::vector<std::string_view> detail::ParseRoute(const Node& route, bool is_roundtrip) {
-	std::vector<std::string_view> stops;
+	// requests in a chunk; chunks are the units of work of a parallel build
+	constexpr size_t CHUNK_SIZE = 4096;
+	constexpr StopId NO_STOP = std::numeric_limits<StopId>::max();
 
-	stops.reserve(route.AsArray().size());
-	for (const auto& elem : route.AsArray()) {
-		stops.emplace_back(elem.AsString());
+	// Ids of the stops a chunk refers to, found once every stop is in the catalogue
+	struct ResolvedChunk {
+		// from and to stops of every distance, NO_STOP for unknown ones
+		std::vector<std::pair<StopId, StopId>> distance_stops;
+		// expanded routes one after another: the route of bus i is route_stops[route_offsets[i], route_offsets[i + 1])
+		std::vector<StopId> route_stops;
+		std::vector<size_t> route_offsets;
+	};
+
+	// calls function(i) for every i in [0, count), on the pool if there is one
+	template <typename Function>
+	void ForEachChunk(std::optional<thread_pool::ThreadPool>& pool, size_t count, Function function) {
+		if (pool) {
+			thread_pool::ParallelFor(*pool, count, function);
+			return;
+		}
+		for (size_t i = 0; i < count; ++i) {
+			function(i);
+		}
 	}
-	std::vector<std::string_view> results(stops.begin(), stops.end());
-	if (is_roundtrip) {
-		return results;
+
+	StopId FindStopId(const transport_catalogue::TransportCatalogue& catalogue, std::string_view stop_name) {
+		const Stop* stop = catalogue.FindStop(stop_name);
+		return stop == nullptr ? NO_STOP : stop->id;
 	}
-	results.insert(results.end(), std::next(stops.rbegin()), stops.rend());
 
-	return results;
-}
+	ResolvedChunk ResolveChunk(const BaseRequestsChunk& chunk, const transport_catalogue::TransportCatalogue& catalogue) {
+		ResolvedChunk result;
+		result.distance_stops.reserve(chunk.distances.size());
+		for (const auto& distance : chunk.distances) {
+			result.distance_stops.emplace_back(FindStopId(catalogue, distance.from_stop), FindStopId(catalogue, distance.to_stop));
+		}
+		result.route_offsets.reserve(chunk.buses.size() + 1);
+		result.route_offsets.push_back(0);
+		for (const auto& bus : chunk.buses) {
+			const size_t first = result.route_stops.size();
+			for (size_t i = 0; i < bus.stop_count; ++i) {
+				result.route_stops.push_back(FindStopId(catalogue, chunk.bus_stops[bus.first_stop + i]));
+			}
+			// the same expansion as detail::ExpandRoute
+			if (!bus.is_roundtrip) {
+				for (size_t i = result.route_stops.size() - first; i > 1; --i) {
+					result.route_stops.push_back(result.route_stops[first + i - 2]);
+				}
+			}
+			result.route_offsets.push_back(result.route_stops.size());
+		}
+		return result;
+	}
+
+	// Adds the chunks to the catalogue in their order, so the ids do not depend on the number of threads.
+	// Stops are added first and one by one; then the names distances and buses refer to are looked up
+	// on the pool, chunk by chunk, and the results are added in order again
+	void AddBaseRequests(const std::vector<BaseRequestsChunk>& chunks, transport_catalogue::TransportCatalogue& catalogue,
+		std::optional<thread_pool::ThreadPool>& pool) {
+		for (const auto& chunk : chunks) {
+			for (const auto& stop : chunk.stops) {
+				catalogue.AddStop(stop.name, stop.coordinates);
+			}
+		}
+		// the catalogue is only read until every chunk is resolved
+		std::vector<ResolvedChunk> resolved(chunks.size());
+		ForEachChunk(pool, chunks.size(), [&](size_t index) {
+			resolved[index] = ResolveChunk(chunks[index], catalogue);
+		});
 
-void JsonReader::AddStopsToCatalogue(const Array& request_array, transport_catalogue::TransportCatalogue& catalogue) const {
-	for (const Node& request_node : request_array) {
-		Dict request = request_node.AsMap();
-		if (request.at("type"s).AsString() == "Stop"s) {
-			catalogue.AddStop(request.at("name"s).AsString(), { request.at("latitude"s).AsDouble(),  request.at("longitude"s).AsDouble() });
+		for (size_t index = 0; index < chunks.size(); ++index) {
+			for (size_t i = 0; i < chunks[index].distances.size(); ++i) {
+				const auto [from, to] = resolved[index].distance_stops[i];
+				// distances to unknown stops are skipped, as by the catalogue itself
+				if (from != NO_STOP && to != NO_STOP) {
+					catalogue.SetStopDistances(from, to, chunks[index].distances[i].distance);
+				}
+			}
+		}
+		for (size_t index = 0; index < chunks.size(); ++index) {
+			const BaseRequestsChunk& chunk = chunks[index];
+			for (size_t i = 0; i < chunk.buses.size(); ++i) {
+				const auto& bus = chunk.buses[i];
+				const StopId* first = resolved[index].route_stops.data() + resolved[index].route_offsets[i];
+				const StopId* last = resolved[index].route_stops.data() + resolved[index].route_offsets[i + 1];
+				if (std::find(first, last, NO_STOP) != last) {
+					// adding by names throws the usual error for the unknown stop
+					const auto stops = chunk.bus_stops.begin() + bus.first_stop;
+					catalogue.AddBus(bus.name, detail::ExpandRoute({ stops, stops + bus.stop_count }, bus.is_roundtrip), bus.is_roundtrip);
+				}
+				else {
+					catalogue.AddBus(bus.name, ranges::Range{ first, last }, bus.is_roundtrip);
+				}
+			}
 		}
 	}
-}
 
-void JsonReader::SetStopDistancesInCatalogue(const Array& request_array, transport_catalogue::TransportCatalogue& catalogue) const {
-	for (const Node& request_node : request_array) {
-		Dict request = request_node.AsMap();
-		if (request.at("type"s).AsString() == "Stop"s) {
-			for (const auto& dst : detail::ParseDistanceToStop(request.at("road_distances"s))) {
-				catalogue.SetStopDistances(request.at("name"s).AsString(), dst.stop_name, dst.distance);
+	// Adds chunks of base requests to the catalogue one after another as they are read, so that only the chunk
+	// being read and the requests referring to stops not added yet are kept. Stops get their ids in the order
+	// of the requests. A distance to a stop not added yet waits for that stop; a bus listing such a stop waits
+	// for the end of the input, when an unknown stop makes adding it throw the usual error
+	class CatalogueFiller {
+	public:
+		explicit CatalogueFiller(transport_catalogue::TransportCatalogue& catalogue)
+			: catalogue_(catalogue) {}
+
+		void Add(const BaseRequestsChunk& chunk) {
+			for (const auto& stop : chunk.stops) {
+				catalogue_.AddStop(stop.name, stop.coordinates);
+				// the waiting distances were read before the ones of the chunk, so they are set first
+				if (waiting_lists_.empty()) {
+					continue;
+				}
+				if (const auto it = waiting_lists_.find(stop.name); it != waiting_lists_.end()) {
+					const StopId to = FindStopId(catalogue_, stop.name);
+					for (size_t i = it->second.first; i != NO_WAITING; i = waiting_distances_[i].next) {
+						catalogue_.SetStopDistances(waiting_distances_[i].from, to, waiting_distances_[i].distance);
+					}
+					waiting_lists_.erase(it);
+					if (waiting_lists_.empty()) {
+						waiting_distances_.clear();
+					}
+				}
+			}
+			const ResolvedChunk resolved = ResolveChunk(chunk, catalogue_);
+			for (size_t i = 0; i < chunk.distances.size(); ++i) {
+				const auto [from, to] = resolved.distance_stops[i];
+				// the from stop is the one the distance is listed at, it is already added
+				if (to == NO_STOP) {
+					AddWaitingDistance(chunk.distances[i].to_stop, from, chunk.distances[i].distance);
+				}
+				else {
+					catalogue_.SetStopDistances(from, to, chunk.distances[i].distance);
+				}
+			}
+			for (size_t i = 0; i < chunk.buses.size(); ++i) {
+				const auto& bus = chunk.buses[i];
+				const StopId* first = resolved.route_stops.data() + resolved.route_offsets[i];
+				const StopId* last = resolved.route_stops.data() + resolved.route_offsets[i + 1];
+				if (std::find(first, last, NO_STOP) == last) {
+					catalogue_.AddBus(bus.name, ranges::Range{ first, last }, bus.is_roundtrip);
+					continue;
+				}
+				waiting_buses_.push_back({ KeepName(bus.name), waiting_bus_stops_.size(), bus.stop_count, bus.is_roundtrip });
+				for (size_t stop = 0; stop < bus.stop_count; ++stop) {
+					waiting_bus_stops_.push_back(KeepName(chunk.bus_stops[bus.first_stop + stop]));
+				}
+			}
+		}
+
+		// distances to stops that never came are skipped, as by the catalogue itself
+		void Finish() {
+			for (const auto& bus : waiting_buses_) {
+				const auto stops = waiting_bus_stops_.begin() + bus.first_stop;
+				catalogue_.AddBus(bus.name, detail::ExpandRoute({ stops, stops + bus.stop_count }, bus.is_roundtrip), bus.is_roundtrip);
+			}
+			waiting_buses_.clear();
+			waiting_bus_stops_.clear();
+			waiting_lists_.clear();
+			waiting_distances_.clear();
+		}
+
+	private:
+		static constexpr size_t NO_WAITING = std::numeric_limits<size_t>::max();
+
+		struct WaitingDistance {
+			StopId from;
+			int distance;
+			// the next distance waiting for the same stop
+			size_t next = NO_WAITING;
+		};
+		// the first and the last distance waiting for a stop
+		struct WaitingList {
+			size_t first;
+			size_t last;
+		};
+
+		transport_catalogue::TransportCatalogue& catalogue_;
+		// names the waiting requests refer to, copied out of their chunks
+		view::Arena names_;
+		// in the order they were read, linked into lists by the name of the stop they wait for
+		std::vector<WaitingDistance> waiting_distances_;
+		std::unordered_map<std::string_view, WaitingList> waiting_lists_;
+		// the same layout as in a chunk: the stops of a bus are waiting_bus_stops_[first_stop, first_stop + stop_count)
+		std::vector<BaseRequestsChunk::BusRequest> waiting_buses_;
+		std::vector<std::string_view> waiting_bus_stops_;
+
+		std::string_view KeepName(std::string_view name) {
+			return names_.CopyString(name);
+		}
+
+		void AddWaitingDistance(std::string_view to_stop, StopId from, int distance) {
+			const size_t index = waiting_distances_.size();
+			waiting_distances_.push_back({ from, distance });
+			if (const auto it = waiting_lists_.find(to_stop); it != waiting_lists_.end()) {
+				waiting_distances_[it->second.last].next = index;
+				it->second.last = index;
+			}
+			else {
+				waiting_lists_.emplace(KeepName(to_stop), WaitingList{ index, index });
+			}
+		}
+	};
+
+	// Builds the document without base_requests, which are read into chunks as the parser goes
+	// and added to the catalogue as soon as a chunk is full. If build_settings.threads comes before
+	// base_requests and is not 1, a full chunk is added on the pool while the parser reads the next one;
+	// at most one chunk is being added at a time, so the catalogue gets them in the same order
+	class BaseRequestsLoader final : public json::EventHandler {
+	public:
+		explicit BaseRequestsLoader(transport_catalogue::TransportCatalogue& catalogue)
+			: filler_(catalogue) {}
+
+		// adds the last chunk and the requests waiting for stops
+		void Finish() {
+			if (pool_) {
+				pool_->Wait();
+			}
+			if (chunk_.request_count > 0) {
+				filler_.Add(chunk_);
+				chunk_ = {};
+			}
+			filler_.Finish();
+		}
+
+		view::Document Build() {
+			return builder_.Build();
+		}
+
+		void StartDict() override {
+			if (!in_base_requests_) {
+				CheckNotBaseRequests();
+				builder_.StartDict();
+			}
+			else if (depth_ == 2) {
+				StartRequest();
+			}
+			++depth_;
+		}
+
+		void Key(std::string_view key) override {
+			if (!in_base_requests_) {
+				if (depth_ == 1) {
+					root_key_ = key;
+					if (root_key_ == "base_requests"sv) {
+						return;
+					}
+				}
+				else if (depth_ == 2) {
+					settings_key_ = key;
+				}
+				builder_.Key(key);
+			}
+			else if (depth_ == 3) {
+				field_ = key;
+			}
+			else if (depth_ == 4 && field_ == "road_distances"sv) {
+				distance_stop_ = Keep(key);
+			}
+		}
+
+		void EndDict() override {
+			--depth_;
+			if (!in_base_requests_) {
+				builder_.EndDict();
+			}
+			else if (depth_ == 2) {
+				FinishRequest();
+			}
+		}
+
+		void StartArray() override {
+			if (!in_base_requests_) {
+				if (depth_ == 1 && root_key_ == "base_requests"sv) {
+					in_base_requests_ = true;
+					StartPool();
+				}
+				else {
+					builder_.StartArray();
+				}
+			}
+			else {
+				CheckRequestIsDict();
+			}
+			++depth_;
+		}
+
+		void EndArray() override {
+			--depth_;
+			if (!in_base_requests_) {
+				builder_.EndArray();
+			}
+			else if (depth_ == 1) {
+				in_base_requests_ = false;
+			}
+		}
+
+		void Null() override {
+			if (!in_base_requests_) {
+				CheckNotBaseRequests();
+				builder_.Null();
+			}
+			else {
+				CheckRequestIsDict();
+			}
+		}
+
+		void Bool(bool value) override {
+			if (!in_base_requests_) {
+				CheckNotBaseRequests();
+				builder_.Bool(value);
+			}
+			else {
+				CheckRequestIsDict();
+				if (depth_ == 3 && field_ == "is_roundtrip"sv) {
+					is_roundtrip_ = value;
+				}
+			}
+		}
+
+		void Int(int value) override {
+			if (!in_base_requests_) {
+				CheckNotBaseRequests();
+				if (depth_ == 2 && root_key_ == "build_settings"sv && settings_key_ == "threads"sv) {
+					build_thread_count_ = value;
+				}
+				builder_.Int(value);
+			}
+			else {
+				CheckRequestIsDict();
+				if (depth_ == 4 && field_ == "road_distances"sv) {
+					distances_.push_back({ distance_stop_, value });
+				}
+				else {
+					SetCoordinate(value);
+				}
+			}
+		}
+
+		void Double(double value) override {
+			if (!in_base_requests_) {
+				CheckNotBaseRequests();
+				builder_.Double(value);
+			}
+			else {
+				CheckRequestIsDict();
+				if (depth_ == 4 && field_ == "road_distances"sv) {
+					throw std::logic_error("invalid type");
+				}
+				SetCoordinate(value);
+			}
+		}
+
+		void String(std::string_view value) override {
+			if (!in_base_requests_) {
+				CheckNotBaseRequests();
+				builder_.String(value);
+			}
+			else {
+				CheckRequestIsDict();
+				if (depth_ == 4 && field_ == "stops"sv) {
+					stops_.push_back(Keep(value));
+				}
+				else if (depth_ == 3 && field_ == "type"sv) {
+					type_ = value;
+				}
+				else if (depth_ == 3 && field_ == "name"sv) {
+					name_ = Keep(value);
+				}
+			}
+		}
+
+	private:
+		// collects the root values other than base_requests, copying their strings
+		view::DocumentBuilder builder_{ std::string_view{} };
+		CatalogueFiller filler_;
+		std::string root_key_;
+		std::string settings_key_;
+		size_t depth_ = 0;
+		bool in_base_requests_ = false;
+		// build_settings.threads, if it was read before base_requests
+		std::optional<int> build_thread_count_;
+		BaseRequestsChunk chunk_;
+		// the chunk being added on the pool; the pool goes after it and the filler, so its task is finished before they are destroyed
+		BaseRequestsChunk added_chunk_;
+		std::optional<thread_pool::ThreadPool> pool_;
+
+		// fields of the current base request
+		std::string field_;
+		std::string type_;
+		std::string_view name_;
+		std::optional<double> latitude_;
+		std::optional<double> longitude_;
+		std::optional<bool> is_roundtrip_;
+		std::string_view distance_stop_;
+		std::vector<std::pair<std::string_view, int>> distances_;
+		std::vector<std::string_view> stops_;
+
+		// base_requests have to be an array
+		void CheckNotBaseRequests() const {
+			if (depth_ == 1 && root_key_ == "base_requests"sv) {
+				throw std::logic_error("invalid type");
+			}
+		}
+
+		void CheckRequestIsDict() const {
+			if (depth_ == 2 && in_base_requests_) {
+				throw std::logic_error("invalid type");
+			}
+		}
+
+		// a wrong thread count is reported by GetBuildThreadCount, here the chunks are just added in place
+		void StartPool() {
+			if (build_thread_count_ && *build_thread_count_ >= 0 && *build_thread_count_ != 1 && !pool_) {
+				pool_.emplace(static_cast<size_t>(*build_thread_count_));
+			}
+		}
+
+		void FlushChunk() {
+			if (!pool_) {
+				filler_.Add(chunk_);
+				chunk_ = {};
+				return;
 			}
+			// the previous chunk has to be in the catalogue first; Wait rethrows its error
+			pool_->Wait();
+			added_chunk_ = std::move(chunk_);
+			chunk_ = {};
+			pool_->Submit([this] {
+				filler_.Add(added_chunk_);
+			});
 		}
+
+		// the parser's buffer is refilled, so the strings of the current request go to its chunk
+		std::string_view Keep(std::string_view value) {
+			return chunk_.strings.CopyString(value);
+		}
+
+		void SetCoordinate(double value) {
+			if (depth_ == 3 && field_ == "latitude"sv) {
+				latitude_ = value;
+			}
+			else if (depth_ == 3 && field_ == "longitude"sv) {
+				longitude_ = value;
+			}
+		}
+
+		void StartRequest() {
+			type_.clear();
+			name_ = {};
+			latitude_.reset();
+			longitude_.reset();
+			is_roundtrip_.reset();
+			distances_.clear();
+			stops_.clear();
+		}
+
+		void FinishRequest() {
+			if (type_ == "Stop"sv) {
+				if (!latitude_ || !longitude_) {
+					throw std::out_of_range("stop "s + std::string(name_) + " has no coordinates"s);
+				}
+				chunk_.stops.push_back({ name_, { *latitude_, *longitude_ } });
+				for (const auto& [stop_name, distance] : distances_) {
+					chunk_.distances.push_back({ name_, stop_name, distance });
+				}
+			}
+			else if (type_ == "Bus"sv) {
+				if (!is_roundtrip_) {
+					throw std::out_of_range("bus "s + std::string(name_) + " has no is_roundtrip"s);
+				}
+				chunk_.buses.push_back({ name_, chunk_.bus_stops.size(), stops_.size(), *is_roundtrip_ });
+				chunk_.bus_stops.insert(chunk_.bus_stops.end(), stops_.begin(), stops_.end());
+			}
+			else if (type_.empty()) {
+				throw std::out_of_range("base request has no type");
+			}
+			if (++chunk_.request_count == CHUNK_SIZE) {
+				FlushChunk();
+			}
+		}
+	};
+
+	// stat_settings.threads and the like: 1 by default, 0 for one per hardware thread
+	size_t GetThreadCount(const view::Document& document, std::string_view settings_key) {
+		view::Dict requests = document.GetRoot().AsMap();
+		if (!requests.count(settings_key) || !requests.at(settings_key).AsMap().count("threads"sv)) {
+			return 1;
+		}
+		const int thread_count = requests.at(settings_key).AsMap().at("threads"sv).AsInt();
+		if (thread_count < 0) {
+			throw std::invalid_argument("thread count should be non-negative");
+		}
+		return static_cast<size_t>(thread_count);
 	}
 }
 
-void JsonReader::AddBusesToCatalogue(const Array& request_array, transport_catalogue::TransportCatalogue& catalogue) const {
-	for (const Node& request_node : request_array) {
-		Dict request = request_node.AsMap();
-		if (request.at("type"s).AsString() == "Bus"s) {
-			bool is_roundtrip = request.at("is_roundtrip"s).AsBool();
-			catalogue.AddBus(request.at("name"s).AsString(), detail::ParseRoute(request.at("stops"s), is_roundtrip), is_roundtrip);
-		}
+std::vector<std::string_view> detail::ExpandRoute(std::vector<std::string_view> stops, bool is_roundtrip) {
+	if (is_roundtrip || stops.empty()) {
+		return stops;
+	}
+	const size_t forward_size = stops.size();
+	stops.reserve(forward_size * 2 - 1);
+	for (size_t i = forward_size - 1; i > 0; --i) {
+		stops.push_back(stops[i - 1]);
 	}
+
+	return stops;
+}
+
+graph::RouterAlgorithm detail::ParseRouterAlgorithm(std::string_view algorithm) {
+	if (algorithm == "dijkstra"sv) {
+		return graph::RouterAlgorithm::DIJKSTRA;
+	}
+	if (algorithm == "radix_heap_dijkstra"sv) {
+		return graph::RouterAlgorithm::RADIX_HEAP_DIJKSTRA;
+	}
+	if (algorithm == "a_star"sv) {
+		return graph::RouterAlgorithm::A_STAR;
+	}
+	if (algorithm == "contraction_hierarchy"sv) {
+		return graph::RouterAlgorithm::CONTRACTION_HIERARCHY;
+	}
+	if (algorithm == "all_pairs"sv) {
+		return graph::RouterAlgorithm::ALL_PAIRS;
+	}
+	throw std::invalid_argument("unknown routing algorithm "s + std::string(algorithm));
+}
+
+std::string detail::ReadInput(std::istream& input) {
+	std::string buffer;
+	std::vector<char> chunk(1 << 16);
+	while (input.read(chunk.data(), chunk.size()) || input.gcount() > 0) {
+		buffer.append(chunk.data(), input.gcount());
+	}
+	return buffer;
+}
+
+JsonReader::JsonReader(std::istream& input)
+	: input_(detail::ReadInput(input)),
+	json_doc_(view::Load(input_))
+{
+}
+
+JsonReader::JsonReader(std::istream& input, transport_catalogue::TransportCatalogue& catalogue)
+	: json_doc_(LoadWithBaseRequests(input, catalogue))
+{
+}
+
+view::Document JsonReader::LoadWithBaseRequests(std::istream& input, transport_catalogue::TransportCatalogue& catalogue) {
+	BaseRequestsLoader loader(catalogue);
+	json::Parse(input, loader);
+	loader.Finish();
+	return loader.Build();
+}
+
+size_t JsonReader::GetBuildThreadCount() const {
+	return GetThreadCount(json_doc_, "build_settings"sv);
 }
 
 void JsonReader::ApplyBaseRequests(transport_catalogue::TransportCatalogue& catalogue) const {
-	Dict requests = json_doc_.GetRoot().AsMap();
-	if (!requests.count("base_requests"s)) {
+	view::Dict requests = json_doc_.GetRoot().AsMap();
+	if (!requests.count("base_requests"sv)) {
 		return;
 	}
-	Array base_requests = requests.at("base_requests"s).AsArray();
-	AddStopsToCatalogue(base_requests, catalogue);
-	SetStopDistancesInCatalogue(base_requests, catalogue);
-	AddBusesToCatalogue(base_requests, catalogue);
+	const view::Array base_requests = requests.at("base_requests"sv).AsArray();
+	std::optional<thread_pool::ThreadPool> pool;
+	const size_t thread_count = GetBuildThreadCount();
+	if (thread_count != 1) {
+		pool.emplace(thread_count);
+	}
+	// every chunk of the requests is read on its own, stops may refer to ones from later chunks
+	std::vector<BaseRequestsChunk> chunks((base_requests.size() + CHUNK_SIZE - 1) / CHUNK_SIZE);
+	ForEachChunk(pool, chunks.size(), [&](size_t index) {
+		BaseRequestsChunk& chunk = chunks[index];
+		const size_t last = std::min(base_requests.size(), (index + 1) * CHUNK_SIZE);
+		for (size_t i = index * CHUNK_SIZE; i < last; ++i) {
+			const view::Dict request = base_requests[i].AsMap();
+			const std::string_view type = request.at("type"sv).AsString();
+			const std::string_view name = request.at("name"sv).AsString();
+			if (type == "Stop"sv) {
+				chunk.stops.push_back({ name, { request.at("latitude"sv).AsDouble(), request.at("longitude"sv).AsDouble() } });
+				for (const auto& [stop_name, distance] : request.at("road_distances"sv).AsMap()) {
+					chunk.distances.push_back({ name, stop_name, distance.AsInt() });
+				}
+			}
+			else if (type == "Bus"sv) {
+				const view::Array stops = request.at("stops"sv).AsArray();
+				chunk.buses.push_back({ name, chunk.bus_stops.size(), stops.size(), request.at("is_roundtrip"sv).AsBool() });
+				for (const view::Node& stop : stops) {
+					chunk.bus_stops.push_back(stop.AsString());
+				}
+			}
+		}
+		chunk.request_count = last - index * CHUNK_SIZE;
+	});
+	AddBaseRequests(chunks, catalogue, pool);
 }
 
-Node JsonReader::PrepareBusStat(const Dict& request, transport_catalogue::TransportCatalogue& catalogue) const {
-	json::Builder bus_stat{};
-	bus_stat.StartDict().Key("request_id"s).Value(request.at("id"s).AsInt());
-	std::string bus_name = request.at("name"s).AsString();
+// keys are written in the ascending order Print would sort them in
+void JsonReader::WriteBusStat(const view::Dict& request, const transport_catalogue::TransportCatalogue& catalogue, json::Writer& writer) const {
+	const int request_id = request.at("id"s).AsInt();
+	std::string_view bus_name = request.at("name"s).AsString();
+	writer.StartDict();
 	if (catalogue.FindBus(bus_name) == nullptr) {
-
-		bus_stat.Key("error_message"s).Value("not found"s);
+		writer.Key("error_message"sv).Value("not found"sv)
+			.Key("request_id"sv).Value(request_id);
 	}
 	else {
 		auto bus_info = catalogue.GetBusInfo(bus_name);
-		bus_stat.Key("curvature"s).Value(bus_info.curvature)
-				.Key("route_length"s).Value(bus_info.route_length)
-				.Key("stop_count"s).Value(static_cast<int>(bus_info.all_stops_count))
-				.Key("unique_stop_count"s).Value(static_cast<int>(bus_info.unique_stops_count));
+		writer.Key("curvature"sv).Value(bus_info.curvature)
+			.Key("request_id"sv).Value(request_id)
+			.Key("route_length"sv).Value(bus_info.route_length)
+			.Key("stop_count"sv).Value(static_cast<int>(bus_info.all_stops_count))
+			.Key("unique_stop_count"sv).Value(static_cast<int>(bus_info.unique_stops_count));
 	}
-
-	return bus_stat.EndDict().Build();
-
+	writer.EndDict();
 }
 
-Node JsonReader::PrepareStopStat(const Dict& request, transport_catalogue::TransportCatalogue& catalogue) const {
-	json::Builder stop_stat{};
-	stop_stat.StartDict().Key("request_id"s).Value(request.at("id"s).AsInt());
-	std::string stop_name = request.at("name"s).AsString();
+void JsonReader::WriteStopStat(const view::Dict& request, const transport_catalogue::TransportCatalogue& catalogue, json::Writer& writer) const {
+	const int request_id = request.at("id"s).AsInt();
+	std::string_view stop_name = request.at("name"s).AsString();
+	writer.StartDict();
 	if (catalogue.FindStop(stop_name) == nullptr) {
-		stop_stat.Key("error_message"s).Value("not found"s);
+		writer.Key("error_message"sv).Value("not found"sv);
 	}
 	else {
-		auto stop_info = catalogue.GetStopInfo(stop_name);
-		if (stop_info.empty()) {
-			stop_stat.Key("buses"s).StartArray().EndArray();
-		}
-		else {
-			stop_stat.Key("buses"s).StartArray();
-			for (const auto& bus : stop_info) {
-				stop_stat.Value(bus->name);
-			}
-			stop_stat.EndArray();
+		writer.Key("buses"sv).StartArray();
+		for (const BusId bus_id : catalogue.GetStopInfo(stop_name)) {
+			writer.Value(catalogue.GetBus(bus_id).name);
 		}
-
+		writer.EndArray();
 	}
-
-	return stop_stat.EndDict().Build();
+	writer.Key("request_id"sv).Value(request_id).EndDict();
 }
 
-Node JsonReader::PrepareMap(const Dict& request, std::set<const Bus*, BusSetCmp>& buses, renderer::MapRenderer& renderer) const {
-	std::ostringstream out;
-	renderer.RenderMap(buses, out);
-	json::Builder map_data{};
-	return map_data.StartDict().Key("request_id"s).Value(request.at("id"s).AsInt())
-		.Key("map"s).Value(out.str())
-		.EndDict().Build();
+void JsonReader::WriteMap(const view::Dict& request, const transport_catalogue::TransportCatalogue& catalogue,
+	const renderer::MapRenderer& renderer, json::Writer& writer) const {
+	writer.StartDict().Key("map"sv);
+	// "viewport" or "tile" limits the map to a part of it, otherwise the whole map is written
+	if (request.count("viewport"s)) {
+		const view::Dict viewport = request.at("viewport"s).AsMap();
+		const renderer::Viewport area{ viewport.at("min_x"s).AsDouble(), viewport.at("min_y"s).AsDouble(),
+			viewport.at("max_x"s).AsDouble(), viewport.at("max_y"s).AsDouble() };
+		// the negated comparisons also reject NaN bounds
+		if (!(area.min_x <= area.max_x) || !(area.min_y <= area.max_y)) {
+			throw std::invalid_argument("viewport bounds should be numbers with min <= max");
+		}
+		writer.Value(renderer.RenderCatalogueMapArea(catalogue, area));
+	}
+	else if (request.count("tile"s)) {
+		const view::Dict tile = request.at("tile"s).AsMap();
+		const renderer::Viewport area = renderer.GetTileViewport(tile.at("z"s).AsInt(), tile.at("x"s).AsInt(), tile.at("y"s).AsInt());
+		writer.Value(renderer.RenderCatalogueMapArea(catalogue, area));
+	}
+	else {
+		writer.Value(*renderer.RenderCatalogueMap(catalogue));
+	}
+	writer.Key("request_id"sv).Value(request.at("id"s).AsInt())
+		.EndDict();
 }
 
-Node JsonReader::PrepareRouteStat(const Dict& request, transport_router::TransportRouter& router) const {
+void JsonReader::WriteRouteStat(const view::Dict& request, const transport_router::TransportRouter& router, json::Writer& writer) const {
+	const int request_id = request.at("id"s).AsInt();
 	std::string_view stop_from = request.at("from"s).AsString();
 	std::string_view stop_to = request.at("to"s).AsString();
 	std::optional<transport_router::TranspRouteInfo> route_info = router.MakeRoute(stop_from, stop_to);
-	json::Builder route_json{};
-	route_json.StartDict().Key("request_id"s).Value(request.at("id"s).AsInt());
+	writer.StartDict();
 	if (!route_info) {
-		return route_json.Key("error_message"s).Value("not found"s).EndDict().Build();
+		writer.Key("error_message"sv).Value("not found"sv)
+			.Key("request_id"sv).Value(request_id)
+			.EndDict();
+		return;
 	}
-	route_json.Key("total_time"s).Value(route_info->total_time)
-				.Key("items"s).StartArray() ;
+	writer.Key("items"sv).StartArray();
 	for (const auto& item : route_info->items) {
 		if (item.type == EdgeType::WAIT) {
-			route_json.StartDict().Key("type"s).Value("Wait"s)
-				.Key("stop_name"s).Value(item.name)
-				.Key("time"s).Value(item.time)
+			writer.StartDict().Key("stop_name"sv).Value(item.name)
+				.Key("time"sv).Value(item.time)
+				.Key("type"sv).Value("Wait"sv)
 				.EndDict();
 			continue;
 		}
 		if (item.type == EdgeType::BUS) {
-			route_json.StartDict().Key("type"s).Value("Bus"s)
-				.Key("bus"s).Value(std::string(item.name))
-				.Key("span_count"s).Value(item.span_count.value())
-				.Key("time"s).Value(item.time)
+			writer.StartDict().Key("bus"sv).Value(item.name)
+				.Key("span_count"sv).Value(item.span_count.value())
+				.Key("time"sv).Value(item.time)
+				.Key("type"sv).Value("Bus"sv)
 				.EndDict();
 			continue;
 		}
 	}
-	return route_json.EndArray().EndDict().Build();
+	writer.EndArray()
+		.Key("request_id"sv).Value(request_id)
+		.Key("total_time"sv).Value(route_info->total_time)
+		.EndDict();
+}
 
+bool JsonReader::WriteStat(const view::Dict& request, const transport_catalogue::TransportCatalogue& catalogue,
+	const renderer::MapRenderer& renderer, const transport_router::TransportRouter& router, json::Writer& writer) const {
+	const std::string_view type = request.at("type"s).AsString();
+	if (type == "Bus"sv) {
+		WriteBusStat(request, catalogue, writer);
+	}
+	else if (type == "Stop"sv) {
+		WriteStopStat(request, catalogue, writer);
+	}
+	else if (type == "Map"sv) {
+		WriteMap(request, catalogue, renderer, writer);
+	}
+	else if (type == "Route"sv) {
+		WriteRouteStat(request, router, writer);
+	}
+	else {
+		return false;
+	}
+	return true;
 }
 
-void JsonReader::ApplyStatRequests(transport_catalogue::TransportCatalogue& catalogue, renderer::MapRenderer& renderer, transport_router::TransportRouter& router) const {
-	Dict requests = json_doc_.GetRoot().AsMap();
+void JsonReader::ApplyStatRequests(const transport_catalogue::TransportCatalogue& catalogue, const renderer::MapRenderer& renderer,
+	const transport_router::TransportRouter& router) const {
+	view::Dict requests = json_doc_.GetRoot().AsMap();
 	if (!requests.count("stat_requests"s)) {
 		return;
 	}
-	Array stat_requests = requests.at("stat_requests"s).AsArray();
+	view::Array stat_requests = requests.at("stat_requests"s).AsArray();
 	if (stat_requests.empty()) {
 		return;
 	}
-	json::Builder result{};
-	result.StartArray();
-	for (const Node& request_node : stat_requests) {
-		Dict request = request_node.AsMap();
-		if (request.at("type"s).AsString() == "Bus"s) {
-			result.Value(PrepareBusStat(request, catalogue).AsMap());
-		}
-		if (request.at("type"s).AsString() == "Stop"s) {
-			result.Value(PrepareStopStat(request, catalogue).AsMap());
+
+	// responses are written out as soon as they are ready instead of being collected into one document
+	json::Writer writer(std::cout);
+	writer.StartArray();
+	const size_t thread_count = GetThreadCount(json_doc_, "stat_settings"sv);
+	if (thread_count == 1) {
+		for (const view::Node& request : stat_requests) {
+			WriteStat(request.AsMap(), catalogue, renderer, router, writer);
 		}
-		if (request.at("type"s).AsString() == "Map"s) {
-			auto buses = catalogue.GetBuses();
-			result.Value(PrepareMap(request, buses, renderer).AsMap());
+	}
+	else {
+		// requests only read the catalogue, renderer and router, so they are answered in any order
+		// into separate strings, each written out once the ones before it are
+		std::vector<std::promise<std::optional<std::string>>> responses(stat_requests.size());
+		thread_pool::ThreadPool pool(thread_count);
+		for (size_t index = 0; index < stat_requests.size(); ++index) {
+			pool.Submit([&, index] {
+				try {
+					std::string response;
+					json::Writer response_writer(response, json::Writer::INDENT_STEP);
+					if (!WriteStat(stat_requests[index].AsMap(), catalogue, renderer, router, response_writer)) {
+						responses[index].set_value(std::nullopt);
+						return;
+					}
+					responses[index].set_value(std::move(response));
+				}
+				catch (...) {
+					responses[index].set_exception(std::current_exception());
+				}
+			});
 		}
-		if (request.at("type"s).AsString() == "Route"s) {
-			result.Value(PrepareRouteStat(request, router).AsMap());
+		for (auto& response : responses) {
+			if (std::optional<std::string> text = response.get_future().get()) {
+				writer.RawValue(*text);
+			}
 		}
 	}
-	Print(Document{ result.EndArray().Build()}, std::cout);
+	writer.EndArray();
 }
 
-svg::Color JsonReader::CreateColorFromArray(const Array& shades, renderer::MapRenderer& renderer) const {
+svg::Color JsonReader::CreateColorFromArray(const view::Array& shades, renderer::MapRenderer& renderer) const {
 	if (shades.size() == 3) {
 		return renderer.CreateRgbColor(shades[0].AsInt(), shades[1].AsInt(), shades[2].AsInt());
 	}
@@ -201,11 +824,11 @@ svg::Color JsonReader::CreateColorFromArray(const Array& shades, renderer::MapRe
 }
 
 void JsonReader::ApplyRenderSettings(renderer::MapRenderer& renderer) const {
-	Dict requests = json_doc_.GetRoot().AsMap();
+	view::Dict requests = json_doc_.GetRoot().AsMap();
 	if (!requests.count("render_settings"s)) {
 		return;
 	}
-	Dict render_settings = requests.at("render_settings"s).AsMap();
+	view::Dict render_settings = requests.at("render_settings"s).AsMap();
 	renderer.width_ = render_settings.at("width"s).AsDouble();
 	renderer.height_ = render_settings.at("height"s).AsDouble();
 	renderer.padding_ = render_settings.at("padding"s).AsDouble();
@@ -216,30 +839,56 @@ void JsonReader::ApplyRenderSettings(renderer::MapRenderer& renderer) const {
 	renderer.stop_label_font_size_ = render_settings.at("stop_label_font_size"s).AsInt();
 	renderer.stop_label_offset_ = renderer.CreatePoint(render_settings.at("stop_label_offset"s).AsArray()[0].AsDouble(), render_settings.at("stop_label_offset"s).AsArray()[1].AsDouble());
 	if (render_settings.at("underlayer_color"s).IsString()) {
-		renderer.underlayer_color_ = render_settings.at("underlayer_color"s).AsString();
+		renderer.underlayer_color_ = std::string(render_settings.at("underlayer_color"s).AsString());
 	}
 	else if (render_settings.at("underlayer_color"s).IsArray()) {
 		renderer.underlayer_color_ = CreateColorFromArray(render_settings.at("underlayer_color"s).AsArray(), renderer);
 	}
 	renderer.underlayer_width_ = render_settings.at("underlayer_width"s).AsDouble();
-	for (const Node& color : render_settings.at("color_palette"s).AsArray()) {
+	for (const view::Node& color : render_settings.at("color_palette"s).AsArray()) {
 		if (color.IsString()) {
-			renderer.color_palette_.push_back(color.AsString());
+			renderer.color_palette_.push_back(std::string(color.AsString()));
 		}
 		else if (color.IsArray()) {
 			renderer.color_palette_.push_back(CreateColorFromArray(color.AsArray(), renderer));
 		}
 	}
+	// level of detail for overview maps; every part is optional and off by default
+	if (render_settings.count("lod"s)) {
+		view::Dict lod = render_settings.at("lod"s).AsMap();
+		if (lod.count("simplify_tolerance"s)) {
+			renderer.simplify_tolerance_ = lod.at("simplify_tolerance"s).AsDouble();
+		}
+		if (lod.count("merge_shared_segments"s)) {
+			renderer.merge_shared_segments_ = lod.at("merge_shared_segments"s).AsBool();
+		}
+		if (lod.count("min_stop_distance"s)) {
+			renderer.min_stop_distance_ = lod.at("min_stop_distance"s).AsDouble();
+		}
+	}
 }
 
 transport_router::TranspRouteParams JsonReader::GetRoutingSettings() const {
-	Dict requests = json_doc_.GetRoot().AsMap();
+	view::Dict requests = json_doc_.GetRoot().AsMap();
 	transport_router::TranspRouteParams params;
 	if (!requests.count("routing_settings"s)) {
 		return params;
 	}
-	Dict routing_settings = requests.at("routing_settings"s).AsMap();
+	view::Dict routing_settings = requests.at("routing_settings"s).AsMap();
 	params.bus_wait_time = routing_settings.at("bus_wait_time"s).AsInt();
 	params.bus_velocity = routing_settings.at("bus_velocity"s).AsDouble();
+	if (routing_settings.count("algorithm"s)) {
+		params.algorithm = detail::ParseRouterAlgorithm(routing_settings.at("algorithm"s).AsString());
+	}
 	return params;
 }
+
+serialization::SerializationSettings JsonReader::GetSerializationSettings() const {
+	view::Dict requests = json_doc_.GetRoot().AsMap();
+	serialization::SerializationSettings settings;
+	if (!requests.count("serialization_settings"s)) {
+		throw std::invalid_argument("serialization_settings are required");
+	}
+	settings.file = requests.at("serialization_settings"s).AsMap().at("file"s).AsString();
+	return settings;
+}
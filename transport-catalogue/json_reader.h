@@ -1,38 +1,60 @@
 #pragma once
+#include <string>
+#include <optional>
 #include <string_view>
 #include <vector>
 #include "json.h"
+#include "json_view.h"
+#include "json_writer.h"
 #include "transport_catalogue.h"
 #include "map_renderer.h"
 #include "transport_router.h"
+#include "serialization.h"
 
 using namespace json;
 
 namespace json_reader {
 	class JsonReader {
 	public:
-		JsonReader(std::istream& input)
-			: json_doc_(Load(input)) {}
+		JsonReader(std::istream& input);
+		// reads base_requests straight into the catalogue while parsing the stream through a fixed-size buffer,
+		// instead of keeping the input and the requests in memory
+		JsonReader(std::istream& input, transport_catalogue::TransportCatalogue& catalogue);
+
+		JsonReader(const JsonReader&) = delete;
+		JsonReader& operator=(const JsonReader&) = delete;
 
 		transport_router::TranspRouteParams GetRoutingSettings() const;
+		serialization::SerializationSettings GetSerializationSettings() const;
+		// build_settings.threads: threads to build the catalogue and the routing graph on (1 by default, 0 for one per hardware thread)
+		size_t GetBuildThreadCount() const;
+		// for a reader built without a catalogue; base requests may refer to stops defined after them.
+		// Ids follow the order of the requests whatever the number of threads
 		void ApplyBaseRequests(transport_catalogue::TransportCatalogue& catalogue) const;
 		void ApplyRenderSettings(renderer::MapRenderer& renderer) const;
-		void ApplyStatRequests(transport_catalogue::TransportCatalogue& catalogue, renderer::MapRenderer& renderer, transport_router::TransportRouter& router) const;
+		// answers stat_requests on stat_settings.threads threads (1 by default, 0 for one per hardware thread)
+		void ApplyStatRequests(const transport_catalogue::TransportCatalogue& catalogue, const renderer::MapRenderer& renderer,
+			const transport_router::TransportRouter& router) const;
 
 	private:
-		Document json_doc_;
-		void AddStopsToCatalogue(const Array& request_array, transport_catalogue::TransportCatalogue& catalogue) const;
-		void SetStopDistancesInCatalogue(const Array& request_array, transport_catalogue::TransportCatalogue& catalogue) const;
-		void AddBusesToCatalogue(const Array& request_array, transport_catalogue::TransportCatalogue& catalogue) const;
-		svg::Color CreateColorFromArray(const Array& shades, renderer::MapRenderer& renderer) const;
-		Node PrepareBusStat(const Dict& request, transport_catalogue::TransportCatalogue& catalogue) const;
-		Node PrepareStopStat(const Dict& request, transport_catalogue::TransportCatalogue& catalogue) const;
-		Node PrepareMap(const Dict& request, std::set<const Bus*, BusSetCmp>& buses, renderer::MapRenderer& renderer) const;
-		Node PrepareRouteStat(const Dict& request, transport_router::TransportRouter& router) const;
+		// without a catalogue the document refers to the input instead of copying its strings
+		std::string input_;
+		view::Document json_doc_;
+		static view::Document LoadWithBaseRequests(std::istream& input, transport_catalogue::TransportCatalogue& catalogue);
+		svg::Color CreateColorFromArray(const view::Array& shades, renderer::MapRenderer& renderer) const;
+		// returns false for an unknown request type, writing nothing
+		bool WriteStat(const view::Dict& request, const transport_catalogue::TransportCatalogue& catalogue,
+			const renderer::MapRenderer& renderer, const transport_router::TransportRouter& router, json::Writer& writer) const;
+		void WriteBusStat(const view::Dict& request, const transport_catalogue::TransportCatalogue& catalogue, json::Writer& writer) const;
+		void WriteStopStat(const view::Dict& request, const transport_catalogue::TransportCatalogue& catalogue, json::Writer& writer) const;
+		void WriteMap(const view::Dict& request, const transport_catalogue::TransportCatalogue& catalogue,
+			const renderer::MapRenderer& renderer, json::Writer& writer) const;
+		void WriteRouteStat(const view::Dict& request, const transport_router::TransportRouter& router, json::Writer& writer) const;
 	};
 	namespace detail {
-		std::vector<DistanceToStop> ParseDistanceToStop(const Node& stop_info);
-		std::vector<std::string_view> ParseRoute(const Node& route, bool is_roundtrip);
+		std::string ReadInput(std::istream& input);
+		std::vector<std::string_view> ExpandRoute(std::vector<std::string_view> stops, bool is_roundtrip);
+		graph::RouterAlgorithm ParseRouterAlgorithm(std::string_view algorithm);
 
 	}
 }
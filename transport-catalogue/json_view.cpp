@@ -0,0 +1,273 @@
+#include "json_view.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+
+using namespace std;
+
+namespace json::view {
+
+    namespace {
+
+        uint32_t CheckedSize(size_t size) {
+            if (size > numeric_limits<uint32_t>::max()) {
+                throw ParsingError("Value is too large"s);
+            }
+            return static_cast<uint32_t>(size);
+        }
+
+    }  // namespace
+
+    // ============ arena ============
+
+    void* Arena::AllocateBytes(size_t size, size_t alignment) {
+        size_t padding = current_ == nullptr ? 0 : (alignment - reinterpret_cast<uintptr_t>(current_) % alignment) % alignment;
+        if (current_ == nullptr || padding + size > left_) {
+            // large allocations get a block of their own
+            const size_t block_size = max(BLOCK_SIZE, size + alignment);
+            blocks_.push_back(make_unique<char[]>(block_size));
+            current_ = blocks_.back().get();
+            left_ = block_size;
+            padding = (alignment - reinterpret_cast<uintptr_t>(current_) % alignment) % alignment;
+        }
+        char* result = current_ + padding;
+        current_ = result + size;
+        left_ -= padding + size;
+        return result;
+    }
+
+    string_view Arena::CopyString(string_view value) {
+        char* data = Allocate<char>(value.size());
+        if (!value.empty()) {
+            memcpy(data, value.data(), value.size());
+        }
+        return { data, value.size() };
+    }
+
+    // ============ containers ============
+
+    const Node& Array::operator[](size_t index) const {
+        return items_[index];
+    }
+
+    const Node& Array::at(size_t index) const {
+        if (index >= size_) {
+            throw out_of_range("Index is out of array");
+        }
+        return items_[index];
+    }
+
+    const Member* Dict::find(string_view key) const {
+        const Member* it = lower_bound(begin(), end(), key,
+            [](const Member& member, string_view key) { return member.key < key; });
+        return it != end() && it->key == key ? it : end();
+    }
+
+    size_t Dict::count(string_view key) const {
+        return find(key) != end() ? 1 : 0;
+    }
+
+    const Node& Dict::at(string_view key) const {
+        const Member* it = find(key);
+        if (it == end()) {
+            throw out_of_range("Key is not found");
+        }
+        return it->value;
+    }
+
+    // ============ node ============
+
+    Node::Node(string_view value)
+        : type_(Type::STRING)
+        , size_(CheckedSize(value.size()))
+        , string_(value.data()) {
+    }
+
+    Node::Node(Array value)
+        : type_(Type::ARRAY)
+        , size_(CheckedSize(value.size()))
+        , items_(value.begin()) {
+    }
+
+    Node::Node(Dict value)
+        : type_(Type::DICT)
+        , size_(CheckedSize(value.size()))
+        , members_(value.begin()) {
+    }
+
+    bool Node::IsInt() const {
+        return type_ == Type::INT;
+    }
+    bool Node::IsDouble() const {
+        return IsInt() || IsPureDouble();
+    }
+    bool Node::IsPureDouble() const {
+        return type_ == Type::DOUBLE;
+    }
+    bool Node::IsBool() const {
+        return type_ == Type::BOOL;
+    }
+    bool Node::IsString() const {
+        return type_ == Type::STRING;
+    }
+    bool Node::IsNull() const {
+        return type_ == Type::NUL;
+    }
+    bool Node::IsArray() const {
+        return type_ == Type::ARRAY;
+    }
+    bool Node::IsMap() const {
+        return type_ == Type::DICT;
+    }
+
+    Array Node::AsArray() const {
+        if (IsArray()) {
+            return { items_, size_ };
+        }
+        throw logic_error("invalid type");
+    }
+    Dict Node::AsMap() const {
+        if (IsMap()) {
+            return { members_, size_ };
+        }
+        throw logic_error("invalid type");
+    }
+    int Node::AsInt() const {
+        if (IsInt()) {
+            return int_;
+        }
+        throw logic_error("invalid type");
+    }
+    string_view Node::AsString() const {
+        if (IsString()) {
+            return { string_, size_ };
+        }
+        throw logic_error("invalid type");
+    }
+    bool Node::AsBool() const {
+        if (IsBool()) {
+            return bool_;
+        }
+        throw logic_error("invalid type");
+    }
+    double Node::AsDouble() const {
+        if (IsDouble()) {
+            return IsPureDouble() ? double_ : static_cast<double>(int_);
+        }
+        throw logic_error("invalid type");
+    }
+
+    // ============ document ============
+
+    Document::Document(Arena arena, Node root)
+        : arena_(move(arena))
+        , root_(root) {
+    }
+
+    const Node& Document::GetRoot() const {
+        return root_;
+    }
+
+    DocumentBuilder::DocumentBuilder(string_view input)
+        : input_(input) {
+    }
+
+    string_view DocumentBuilder::Keep(string_view value) {
+        // unescaped strings live in the parser's scratch buffer
+        const less_equal<const char*> not_after;
+        if (not_after(input_.data(), value.data()) && not_after(value.data() + value.size(), input_.data() + input_.size())) {
+            return value;
+        }
+        return arena_.CopyString(value);
+    }
+
+    void DocumentBuilder::Add(Node value) {
+        if (frames_.empty()) {
+            root_ = value;
+        }
+        else if (frames_.back().is_dict) {
+            members_.push_back({ key_, value });
+        }
+        else {
+            values_.push_back(value);
+        }
+    }
+
+    void DocumentBuilder::StartDict() {
+        frames_.push_back({ true, members_.size(), key_ });
+    }
+
+    void DocumentBuilder::Key(string_view key) {
+        key_ = Keep(key);
+    }
+
+    void DocumentBuilder::EndDict() {
+        const Frame frame = frames_.back();
+        frames_.pop_back();
+        const auto first = members_.begin() + frame.start;
+        // equal keys are rejected below, so the sort need not be stable
+        sort(first, members_.end(), [](const Member& lhs, const Member& rhs) { return lhs.key < rhs.key; });
+        const auto duplicate = adjacent_find(first, members_.end(),
+            [](const Member& lhs, const Member& rhs) { return lhs.key == rhs.key; });
+        if (duplicate != members_.end()) {
+            throw ParsingError("duplicate key '"s + string(duplicate->key) + "'found");
+        }
+
+        const size_t size = members_.end() - first;
+        Member* members = arena_.Allocate<Member>(size);
+        uninitialized_copy(first, members_.end(), members);
+        members_.erase(first, members_.end());
+        key_ = frame.key;
+        Add(Dict(members, size));
+    }
+
+    void DocumentBuilder::StartArray() {
+        frames_.push_back({ false, values_.size(), key_ });
+    }
+
+    void DocumentBuilder::EndArray() {
+        const Frame frame = frames_.back();
+        frames_.pop_back();
+        const auto first = values_.begin() + frame.start;
+        const size_t size = values_.end() - first;
+        Node* items = arena_.Allocate<Node>(size);
+        uninitialized_copy(first, values_.end(), items);
+        values_.erase(first, values_.end());
+        key_ = frame.key;
+        Add(Array(items, size));
+    }
+
+    void DocumentBuilder::Null() {
+        Add(Node(nullptr));
+    }
+
+    void DocumentBuilder::Bool(bool value) {
+        Add(Node(value));
+    }
+
+    void DocumentBuilder::Int(int value) {
+        Add(Node(value));
+    }
+
+    void DocumentBuilder::Double(double value) {
+        Add(Node(value));
+    }
+
+    void DocumentBuilder::String(string_view value) {
+        Add(Node(Keep(value)));
+    }
+
+    Document DocumentBuilder::Build() {
+        return Document(move(arena_), root_);
+    }
+
+    Document Load(string_view input) {
+        DocumentBuilder builder(input);
+        Parse(input, builder);
+        return builder.Build();
+    }
+
+}  // namespace json::view
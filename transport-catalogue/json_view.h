@@ -0,0 +1,229 @@
+#pragma once
+
+#include "json.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+// Read-only JSON document that does not copy the input: strings are views into it,
+// and arrays and dicts are allocated from an arena owned by the document
+namespace json::view {
+
+    // Bump allocator, memory is released all at once with the arena
+    class Arena {
+    public:
+        Arena() = default;
+        Arena(const Arena&) = delete;
+        Arena& operator=(const Arena&) = delete;
+        Arena(Arena&&) = default;
+        Arena& operator=(Arena&&) = default;
+
+        template <typename T>
+        T* Allocate(size_t count) {
+            static_assert(std::is_trivially_destructible_v<T>, "arena never runs destructors");
+            return static_cast<T*>(AllocateBytes(count * sizeof(T), alignof(T)));
+        }
+
+        std::string_view CopyString(std::string_view value);
+
+    private:
+        static constexpr size_t BLOCK_SIZE = 64 * 1024;
+
+        std::vector<std::unique_ptr<char[]>> blocks_;
+        char* current_ = nullptr;
+        size_t left_ = 0;
+
+        void* AllocateBytes(size_t size, size_t alignment);
+    };
+
+    class Node;
+    struct Member;
+
+    class Array {
+    public:
+        Array() = default;
+        Array(const Node* items, size_t size)
+            : items_(items)
+            , size_(size) {
+        }
+
+        const Node* begin() const {
+            return items_;
+        }
+        const Node* end() const;
+        size_t size() const {
+            return size_;
+        }
+        bool empty() const {
+            return size_ == 0;
+        }
+        const Node& operator[](size_t index) const;
+        const Node& at(size_t index) const;
+
+    private:
+        const Node* items_ = nullptr;
+        size_t size_ = 0;
+    };
+
+    // Members are sorted by key, so iteration goes in the same order as over json::Dict
+    class Dict {
+    public:
+        Dict() = default;
+        Dict(const Member* members, size_t size)
+            : members_(members)
+            , size_(size) {
+        }
+
+        const Member* begin() const {
+            return members_;
+        }
+        const Member* end() const;
+        size_t size() const {
+            return size_;
+        }
+        bool empty() const {
+            return size_ == 0;
+        }
+        const Member* find(std::string_view key) const;
+        size_t count(std::string_view key) const;
+        const Node& at(std::string_view key) const;
+
+    private:
+        const Member* members_ = nullptr;
+        size_t size_ = 0;
+    };
+
+    class Node final {
+    public:
+        Node() = default;
+        Node(std::nullptr_t) {
+        }
+        Node(bool value)
+            : type_(Type::BOOL)
+            , bool_(value) {
+        }
+        Node(int value)
+            : type_(Type::INT)
+            , int_(value) {
+        }
+        Node(double value)
+            : type_(Type::DOUBLE)
+            , double_(value) {
+        }
+        Node(std::string_view value);
+        Node(Array value);
+        Node(Dict value);
+
+        bool IsInt() const;
+        bool IsDouble() const;
+        bool IsPureDouble() const;
+        bool IsBool() const;
+        bool IsString() const;
+        bool IsNull() const;
+        bool IsArray() const;
+        bool IsMap() const;
+
+        Array AsArray() const;
+        Dict AsMap() const;
+        int AsInt() const;
+        std::string_view AsString() const;
+        bool AsBool() const;
+        double AsDouble() const;
+
+    private:
+        enum class Type : uint8_t {
+            NUL,
+            BOOL,
+            INT,
+            DOUBLE,
+            STRING,
+            ARRAY,
+            DICT
+        };
+
+        Type type_ = Type::NUL;
+        // length of a string, element count of an array or a dict
+        uint32_t size_ = 0;
+        union {
+            bool bool_;
+            int int_;
+            double double_;
+            const char* string_;
+            const Node* items_;
+            const Member* members_ = nullptr;
+        };
+    };
+
+    struct Member {
+        std::string_view key;
+        Node value;
+    };
+
+    inline const Node* Array::end() const {
+        return items_ + size_;
+    }
+
+    inline const Member* Dict::end() const {
+        return members_ + size_;
+    }
+
+    class Document {
+    public:
+        Document() = default;
+        Document(Arena arena, Node root);
+
+        const Node& GetRoot() const;
+
+    private:
+        Arena arena_;
+        Node root_;
+    };
+
+    // Builds a document from parser events. Strings outside of the input are copied into the arena
+    class DocumentBuilder final : public EventHandler {
+    public:
+        explicit DocumentBuilder(std::string_view input);
+
+        void StartDict() override;
+        void Key(std::string_view key) override;
+        void EndDict() override;
+        void StartArray() override;
+        void EndArray() override;
+        void Null() override;
+        void Bool(bool value) override;
+        void Int(int value) override;
+        void Double(double value) override;
+        void String(std::string_view value) override;
+
+        Document Build();
+
+    private:
+        struct Frame {
+            bool is_dict;
+            // first value or member of the container on the stacks below
+            size_t start;
+            // key of the container in its parent dict
+            std::string_view key;
+        };
+
+        std::string_view input_;
+        Arena arena_;
+        Node root_;
+        std::vector<Frame> frames_;
+        // values of the unfinished containers
+        std::vector<Node> values_;
+        std::vector<Member> members_;
+        std::string_view key_;
+
+        std::string_view Keep(std::string_view value);
+        void Add(Node value);
+    };
+
+    // The input has to outlive the document
+    Document Load(std::string_view input);
+
+}  // namespace json::view
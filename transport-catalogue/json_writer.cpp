@@ -0,0 +1,296 @@
+#include "json_writer.h"
+
+#include <charconv>
+#include <cstring>
+#include <stdexcept>
+
+using namespace std;
+
+namespace json {
+
+    namespace {
+
+        // the same as in Print: \r, \n and \t are spelled out, " and \ get a backslash
+        void WriteEscaped(string_view value, BufferedOutput& output) {
+            size_t plain_start = 0;
+            for (size_t i = 0; i < value.size(); ++i) {
+                const char c = value[i];
+                const char* escaped = nullptr;
+                switch (c) {
+                case '\r':
+                    escaped = "\\r";
+                    break;
+                case '\n':
+                    escaped = "\\n";
+                    break;
+                case '\t':
+                    escaped = "\\t";
+                    break;
+                case '"':
+                    escaped = "\\\"";
+                    break;
+                case '\\':
+                    escaped = "\\\\";
+                    break;
+                default:
+                    continue;
+                }
+                output.Write(value.substr(plain_start, i - plain_start));
+                output.Write(escaped);
+                plain_start = i + 1;
+            }
+            output.Write(value.substr(plain_start));
+        }
+
+        void WriteString(string_view value, BufferedOutput& output) {
+            output.Put('"');
+            WriteEscaped(value, output);
+            output.Put('"');
+        }
+
+        void WriteInt(int value, BufferedOutput& output) {
+            char buffer[16];
+            const auto result = to_chars(begin(buffer), end(buffer), value);
+            output.Write({ buffer, static_cast<size_t>(result.ptr - buffer) });
+        }
+
+        // printf("%g") of to_chars with precision 6 is what ostream << double prints by default
+        void WriteDouble(double value, BufferedOutput& output) {
+            char buffer[32];
+            const auto result = to_chars(begin(buffer), end(buffer), value, chars_format::general, 6);
+            output.Write({ buffer, static_cast<size_t>(result.ptr - buffer) });
+        }
+
+    }  // namespace
+
+    // ========= buffered output ==============
+
+    BufferedOutput::BufferedOutput(ostream& output)
+        : stream_(&output)
+        , buffer_(make_unique<char[]>(CAPACITY)) {
+    }
+
+    BufferedOutput::BufferedOutput(string& output)
+        : string_(&output) {
+    }
+
+    BufferedOutput::~BufferedOutput() {
+        Flush();
+    }
+
+    void BufferedOutput::Write(string_view text) {
+        if (string_ != nullptr) {
+            string_->append(text);
+            return;
+        }
+        if (size_ + text.size() > CAPACITY) {
+            Flush();
+            // large pieces skip the buffer
+            if (text.size() >= CAPACITY) {
+                stream_->write(text.data(), text.size());
+                return;
+            }
+        }
+        if (!text.empty()) {
+            memcpy(buffer_.get() + size_, text.data(), text.size());
+            size_ += text.size();
+        }
+    }
+
+    void BufferedOutput::Flush() {
+        if (size_ > 0) {
+            stream_->write(buffer_.get(), size_);
+            size_ = 0;
+        }
+    }
+
+    // ========= writer ==============
+
+    Writer::Writer(ostream& output, int indent)
+        : output_(output)
+        , base_indent_(indent) {
+    }
+
+    Writer::Writer(string& output, int indent)
+        : output_(output)
+        , base_indent_(indent) {
+    }
+
+    int Writer::GetIndent() const {
+        return base_indent_ + static_cast<int>(levels_.size()) * INDENT_STEP;
+    }
+
+    void Writer::WriteIndent(int indent) {
+        for (int i = 0; i < indent; ++i) {
+            output_.Put(' ');
+        }
+    }
+
+    void Writer::StartValue() {
+        if (levels_.empty()) {
+            return;
+        }
+        Level& level = levels_.back();
+        if (level.is_dict) {
+            if (!has_key_) {
+                throw logic_error("Value in a dict without a key");
+            }
+            has_key_ = false;
+            return;
+        }
+        if (!level.is_empty) {
+            output_.Write(",\n"sv);
+        }
+        level.is_empty = false;
+        WriteIndent(GetIndent());
+    }
+
+    Writer& Writer::StartDict() {
+        StartValue();
+        output_.Write("{\n"sv);
+        levels_.push_back({ true, true });
+        return *this;
+    }
+
+    Writer& Writer::Key(string_view key) {
+        if (levels_.empty() || !levels_.back().is_dict || has_key_) {
+            throw logic_error("Key outside of a dict");
+        }
+        Level& level = levels_.back();
+        if (!level.is_empty) {
+            output_.Write(",\n"sv);
+        }
+        level.is_empty = false;
+        WriteIndent(GetIndent());
+        WriteString(key, output_);
+        output_.Write(": "sv);
+        has_key_ = true;
+        return *this;
+    }
+
+    Writer& Writer::EndDict() {
+        if (levels_.empty() || !levels_.back().is_dict || has_key_) {
+            throw logic_error("EndDict without a dict");
+        }
+        levels_.pop_back();
+        output_.Put('\n');
+        WriteIndent(GetIndent());
+        output_.Put('}');
+        return *this;
+    }
+
+    Writer& Writer::StartArray() {
+        StartValue();
+        output_.Write("[\n"sv);
+        levels_.push_back({ false, true });
+        return *this;
+    }
+
+    Writer& Writer::EndArray() {
+        if (levels_.empty() || levels_.back().is_dict) {
+            throw logic_error("EndArray without an array");
+        }
+        levels_.pop_back();
+        output_.Put('\n');
+        WriteIndent(GetIndent());
+        output_.Put(']');
+        return *this;
+    }
+
+    Writer& Writer::Value(string_view value) {
+        StartValue();
+        WriteString(value, output_);
+        return *this;
+    }
+
+    Writer& Writer::Value(int value) {
+        StartValue();
+        WriteInt(value, output_);
+        return *this;
+    }
+
+    Writer& Writer::Value(double value) {
+        StartValue();
+        WriteDouble(value, output_);
+        return *this;
+    }
+
+    Writer& Writer::Value(bool value) {
+        StartValue();
+        output_.Write(value ? "true"sv : "false"sv);
+        return *this;
+    }
+
+    Writer& Writer::Null() {
+        StartValue();
+        output_.Write("null"sv);
+        return *this;
+    }
+
+    Writer& Writer::WriteNode(const Node& node) {
+        StartValue();
+        PrintNode(node, GetIndent());
+        return *this;
+    }
+
+    Writer& Writer::RawValue(string_view json) {
+        StartValue();
+        output_.Write(json);
+        return *this;
+    }
+
+    void Writer::Flush() {
+        output_.Flush();
+    }
+
+    void Writer::PrintNode(const Node& node, int indent) {
+        if (node.IsInt()) {
+            WriteInt(node.AsInt(), output_);
+        }
+        else if (node.IsPureDouble()) {
+            WriteDouble(node.AsDouble(), output_);
+        }
+        else if (node.IsString()) {
+            WriteString(node.AsString(), output_);
+        }
+        else if (node.IsNull()) {
+            output_.Write("null"sv);
+        }
+        else if (node.IsBool()) {
+            output_.Write(node.AsBool() ? "true"sv : "false"sv);
+        }
+        else if (node.IsArray()) {
+            output_.Write("[\n"sv);
+            bool first = true;
+            for (const Node& item : node.AsArray()) {
+                if (!first) {
+                    output_.Write(",\n"sv);
+                }
+                first = false;
+                WriteIndent(indent + INDENT_STEP);
+                PrintNode(item, indent + INDENT_STEP);
+            }
+            output_.Put('\n');
+            WriteIndent(indent);
+            output_.Put(']');
+        }
+        else {
+            output_.Write("{\n"sv);
+            bool first = true;
+            for (const auto& [key, value] : node.AsMap()) {
+                if (!first) {
+                    output_.Write(",\n"sv);
+                }
+                first = false;
+                WriteIndent(indent + INDENT_STEP);
+                WriteString(key, output_);
+                output_.Write(": "sv);
+                PrintNode(value, indent + INDENT_STEP);
+            }
+            output_.Put('\n');
+            WriteIndent(indent);
+            output_.Put('}');
+        }
+    }
+
+}  // namespace json
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "json.h"
+
+#include <memory>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace json {
+
+    // Collects output in a fixed buffer and passes it on in large writes
+    class BufferedOutput {
+    public:
+        explicit BufferedOutput(std::ostream& output);
+        // appends to the string directly, it needs no buffering
+        explicit BufferedOutput(std::string& output);
+        ~BufferedOutput();
+
+        BufferedOutput(const BufferedOutput&) = delete;
+        BufferedOutput& operator=(const BufferedOutput&) = delete;
+
+        void Put(char c) {
+            if (string_ != nullptr) {
+                string_->push_back(c);
+                return;
+            }
+            if (size_ == CAPACITY) {
+                Flush();
+            }
+            buffer_[size_++] = c;
+        }
+        void Write(std::string_view text);
+        void Flush();
+
+    private:
+        static constexpr size_t CAPACITY = 64 * 1024;
+
+        std::ostream* stream_ = nullptr;
+        std::string* string_ = nullptr;
+        std::unique_ptr<char[]> buffer_;
+        size_t size_ = 0;
+    };
+
+    // Writes JSON as it goes, in exactly the format of Print, without building Nodes.
+    // Print sorts keys, so keys of a dict have to be written in ascending order
+    class Writer {
+    public:
+        static constexpr int INDENT_STEP = 4;
+
+        // indent is the one of the first written value, e.g. INDENT_STEP for an item
+        // of a top-level array later passed to RawValue
+        explicit Writer(std::ostream& output, int indent = 0);
+        explicit Writer(std::string& output, int indent = 0);
+
+        Writer& StartDict();
+        Writer& Key(std::string_view key);
+        Writer& EndDict();
+        Writer& StartArray();
+        Writer& EndArray();
+
+        Writer& Value(std::string_view value);
+        Writer& Value(const char* value) {
+            return Value(std::string_view(value));
+        }
+        Writer& Value(int value);
+        Writer& Value(double value);
+        Writer& Value(bool value);
+        Writer& Null();
+        Writer& WriteNode(const Node& node);
+        // a value already formatted by another Writer with the same indent
+        Writer& RawValue(std::string_view json);
+
+        void Flush();
+
+    private:
+        struct Level {
+            bool is_dict;
+            bool is_empty;
+        };
+
+        BufferedOutput output_;
+        int base_indent_;
+        std::vector<Level> levels_;
+        bool has_key_ = false;
+
+        int GetIndent() const;
+        void WriteIndent(int indent);
+        void StartValue();
+        void PrintNode(const Node& node, int indent);
+    };
+
+}  // namespace json
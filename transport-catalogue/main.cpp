@@ -1,8 +1,10 @@
 #include <iostream>
 #include <fstream>
 #include <string>
+#include <string_view>
 
 #include "json_reader.h"
+#include "serialization.h"
 
 using namespace std;
 using namespace json_reader;
@@ -10,15 +12,52 @@ using namespace renderer;
 using namespace transport_router;
 using namespace transport_catalogue;
 
-int main() {
+void PrintUsage(std::ostream& stream = std::cerr) {
+    stream << "Usage: transport_catalogue [make_base|process_requests]\n"sv;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc > 2) {
+        PrintUsage();
+        return 1;
+    }
+    const std::string_view mode = argc == 2 ? argv[1] : ""sv;
+
+    if (mode.empty()) {
+        TransportCatalogue catalogue;
+        JsonReader json_reader{ cin, catalogue };
+        MapRenderer renderer;
+        json_reader.ApplyRenderSettings(renderer);
+        TranspRouteParams params = json_reader.GetRoutingSettings();
+        TransportRouter router{ catalogue, params, json_reader.GetBuildThreadCount() };
+
+        json_reader.ApplyStatRequests(catalogue, renderer, router);
+    }
+    else if (mode == "make_base"sv) {
+        // builds the catalogue and the routing structures once and saves them to the snapshot file
+        TransportCatalogue catalogue;
+        JsonReader json_reader{ cin, catalogue };
+        MapRenderer renderer;
+        json_reader.ApplyRenderSettings(renderer);
+        TransportRouter router{ catalogue, json_reader.GetRoutingSettings(), json_reader.GetBuildThreadCount() };
 
-    JsonReader json_reader{ cin };
-    TransportCatalogue catalogue;
-    json_reader.ApplyBaseRequests(catalogue);
-    MapRenderer renderer;
-    json_reader.ApplyRenderSettings(renderer);
-    TranspRouteParams params = json_reader.GetRoutingSettings();
-    TransportRouter router{ catalogue, params };
+        serialization::SaveSnapshot(json_reader.GetSerializationSettings(), catalogue, renderer, router);
+    }
+    else if (mode == "process_requests"sv) {
+        // answers stat_requests from the snapshot without rebuilding the routing structures
+        JsonReader json_reader{ cin };
+        serialization::Snapshot snapshot{ json_reader.GetSerializationSettings() };
+        TransportCatalogue catalogue;
+        snapshot.LoadCatalogue(catalogue);
+        MapRenderer renderer;
+        snapshot.LoadRenderSettings(renderer);
+        TransportRouter router{ catalogue, snapshot.GetRoutingSettings(), snapshot.GetRoutingGraph(),
+            snapshot.GetContractionHierarchy(), snapshot.GetAllPairsTable(), json_reader.GetBuildThreadCount() };
 
-    json_reader.ApplyStatRequests(catalogue, renderer, router);
+        json_reader.ApplyStatRequests(catalogue, renderer, router);
+    }
+    else {
+        PrintUsage();
+        return 1;
+    }
 }
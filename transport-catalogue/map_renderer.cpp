@@ -1,6 +1,15 @@
 ﻿#include "map_renderer.h"
 #include "request_handler.h"
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+
 using namespace svg;
 using namespace renderer;
 using namespace std::literals;
@@ -10,6 +19,104 @@ bool renderer::IsZero(double value) {
 	return std::abs(value) < EPSILON;
 }
 
+namespace {
+
+	// столько подряд перекрытых отрезков выгоднее пропустить, чем рисовать, ценой разрыва ломаной
+	constexpr size_t MIN_ROUTE_GAP = 8;
+
+	double GetDistanceToSegment(Point point, Point from, Point to) {
+		const double dx = to.x - from.x;
+		const double dy = to.y - from.y;
+		const double length_squared = dx * dx + dy * dy;
+		// ближайшая к точке точка отрезка from + t * (to - from)
+		const double t = length_squared > 0
+			? std::clamp(((point.x - from.x) * dx + (point.y - from.y) * dy) / length_squared, 0.0, 1.0)
+			: 0.0;
+		return std::hypot(point.x - (from.x + t * dx), point.y - (from.y + t * dy));
+	}
+
+	// Дуглас — Пекер: концы остаются, между ними оставляется самая далёкая от хорды точка,
+	// если она отходит от хорды больше чем на tolerance, и так же делятся обе половины
+	std::vector<Point> SimplifyPolyline(const std::vector<Point>& points, double tolerance) {
+		if (points.size() < 3) {
+			return points;
+		}
+		std::vector<bool> is_kept(points.size(), false);
+		is_kept.front() = true;
+		is_kept.back() = true;
+		std::vector<std::pair<size_t, size_t>> parts{ { 0, points.size() - 1 } };
+		while (!parts.empty()) {
+			const auto [first, last] = parts.back();
+			parts.pop_back();
+			double max_distance = 0;
+			size_t farthest = first;
+			for (size_t i = first + 1; i < last; ++i) {
+				const double distance = GetDistanceToSegment(points[i], points[first], points[last]);
+				if (distance > max_distance) {
+					max_distance = distance;
+					farthest = i;
+				}
+			}
+			if (max_distance > tolerance) {
+				is_kept[farthest] = true;
+				parts.push_back({ first, farthest });
+				parts.push_back({ farthest, last });
+			}
+		}
+		std::vector<Point> result;
+		for (size_t i = 0; i < points.size(); ++i) {
+			if (is_kept[i]) {
+				result.push_back(points[i]);
+			}
+		}
+		return result;
+	}
+
+	// Отбирает точки не ближе distance к уже отобранным. Отобранные точки лежат в ячейках
+	// со стороной distance, так что близкие к новой точке находятся в её ячейке или соседних
+	class SparsePoints {
+	public:
+		explicit SparsePoints(double distance)
+			: distance_(distance) {
+		}
+
+		// добавляет точку, если рядом нет отобранных
+		bool TryAdd(Point point) {
+			const int64_t column = static_cast<int64_t>(std::floor(point.x / distance_));
+			const int64_t row = static_cast<int64_t>(std::floor(point.y / distance_));
+			for (int64_t dx = -1; dx <= 1; ++dx) {
+				for (int64_t dy = -1; dy <= 1; ++dy) {
+					const auto it = cells_.find(GetCellKey(column + dx, row + dy));
+					if (it == cells_.end()) {
+						continue;
+					}
+					for (const Point& other : it->second) {
+						if (std::hypot(point.x - other.x, point.y - other.y) < distance_) {
+							return false;
+						}
+					}
+				}
+			}
+			cells_[GetCellKey(column, row)].push_back(point);
+			return true;
+		}
+
+	private:
+		double distance_;
+		std::unordered_map<uint64_t, std::vector<Point>> cells_;
+
+		static uint64_t GetCellKey(int64_t column, int64_t row) {
+			return (static_cast<uint64_t>(column) << 32) ^ static_cast<uint32_t>(row);
+		}
+	};
+
+	uint64_t GetSegmentKey(uint32_t from, uint32_t to) {
+		// направление отрезка не важно
+		return (static_cast<uint64_t>(std::min(from, to)) << 32) | std::max(from, to);
+	}
+
+}
+
 Point MapRenderer::CreatePoint(double dx, double dy) const {
 	return Point{ dx, dy };
 }
@@ -24,96 +131,134 @@ Color MapRenderer::CreateRgbaColor(int red_shade, int green_shade, int blue_shad
 
 
 
-Polyline MapRenderer::RenderRoute(std::vector<StopPoint> stops_points, Color route_color) const {
+Polyline MapRenderer::RenderRoute(const std::vector<Point>& points, const Color& route_color) const {
 	Polyline route;
-	for (const auto& stop_point : stops_points) {
-		route.AddPoint(stop_point.point);
+	route.Reserve(points.size());
+	for (const Point& point : points) {
+		route.AddPoint(point);
 	}
-	return route.SetStrokeColor(route_color).SetFillColor(NoneColor).SetStrokeWidth(line_width_).SetStrokeLineCap(StrokeLineCap::ROUND).SetStrokeLineJoin(StrokeLineJoin::ROUND);
+	// цепочка сеттеров возвращает ссылку, поэтому объект возвращается отдельно, без копирования точек
+	route.SetStrokeColor(route_color).SetFillColor(NoneColor).SetStrokeWidth(line_width_).SetStrokeLineCap(StrokeLineCap::ROUND).SetStrokeLineJoin(StrokeLineJoin::ROUND);
+	return route;
 }
 
-Text MapRenderer::RenderCommonBusTextProps(const Point& point, std::string bus_name) const {
-	return Text().SetPosition(point)
+Text MapRenderer::RenderCommonBusTextProps(const Point& point, std::string_view bus_name) const {
+	Text text;
+	text.SetPosition(point)
 		.SetOffset(bus_label_offset_)
 		.SetFontSize(bus_label_font_size_)
 		.SetFontFamily("Verdana"s)
 		.SetFontWeight("bold"s)
-		.SetData(bus_name);
+		.SetData(std::string(bus_name));
+	return text;
 }
 
-Text MapRenderer::RenderBusNameUnderlayer(const Point& point, std::string bus_name) const {
-	 return RenderCommonBusTextProps(point, bus_name)
-		.SetFillColor(underlayer_color_)
+Text MapRenderer::RenderBusNameUnderlayer(const Point& point, std::string_view bus_name) const {
+	Text text = RenderCommonBusTextProps(point, bus_name);
+	text.SetFillColor(underlayer_color_)
 		.SetStrokeColor(underlayer_color_)
 		.SetStrokeWidth(underlayer_width_)
 		.SetStrokeLineCap(StrokeLineCap::ROUND)
 		.SetStrokeLineJoin(StrokeLineJoin::ROUND);
+	return text;
 }
 
-Text MapRenderer::RenderBusNameText(const Point& point, std::string bus_name, Color route_color) const {
-	return RenderCommonBusTextProps(point, bus_name).SetFillColor(route_color);
+Text MapRenderer::RenderBusNameText(const Point& point, std::string_view bus_name, const Color& route_color) const {
+	Text text = RenderCommonBusTextProps(point, bus_name);
+	text.SetFillColor(route_color);
+	return text;
 }
 
 Circle MapRenderer::RenderStop(const svg::Point& point) const {
 	return Circle().SetCenter(point).SetRadius(stop_radius_).SetFillColor("white"s);
 }
 
-Text MapRenderer::RenderCommonStopTextProps(const StopPoint& stop) const {
-	return Text().SetPosition(stop.point)
+Text MapRenderer::RenderCommonStopTextProps(const Point& point, std::string_view stop_name) const {
+	Text text;
+	text.SetPosition(point)
 		.SetOffset(stop_label_offset_)
 		.SetFontSize(stop_label_font_size_)
 		.SetFontFamily("Verdana"s)
-		.SetData(stop.name);
+		.SetData(std::string(stop_name));
+	return text;
 }
 
-Text MapRenderer::RenderStopNameUnderlayer(const StopPoint& stop) const {
-	return RenderCommonStopTextProps(stop)
-		.SetFillColor(underlayer_color_)
+Text MapRenderer::RenderStopNameUnderlayer(const Point& point, std::string_view stop_name) const {
+	Text text = RenderCommonStopTextProps(point, stop_name);
+	text.SetFillColor(underlayer_color_)
 		.SetStrokeColor(underlayer_color_)
 		.SetStrokeWidth(underlayer_width_)
 		.SetStrokeLineCap(StrokeLineCap::ROUND)
 		.SetStrokeLineJoin(StrokeLineJoin::ROUND);
+	return text;
 }
 
-Text MapRenderer::RenderStopNameText(const StopPoint& stop) const {
-	return RenderCommonStopTextProps(stop).SetFillColor("black"s);
+Text MapRenderer::RenderStopNameText(const Point& point, std::string_view stop_name) const {
+	Text text = RenderCommonStopTextProps(point, stop_name);
+	text.SetFillColor("black"s);
+	return text;
 }
 
-SphereProjector MapRenderer::ProjectStops(std::set<const Bus*, BusSetCmp>& buses) const {
-	std::vector<geo::Coordinates> geo_coords;
-	// пройдемся по автобусам, что записать все нужные координаты остановок
+MapRenderer::MapLayout MapRenderer::MakeLayout(const transport_catalogue::TransportCatalogue& catalogue, ranges::Range<const Bus* const*> buses) const {
+	MapLayout layout;
+	// индекс остановки в раскладке по её id в справочнике
+	constexpr uint32_t NO_INDEX = std::numeric_limits<uint32_t>::max();
+	std::vector<uint32_t> stop_indices(catalogue.GetStops().size(), NO_INDEX);
+	layout.route_offsets.push_back(0);
+	// один проход по маршрутам: каждая остановка получает индекс при первой встрече
 	for (const Bus* bus : buses) {
-		for (const Stop* stop : bus->route) {
-			geo_coords.emplace_back(geo::Coordinates{ stop->coordinates.lat, stop->coordinates.lng });
+		if (bus->route_size == 0) {
+			continue;
 		}
+		layout.buses.push_back(bus);
+		for (const StopId stop_id : catalogue.GetRoute(*bus)) {
+			if (stop_indices[stop_id] == NO_INDEX) {
+				stop_indices[stop_id] = static_cast<uint32_t>(layout.stops.size());
+				layout.stops.push_back(&catalogue.GetStop(stop_id));
+			}
+			layout.route_stops.push_back(stop_indices[stop_id]);
+		}
+		layout.route_offsets.push_back(layout.route_stops.size());
 	}
-	return SphereProjector{
-		geo_coords.begin(), geo_coords.end(), width_, height_, padding_
-	};
-}
 
-std::vector<MapRenderer::StopPoint> MapRenderer::PrepareStopPointsForRoute(const std::vector<Stop*> bus_route, const SphereProjector proj) const {
-	std::vector<StopPoint> result;
-	for (const Stop* stop : bus_route) {
-		result.emplace_back(StopPoint{ stop->name, proj(geo::Coordinates{ stop->coordinates.lat, stop->coordinates.lng }) });
+	// границы карты зависят только от набора остановок, повторы на них не влияют
+	std::vector<geo::Coordinates> geo_coords;
+	geo_coords.reserve(layout.stops.size());
+	for (const Stop* stop : layout.stops) {
+		geo_coords.push_back(stop->coordinates);
+	}
+	const SphereProjector proj{ geo_coords.begin(), geo_coords.end(), width_, height_, padding_ };
+	layout.points.reserve(geo_coords.size());
+	for (const geo::Coordinates& coords : geo_coords) {
+		layout.points.push_back(proj(coords));
 	}
-	return result;
-}
-
-std::set<MapRenderer::StopPoint, MapRenderer::StopPointCmp> MapRenderer::PrepareSortedUniqueStopPoints(std::set<const Bus*, BusSetCmp>& buses, const SphereProjector proj) const {
-	std::set<StopPoint, StopPointCmp> result;
-	for (const Bus* bus : buses) {
-		if (!bus->route.empty()) {
-			// запишем плоскостные точки маршрута
-			std::vector<StopPoint> stops_points = PrepareStopPointsForRoute(bus->route, proj);
 
-			// запишем уникальные остановки в отсортированном виде
-			for (const auto& stop_point : stops_points) {
-				result.emplace(StopPoint{ stop_point });
+	layout.stops_by_name.resize(layout.stops.size());
+	std::iota(layout.stops_by_name.begin(), layout.stops_by_name.end(), 0);
+	std::sort(layout.stops_by_name.begin(), layout.stops_by_name.end(), [&layout](uint32_t lhs, uint32_t rhs) {
+		return layout.stops[lhs]->name < layout.stops[rhs]->name;
+	});
+
+	if (merge_shared_segments_) {
+		// маршруты рисуются по порядку, так что из всех проходов по отрезку виден последний
+		// отрезок i идёт от route_stops[i - 1] к route_stops[i], первая остановка маршрута отрезка не начинает
+		auto for_each_segment = [&layout](auto action) {
+			for (size_t bus_index = 0; bus_index < layout.buses.size(); ++bus_index) {
+				for (size_t i = layout.route_offsets[bus_index] + 1; i < layout.route_offsets[bus_index + 1]; ++i) {
+					action(i, GetSegmentKey(layout.route_stops[i - 1], layout.route_stops[i]));
+				}
 			}
-		}
+		};
+		std::unordered_map<uint64_t, size_t> last_passes;
+		for_each_segment([&last_passes](size_t i, uint64_t key) {
+			last_passes[key] = i;
+		});
+		layout.hidden_segments.assign(layout.route_stops.size(), false);
+		for_each_segment([&](size_t i, uint64_t key) {
+			layout.hidden_segments[i] = last_passes.at(key) != i;
+		});
 	}
-	return result;
+	return layout;
 }
 
 Color MapRenderer::GetRouteColor(size_t bus_index) const {
@@ -121,103 +266,227 @@ Color MapRenderer::GetRouteColor(size_t bus_index) const {
 	return color_palette_[color_palette_index];
 }
 
-std::vector<Polyline> MapRenderer::RenderBusRoutes(std::set<const Bus*, BusSetCmp>& buses, const SphereProjector proj) const {
-	size_t bus_index = 0;
-	std::vector<Polyline> bus_routes;
-
-	for (const Bus* bus : buses) {
-		if (!bus->route.empty()) {
-			// запишем плоскостные точки маршрута
-			std::vector<StopPoint> stops_points = PrepareStopPointsForRoute(bus->route, proj);
-
-			// определим цвет маршрута и обновим индекс палитры
-			Color route_color = GetRouteColor(bus_index);
-
-			bus_routes.emplace_back(RenderRoute(stops_points, route_color));
-			++bus_index;
+void MapRenderer::RenderBusRoutes(const MapLayout& layout, const MapSelection& selection, DocumentWriter& map) const {
+	std::vector<Point> points;
+	auto add_route = [&](const Color& route_color) {
+		if (simplify_tolerance_ > 0) {
+			map.Add(RenderRoute(SimplifyPolyline(points, simplify_tolerance_), route_color));
+		}
+		else {
+			map.Add(RenderRoute(points, route_color));
+		}
+		points.clear();
+	};
+	for (const uint32_t bus_index : selection.buses) {
+		const Color route_color = GetRouteColor(bus_index);
+		const size_t first = layout.route_offsets[bus_index];
+		const size_t last = layout.route_offsets[bus_index + 1];
+		if (layout.hidden_segments.empty() || last - first < 2) {
+			for (size_t i = first; i < last; ++i) {
+				points.push_back(layout.points[layout.route_stops[i]]);
+			}
+			add_route(route_color);
+			continue;
+		}
+		// маршрут распадается на куски из отрезков, которые не перекроет следующий маршрут.
+		// Разрыв ломаной стоит дороже нескольких точек, поэтому короткие перекрытые
+		// участки внутри куска остаются, а с концов маршрута перекрытые отрезки убираются всегда
+		size_t run_end = first + 1;
+		for (size_t i = first + 1; i < last; i = run_end) {
+			run_end = i + 1;
+			while (run_end < last && layout.hidden_segments[run_end] == layout.hidden_segments[i]) {
+				++run_end;
+			}
+			const bool is_inner_gap = i > first + 1 && run_end < last;
+			if (layout.hidden_segments[i] && (!is_inner_gap || run_end - i >= MIN_ROUTE_GAP)) {
+				if (!points.empty()) {
+					add_route(route_color);
+				}
+				continue;
+			}
+			if (points.empty()) {
+				points.push_back(layout.points[layout.route_stops[i - 1]]);
+			}
+			for (size_t j = i; j < run_end; ++j) {
+				points.push_back(layout.points[layout.route_stops[j]]);
+			}
+		}
+		if (!points.empty()) {
+			add_route(route_color);
 		}
 	}
-	return bus_routes;
-
 }
 
-std::vector<Text> MapRenderer::RenderBusCaptions(std::set<const Bus*, BusSetCmp>& buses, const SphereProjector proj) const {
-	std::vector<Text> bus_captions;
-	size_t bus_index = 0;
-	for (const Bus* bus : buses) {
-		if (!bus->route.empty()) {
-			// запишем плоскостные точки маршрута
-			std::vector<StopPoint> stops_points = PrepareStopPointsForRoute(bus->route, proj);
-
-			// определим цвет маршрута и обновим индекс палитры
-			Color route_color = GetRouteColor(bus_index);
-
-			// добавляем названия автобусов
-			bus_captions.emplace_back(RenderBusNameUnderlayer(stops_points[0].point, bus->name));
-			bus_captions.emplace_back(RenderBusNameText(stops_points[0].point, bus->name, route_color));
-			if (!bus->is_roundtrip) {
-				Point second_end_stop_point = stops_points[stops_points.size() / 2].point;
-				if (second_end_stop_point != stops_points[0].point) {
-					bus_captions.emplace_back(RenderBusNameUnderlayer(second_end_stop_point, bus->name));
-					bus_captions.emplace_back(RenderBusNameText(second_end_stop_point, bus->name, route_color));
-				}
+void MapRenderer::RenderBusCaptions(const MapLayout& layout, const MapSelection& selection, DocumentWriter& map) const {
+	std::optional<SparsePoints> kept_points;
+	if (min_stop_distance_ > 0) {
+		kept_points.emplace(min_stop_distance_);
+	}
+	auto add_caption = [&](const Point& point, const Bus* bus, const Color& route_color) {
+		if (selection.area && !selection.area->Contains(point)) {
+			return;
+		}
+		// названия маршрутов прореживаются так же, как остановки
+		if (kept_points && !kept_points->TryAdd(point)) {
+			return;
+		}
+		map.Add(RenderBusNameUnderlayer(point, bus->name));
+		map.Add(RenderBusNameText(point, bus->name, route_color));
+	};
+	for (const uint32_t bus_index : selection.buses) {
+		const Bus* bus = layout.buses[bus_index];
+		const Color route_color = GetRouteColor(bus_index);
+		const size_t first = layout.route_offsets[bus_index];
+		const size_t stop_count = layout.route_offsets[bus_index + 1] - first;
+
+		// добавляем названия автобусов
+		const Point first_end_stop_point = layout.points[layout.route_stops[first]];
+		add_caption(first_end_stop_point, bus, route_color);
+		if (!bus->is_roundtrip) {
+			Point second_end_stop_point = layout.points[layout.route_stops[first + stop_count / 2]];
+			if (second_end_stop_point != first_end_stop_point) {
+				add_caption(second_end_stop_point, bus, route_color);
 			}
-			++bus_index;
 		}
 	}
-	return bus_captions;
 }
 
-std::vector<Circle> MapRenderer::RenderStopCircles(std::set<const Bus*, BusSetCmp>& buses, const SphereProjector proj) const {
-	std::vector<Circle> result;
-	std::set<StopPoint, StopPointCmp> unique_stops = PrepareSortedUniqueStopPoints(buses, proj);
+void MapRenderer::RenderStopCircles(const MapLayout& layout, const MapSelection& selection, DocumentWriter& map) const {
 	// добавляем кружки остановок
-	for (const auto& stop : unique_stops) {
-		result.emplace_back(RenderStop(stop.point));
+	for (const uint32_t stop_index : selection.stops) {
+		map.Add(RenderStop(layout.points[stop_index]));
 	}
-	return result;
 }
 
-std::vector<Text> MapRenderer::RenderStopCaptions(std::set<const Bus*, BusSetCmp>& buses, const SphereProjector proj) const {
-	std::vector<Text> result;
-	std::set<StopPoint, StopPointCmp> unique_stops = PrepareSortedUniqueStopPoints(buses, proj);
+void MapRenderer::RenderStopCaptions(const MapLayout& layout, const MapSelection& selection, DocumentWriter& map) const {
 	// добавляем надписи для остановок
-	for (const auto& stop : unique_stops) {
-		result.emplace_back(RenderStopNameUnderlayer(stop));
-		result.emplace_back(RenderStopNameText(stop));
+	for (const uint32_t stop_index : selection.stops) {
+		map.Add(RenderStopNameUnderlayer(layout.points[stop_index], layout.stops[stop_index]->name));
+		map.Add(RenderStopNameText(layout.points[stop_index], layout.stops[stop_index]->name));
+	}
+}
+
+MapRenderer::MapSelection MapRenderer::SelectAll(const MapLayout& layout) const {
+	MapSelection selection;
+	selection.buses.resize(layout.buses.size());
+	std::iota(selection.buses.begin(), selection.buses.end(), 0);
+	selection.stops = layout.stops_by_name;
+	return selection;
+}
+
+std::vector<uint32_t> MapRenderer::ThinOutStops(const MapLayout& layout, const std::vector<uint32_t>& stops) const {
+	SparsePoints kept_points(min_stop_distance_);
+	std::vector<uint32_t> result;
+	for (const uint32_t stop_index : stops) {
+		if (kept_points.TryAdd(layout.points[stop_index])) {
+			result.push_back(stop_index);
+		}
 	}
 	return result;
 }
 
+void MapRenderer::RenderSelection(const MapLayout& layout, MapSelection selection, std::string& out) const {
+	if (min_stop_distance_ > 0) {
+		selection.stops = ThinOutStops(layout, selection.stops);
+	}
+	// элементы выводятся сразу, без хранения в svg::Document
+	DocumentWriter map(out);
+	RenderBusRoutes(layout, selection, map);
+	RenderBusCaptions(layout, selection, map);
+	RenderStopCircles(layout, selection, map);
+	RenderStopCaptions(layout, selection, map);
+	map.Finish();
+}
 
-void MapRenderer::RenderMap(std::set<const Bus*, BusSetCmp>& buses, std::ostream& out) const {
-	Document map;
-	// спроецируем все остановки на плоскость и подготовим масштаб карты
-	const SphereProjector proj = ProjectStops(buses);
-	// контейнеры для элементов карты
-	std::vector<Polyline> bus_routes = RenderBusRoutes(buses, proj);
-	std::vector<Text> bus_text = RenderBusCaptions(buses, proj);
-	std::vector<Circle> stops = RenderStopCircles(buses, proj);
-	std::vector<Text> stop_text = RenderStopCaptions(buses, proj);
+void MapRenderer::RenderMap(const transport_catalogue::TransportCatalogue& catalogue, ranges::Range<const Bus* const*> buses, std::ostream& out) const {
+	std::string map;
+	RenderMap(catalogue, buses, map);
+	out.write(map.data(), map.size());
+}
+
+void MapRenderer::RenderMap(const transport_catalogue::TransportCatalogue& catalogue, ranges::Range<const Bus* const*> buses, std::string& out) const {
+	// спроецируем все остановки на плоскость один раз, слои карты строятся по готовой раскладке
+	const MapLayout layout = MakeLayout(catalogue, buses);
+	RenderSelection(layout, SelectAll(layout), out);
+}
+
+std::string MapRenderer::GetSettingsKey() const {
+	// все настройки, от которых зависит карта, в текстовом виде с точностью до бита
+	std::ostringstream key;
+	key.precision(std::numeric_limits<double>::max_digits10);
+	auto write_point = [&key](const Point& point) {
+		key << point.x << ' ' << point.y << ' ';
+	};
+	auto write_color = [&key](const Color& color) {
+		key << color.index() << ' ';
+		std::visit(ColorPrinter{ key }, color);
+		key << ' ';
+	};
+	key << width_ << ' ' << height_ << ' ' << padding_ << ' ' << line_width_ << ' ' << stop_radius_ << ' '
+		<< bus_label_font_size_ << ' ' << stop_label_font_size_ << ' ' << underlayer_width_ << ' ';
+	write_point(bus_label_offset_);
+	write_point(stop_label_offset_);
+	write_color(underlayer_color_);
+	for (const Color& color : color_palette_) {
+		write_color(color);
+	}
+	key << "lod " << simplify_tolerance_ << ' ' << merge_shared_segments_ << ' ' << min_stop_distance_;
+	return key.str();
+}
 
-	// добавляем элементы на карту
-	for (const Polyline& route : bus_routes) {
-		map.Add(route);
+void MapRenderer::UpdateMapCache(const transport_catalogue::TransportCatalogue& catalogue) const {
+	std::string settings_key = GetSettingsKey();
+	if (map_cache_.layout && map_cache_.catalogue == &catalogue && map_cache_.catalogue_version == catalogue.GetVersion()
+		&& map_cache_.settings_key == settings_key) {
+		return;
 	}
 
-	for (const Text& elem : bus_text) {
-		map.Add(elem);
+	auto layout = std::make_shared<MapLayout>(MakeLayout(catalogue, catalogue.GetBuses()));
+	layout->index = GridIndex(layout->points, layout->route_offsets, layout->route_stops);
+	map_cache_ = { &catalogue, catalogue.GetVersion(), std::move(settings_key), std::move(layout), nullptr };
+}
+
+std::shared_ptr<const std::string> MapRenderer::RenderCatalogueMap(const transport_catalogue::TransportCatalogue& catalogue) const {
+	// остальные запросы карты ждут, пока первый её отрендерит, а не рендерят её параллельно
+	std::lock_guard lock(map_cache_mutex_);
+	UpdateMapCache(catalogue);
+	if (!map_cache_.svg) {
+		auto svg = std::make_shared<std::string>();
+		RenderSelection(*map_cache_.layout, SelectAll(*map_cache_.layout), *svg);
+		map_cache_.svg = std::move(svg);
 	}
+	return map_cache_.svg;
+}
 
-	// добавляем кружки остановок
-	for (const Circle& stop : stops) {
-		map.Add(stop);
+std::string MapRenderer::RenderCatalogueMapArea(const transport_catalogue::TransportCatalogue& catalogue, const Viewport& area) const {
+	std::shared_ptr<const MapLayout> layout;
+	{
+		std::lock_guard lock(map_cache_mutex_);
+		UpdateMapCache(catalogue);
+		layout = map_cache_.layout;
 	}
 
-	// добавляем надписи для остановок
-	for (const Text& elem : stop_text) {
-		map.Add(elem);
+	MapSelection selection;
+	selection.area = area;
+	selection.buses = layout->index.FindRoutes(area);
+	selection.stops = layout->index.FindPoints(area);
+	std::sort(selection.stops.begin(), selection.stops.end(), [&layout](uint32_t lhs, uint32_t rhs) {
+		return layout->stops[lhs]->name < layout->stops[rhs]->name;
+	});
+	std::string svg;
+	RenderSelection(*layout, std::move(selection), svg);
+	return svg;
+}
+
+Viewport MapRenderer::GetTileViewport(int zoom, int x, int y) const {
+	if (zoom < 0 || zoom > 30) {
+		throw std::invalid_argument("tile zoom should be in [0, 30]");
+	}
+	const int64_t tile_count = int64_t{ 1 } << zoom;
+	if (x < 0 || x >= tile_count || y < 0 || y >= tile_count) {
+		throw std::invalid_argument("tile is out of the map");
 	}
-	
-	map.Render(out);
+	const double tile_width = width_ / tile_count;
+	const double tile_height = height_ / tile_count;
+	return { x * tile_width, y * tile_height, (x + 1) * tile_width, (y + 1) * tile_height };
 }
@@ -2,11 +2,20 @@
 
 #include "domain.h"
 #include "geo.h"
+#include "grid_index.h"
+#include "ranges.h"
 #include "svg.h"
+#include "transport_catalogue.h"
 
 #include <algorithm>
+#include <cstdint>
 #include <cstdlib>
-#include <set>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
 
 namespace renderer {
 
@@ -83,7 +92,19 @@ namespace renderer {
 
     struct MapRenderer {
     public:
-        void RenderMap(std::set<const Bus*, BusSetCmp>& buses, std::ostream& out) const;
+        // Карта маршрутов buses из справочника catalogue, маршруты идут в порядке названий
+        void RenderMap(const transport_catalogue::TransportCatalogue& catalogue, ranges::Range<const Bus* const*> buses, std::ostream& out) const;
+        // Дописывает карту в конец строки
+        void RenderMap(const transport_catalogue::TransportCatalogue& catalogue, ranges::Range<const Bus* const*> buses, std::string& out) const;
+        // Карта всех автобусов справочника. Она рендерится один раз и отдаётся повторно,
+        // пока не изменятся справочник или настройки; можно вызывать из нескольких потоков
+        std::shared_ptr<const std::string> RenderCatalogueMap(const transport_catalogue::TransportCatalogue& catalogue) const;
+        // Часть карты справочника: маршруты, задевающие область, и остановки внутри неё.
+        // Координаты и цвета те же, что на всей карте. Раскладка и индекс по ней строятся
+        // один раз вместе с кэшем карты, так что время зависит от содержимого области, а не от размера сети
+        std::string RenderCatalogueMapArea(const transport_catalogue::TransportCatalogue& catalogue, const Viewport& area) const;
+        // Тайл x, y при делении карты на 2^zoom x 2^zoom частей
+        Viewport GetTileViewport(int zoom, int x, int y) const;
         svg::Point CreatePoint(double dx, double dy) const;
         svg::Color CreateRgbColor(int red_shade, int green_shade, int blue_shade) const;
         svg::Color CreateRgbaColor(int red_shade, int green_shade, int blue_shade, double opacity) const;
@@ -100,32 +121,77 @@ namespace renderer {
         svg::Color underlayer_color_;
         double underlayer_width_;
         std::vector<svg::Color> color_palette_;
+        // Упрощение обзорной карты, по умолчанию выключено и карта выводится целиком.
+        // Допуск в пикселях, на который ломаная маршрута может отойти от остановок (Дуглас — Пекер)
+        double simplify_tolerance_ = 0;
+        // отрезок между остановками, по которому идут несколько маршрутов, рисуется один раз:
+        // последним из них, который всё равно лёг бы поверх остальных
+        bool merge_shared_segments_ = false;
+        // остановка ближе этого расстояния в пикселях к уже выведенной не выводится вместе с названием
+        double min_stop_distance_ = 0;
 
-        struct StopPoint {
-            std::string name;
-            svg::Point point;
+    private:
+        // Остановки всех непустых маршрутов, спроецированные по одному разу
+        struct MapLayout {
+            // уникальные остановки в порядке первого появления и их точки на карте
+            std::vector<const Stop*> stops;
+            std::vector<svg::Point> points;
+            // индексы остановок, отсортированные по названию
+            std::vector<uint32_t> stops_by_name;
+            // непустые маршруты в порядке названий; остановки маршрута i лежат
+            // в route_stops с route_offsets[i] по route_offsets[i + 1]
+            std::vector<const Bus*> buses;
+            std::vector<size_t> route_offsets;
+            std::vector<uint32_t> route_stops;
+            // при merge_shared_segments_: отрезок от route_stops[i - 1] до route_stops[i]
+            // повторяется дальше и в позиции i не рисуется
+            std::vector<bool> hidden_segments;
+            // строится только для раскладки из кэша
+            GridIndex index;
         };
-        struct StopPointCmp {
-            bool operator()(const StopPoint& lhs, const StopPoint& rhs) const {
-                return lhs.name < rhs.name;
-            }
+
+        // Что из раскладки выводить на карту
+        struct MapSelection {
+            // индексы маршрутов по возрастанию
+            std::vector<uint32_t> buses;
+            // индексы остановок в порядке названий
+            std::vector<uint32_t> stops;
+            // названия маршрутов выводятся, только если попадают в область
+            std::optional<Viewport> area;
         };
-    private:
-        SphereProjector ProjectStops(std::set<const Bus*, BusSetCmp>& buses) const;
-        std::vector<StopPoint> PrepareStopPointsForRoute(const std::vector<Stop*> bus_route, const SphereProjector proj) const;
-        std::set<StopPoint, StopPointCmp> PrepareSortedUniqueStopPoints(std::set<const Bus*, BusSetCmp>& buses, const SphereProjector proj) const;
+
+        struct MapCache {
+            const transport_catalogue::TransportCatalogue* catalogue = nullptr;
+            uint64_t catalogue_version = 0;
+            std::string settings_key;
+            std::shared_ptr<const MapLayout> layout;
+            // рендерится при первом запросе всей карты
+            std::shared_ptr<const std::string> svg;
+        };
+        mutable std::mutex map_cache_mutex_;
+        mutable MapCache map_cache_;
+
+        std::string GetSettingsKey() const;
+        // вызывается под map_cache_mutex_
+        void UpdateMapCache(const transport_catalogue::TransportCatalogue& catalogue) const;
+
+        MapLayout MakeLayout(const transport_catalogue::TransportCatalogue& catalogue, ranges::Range<const Bus* const*> buses) const;
+        MapSelection SelectAll(const MapLayout& layout) const;
+        void RenderSelection(const MapLayout& layout, MapSelection selection, std::string& out) const;
         svg::Color GetRouteColor(size_t bus_index) const;
-        svg::Polyline RenderRoute(std::vector<StopPoint> stops_points, svg::Color route_color) const;
-        std::vector<svg::Polyline> RenderBusRoutes(std::set<const Bus*, BusSetCmp>& buses, const SphereProjector proj) const;
-        std::vector<svg::Text> RenderBusCaptions(std::set<const Bus*, BusSetCmp>& buses, const SphereProjector proj) const;
-        svg::Text RenderCommonBusTextProps(const svg::Point& point, std::string bus_name) const;
-        svg::Text RenderBusNameUnderlayer(const svg::Point& point, std::string bus_name) const;
-        svg::Text RenderBusNameText(const svg::Point& point, std::string bus_name, svg::Color route_color) const;
+        svg::Polyline RenderRoute(const std::vector<svg::Point>& points, const svg::Color& route_color) const;
+        // остановки выборки без тех, что ближе min_stop_distance_ к уже оставленным
+        std::vector<uint32_t> ThinOutStops(const MapLayout& layout, const std::vector<uint32_t>& stops) const;
+        void RenderBusRoutes(const MapLayout& layout, const MapSelection& selection, svg::DocumentWriter& map) const;
+        void RenderBusCaptions(const MapLayout& layout, const MapSelection& selection, svg::DocumentWriter& map) const;
+        svg::Text RenderCommonBusTextProps(const svg::Point& point, std::string_view bus_name) const;
+        svg::Text RenderBusNameUnderlayer(const svg::Point& point, std::string_view bus_name) const;
+        svg::Text RenderBusNameText(const svg::Point& point, std::string_view bus_name, const svg::Color& route_color) const;
         svg::Circle RenderStop(const svg::Point& point) const;
-        std::vector<svg::Circle> RenderStopCircles(std::set<const Bus*, BusSetCmp>& buses, const SphereProjector proj) const;
-        svg::Text RenderCommonStopTextProps(const StopPoint& stop) const;
-        svg::Text RenderStopNameUnderlayer(const StopPoint& stop) const;
-        svg::Text RenderStopNameText(const StopPoint& stop) const;
-        std::vector<svg::Text> RenderStopCaptions(std::set<const Bus*, BusSetCmp>& buses, const SphereProjector proj) const;
+        void RenderStopCircles(const MapLayout& layout, const MapSelection& selection, svg::DocumentWriter& map) const;
+        svg::Text RenderCommonStopTextProps(const svg::Point& point, std::string_view stop_name) const;
+        svg::Text RenderStopNameUnderlayer(const svg::Point& point, std::string_view stop_name) const;
+        svg::Text RenderStopNameText(const svg::Point& point, std::string_view stop_name) const;
+        void RenderStopCaptions(const MapLayout& layout, const MapSelection& selection, svg::DocumentWriter& map) const;
     };
 }
\ No newline at end of file
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <iterator>
 #include <string_view>
 #include <unordered_map>
@@ -33,4 +34,45 @@ namespace ranges {
         return Range{ container.begin(), container.end() };
     }
 
+    // Iterator over consecutive integer ids
+    template <typename Id>
+    class IdIterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = Id;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const Id*;
+        using reference = Id;
+
+        explicit IdIterator(Id id)
+            : id_(id) {
+        }
+        Id operator*() const {
+            return id_;
+        }
+        IdIterator& operator++() {
+            ++id_;
+            return *this;
+        }
+        IdIterator operator++(int) {
+            IdIterator prev = *this;
+            ++id_;
+            return prev;
+        }
+        bool operator==(const IdIterator& other) const {
+            return id_ == other.id_;
+        }
+        bool operator!=(const IdIterator& other) const {
+            return id_ != other.id_;
+        }
+
+    private:
+        Id id_;
+    };
+
+    template <typename Id>
+    auto AsIdRange(Id begin, Id end) {
+        return Range{ IdIterator<Id>{ begin }, IdIterator<Id>{ end } };
+    }
+
 }  // namespace ranges
\ No newline at end of file
@@ -1,26 +1,148 @@
 #pragma once
 
+#include "all_pairs_table.h"
+#include "contraction_hierarchy.h"
 #include "graph.h"
 
 #include <algorithm>
+#include <array>
 #include <cassert>
 #include <cstdint>
+#include <cstring>
+#include <functional>
 #include <iterator>
 #include <optional>
+#include <queue>
 #include <stdexcept>
+#include <type_traits>
 #include <unordered_map>
 #include <utility>
 #include <vector>
 
 namespace graph {
 
+    // Algorithm used by Router to answer BuildRoute queries.
+    // The searches need no precompute, so construction is O(E) and memory O(V + E).
+    // The all-pairs table is the exception: O(V^3) to build and O(V^2) memory, for medium graphs only
+    enum class RouterAlgorithm {
+        DIJKSTRA,               // Dijkstra with a binary heap
+        RADIX_HEAP_DIJKSTRA,    // Dijkstra with a monotone radix heap
+        A_STAR,                 // A* guided by a user-provided heuristic
+        CONTRACTION_HIERARCHY,  // bidirectional search over a contraction hierarchy built once
+        ALL_PAIRS,              // routes between all vertices looked up in a table built once
+    };
+
+    namespace router_detail {
+
+        // Maps a non-negative weight to an unsigned key preserving order
+        template <typename Weight>
+        uint64_t ToRadixKey(Weight weight) {
+            if constexpr (std::is_floating_point_v<Weight>) {
+                // IEEE 754 bit patterns of non-negative doubles are ordered as integers
+                const double value = static_cast<double>(weight) + 0.0;
+                uint64_t key;
+                std::memcpy(&key, &value, sizeof(key));
+                return key;
+            }
+            else {
+                return static_cast<uint64_t>(weight);
+            }
+        }
+
+        inline size_t BitWidth(uint64_t value) {
+#if defined(__GNUC__)
+            return value == 0 ? 0 : 64 - __builtin_clzll(value);
+#else
+            size_t width = 0;
+            for (; value != 0; value >>= 1) {
+                ++width;
+            }
+            return width;
+#endif
+        }
+
+        template <typename Key, typename Value>
+        class BinaryHeap {
+        public:
+            bool Empty() const {
+                return heap_.empty();
+            }
+
+            void Push(Key key, Value value) {
+                heap_.emplace(std::move(key), std::move(value));
+            }
+
+            std::pair<Key, Value> Pop() {
+                std::pair<Key, Value> item = heap_.top();
+                heap_.pop();
+                return item;
+            }
+
+        private:
+            using Item = std::pair<Key, Value>;
+            std::priority_queue<Item, std::vector<Item>, std::greater<Item>> heap_;
+        };
+
+        // Monotone priority queue: every pushed key must be not less than the last popped one
+        template <typename Value>
+        class RadixHeap {
+        public:
+            bool Empty() const {
+                return size_ == 0;
+            }
+
+            void Push(uint64_t key, Value value) {
+                assert(key >= last_key_);
+                buckets_[BitWidth(key ^ last_key_)].emplace_back(key, std::move(value));
+                ++size_;
+            }
+
+            std::pair<uint64_t, Value> Pop() {
+                assert(!Empty());
+                if (buckets_[0].empty()) {
+                    size_t index = 1;
+                    while (buckets_[index].empty()) {
+                        ++index;
+                    }
+                    auto& bucket = buckets_[index];
+                    last_key_ = std::min_element(bucket.begin(), bucket.end(),
+                        [](const auto& lhs, const auto& rhs) { return lhs.first < rhs.first; })->first;
+                    for (auto& item : bucket) {
+                        buckets_[BitWidth(item.first ^ last_key_)].emplace_back(std::move(item));
+                    }
+                    bucket.clear();
+                }
+                std::pair<uint64_t, Value> item = std::move(buckets_[0].back());
+                buckets_[0].pop_back();
+                --size_;
+                return item;
+            }
+
+        private:
+            std::array<std::vector<std::pair<uint64_t, Value>>, 65> buckets_;
+            uint64_t last_key_ = 0;
+            size_t size_ = 0;
+        };
+
+    }  // namespace router_detail
+
     template <typename Weight>
     class Router {
     private:
         using Graph = DirectedWeightedGraph<Weight>;
 
     public:
-        explicit Router(const Graph& graph);
+        // Lower bound of the route weight between two vertices, required by A*.
+        // It must be consistent, otherwise A* may return a suboptimal route
+        using Heuristic = std::function<Weight(VertexId from, VertexId to)>;
+
+        // the contraction hierarchy and the all-pairs table are built on thread_count threads, 0 for one per hardware thread
+        explicit Router(const Graph& graph, RouterAlgorithm algorithm = RouterAlgorithm::DIJKSTRA,
+            Heuristic heuristic = nullptr, size_t thread_count = 1);
+        // uses a contraction hierarchy built earlier for the same graph
+        Router(const Graph& graph, ContractionHierarchy<Weight> contraction_hierarchy);
+        // uses an all-pairs table built earlier for the same graph
+        Router(const Graph& graph, AllPairsTable<Weight> all_pairs_table);
 
         struct RouteInfo {
             Weight weight;
@@ -29,75 +151,179 @@ namespace graph {
 
         std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
 
+        // nullptr unless the router uses RouterAlgorithm::CONTRACTION_HIERARCHY
+        const ContractionHierarchy<Weight>* GetContractionHierarchy() const;
+        // nullptr unless the router uses RouterAlgorithm::ALL_PAIRS
+        const AllPairsTable<Weight>* GetAllPairsTable() const;
+
     private:
         struct RouteInternalData {
             Weight weight;
             std::optional<EdgeId> prev_edge;
         };
-        using RoutesInternalData = std::vector<std::vector<std::optional<RouteInternalData>>>;
-
-        void InitializeRoutesInternalData(const Graph& graph) {
-            const size_t vertex_count = graph.GetVertexCount();
-            for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
-                routes_internal_data_[vertex][vertex] = RouteInternalData{ ZERO_WEIGHT, std::nullopt };
-                for (const EdgeId edge_id : graph.GetIncidentEdges(vertex)) {
-                    const auto& edge = graph.GetEdge(edge_id);
-                    if (edge.weight < ZERO_WEIGHT) {
-                        throw std::domain_error("Edges' weights should be non-negative");
-                    }
-                    auto& route_internal_data = routes_internal_data_[vertex][edge.to];
-                    if (!route_internal_data || route_internal_data->weight > edge.weight) {
-                        route_internal_data = RouteInternalData{ edge.weight, edge_id };
-                    }
-                }
-            }
-        }
+        using RoutesInternalData = std::vector<std::optional<RouteInternalData>>;
 
-        void RelaxRoute(VertexId vertex_from, VertexId vertex_to, const RouteInternalData& route_from,
-            const RouteInternalData& route_to) {
-            auto& route_relaxing = routes_internal_data_[vertex_from][vertex_to];
-            const Weight candidate_weight = route_from.weight + route_to.weight;
-            if (!route_relaxing || candidate_weight < route_relaxing->weight) {
-                route_relaxing = { candidate_weight,
-                                  route_to.prev_edge ? route_to.prev_edge : route_from.prev_edge };
-            }
-        }
+        // Runs the search from vertex_from until vertex_to is settled.
+        // Queue must provide Push(priority, vertex), Pop() and Empty()
+        template <typename Queue, typename Priority>
+        RoutesInternalData Search(VertexId vertex_from, VertexId vertex_to, Queue& queue, Priority priority) const {
+            RoutesInternalData routes_internal_data(graph_.GetVertexCount());
+            std::vector<bool> settled(graph_.GetVertexCount(), false);
 
-        void RelaxRoutesInternalDataThroughVertex(size_t vertex_count, VertexId vertex_through) {
-            for (VertexId vertex_from = 0; vertex_from < vertex_count; ++vertex_from) {
-                if (const auto& route_from = routes_internal_data_[vertex_from][vertex_through]) {
-                    for (VertexId vertex_to = 0; vertex_to < vertex_count; ++vertex_to) {
-                        if (const auto& route_to = routes_internal_data_[vertex_through][vertex_to]) {
-                            RelaxRoute(vertex_from, vertex_to, *route_from, *route_to);
-                        }
+            routes_internal_data[vertex_from] = RouteInternalData{ ZERO_WEIGHT, std::nullopt };
+            queue.Push(priority(vertex_from, ZERO_WEIGHT), vertex_from);
+            while (!queue.Empty()) {
+                const VertexId vertex = queue.Pop().second;
+                if (settled[vertex]) {
+                    continue;
+                }
+                settled[vertex] = true;
+                if (vertex == vertex_to) {
+                    break;
+                }
+                const Weight vertex_weight = routes_internal_data[vertex]->weight;
+                for (const EdgeId edge_id : graph_.GetIncidentEdges(vertex)) {
+                    const auto& edge = graph_.GetEdge(edge_id);
+                    if (settled[edge.to]) {
+                        continue;
+                    }
+                    const Weight candidate_weight = vertex_weight + edge.weight;
+                    auto& route_relaxing = routes_internal_data[edge.to];
+                    if (!route_relaxing || candidate_weight < route_relaxing->weight) {
+                        route_relaxing = RouteInternalData{ candidate_weight, edge_id };
+                        queue.Push(priority(edge.to, candidate_weight), edge.to);
                     }
                 }
             }
+            return routes_internal_data;
         }
 
+        RoutesInternalData SearchDijkstra(VertexId vertex_from, VertexId vertex_to) const;
+        RoutesInternalData SearchRadixHeapDijkstra(VertexId vertex_from, VertexId vertex_to) const;
+        RoutesInternalData SearchAStar(VertexId vertex_from, VertexId vertex_to) const;
+
         static constexpr Weight ZERO_WEIGHT{};
         const Graph& graph_;
-        RoutesInternalData routes_internal_data_;
+        RouterAlgorithm algorithm_;
+        Heuristic heuristic_;
+        std::optional<ContractionHierarchy<Weight>> contraction_hierarchy_;
+        std::optional<AllPairsTable<Weight>> all_pairs_table_;
     };
 
     template <typename Weight>
-    Router<Weight>::Router(const Graph& graph)
+    Router<Weight>::Router(const Graph& graph, RouterAlgorithm algorithm, Heuristic heuristic, size_t thread_count)
+        : graph_(graph)
+        , algorithm_(algorithm)
+        , heuristic_(std::move(heuristic))
+    {
+        if (algorithm_ == RouterAlgorithm::A_STAR && !heuristic_) {
+            throw std::invalid_argument("A* requires a heuristic");
+        }
+        for (EdgeId edge_id = 0; edge_id < graph_.GetEdgeCount(); ++edge_id) {
+            if (graph_.GetEdge(edge_id).weight < ZERO_WEIGHT) {
+                throw std::domain_error("Edges' weights should be non-negative");
+            }
+        }
+        if (algorithm_ == RouterAlgorithm::CONTRACTION_HIERARCHY) {
+            contraction_hierarchy_.emplace(graph_, thread_count);
+        }
+        else if (algorithm_ == RouterAlgorithm::ALL_PAIRS) {
+            all_pairs_table_.emplace(graph_, thread_count);
+        }
+    }
+
+    template <typename Weight>
+    Router<Weight>::Router(const Graph& graph, ContractionHierarchy<Weight> contraction_hierarchy)
         : graph_(graph)
-        , routes_internal_data_(graph.GetVertexCount(),
-            std::vector<std::optional<RouteInternalData>>(graph.GetVertexCount()))
+        , algorithm_(RouterAlgorithm::CONTRACTION_HIERARCHY)
+        , contraction_hierarchy_(std::move(contraction_hierarchy))
     {
-        InitializeRoutesInternalData(graph);
+    }
 
-        const size_t vertex_count = graph.GetVertexCount();
-        for (VertexId vertex_through = 0; vertex_through < vertex_count; ++vertex_through) {
-            RelaxRoutesInternalDataThroughVertex(vertex_count, vertex_through);
+    template <typename Weight>
+    Router<Weight>::Router(const Graph& graph, AllPairsTable<Weight> all_pairs_table)
+        : graph_(graph)
+        , algorithm_(RouterAlgorithm::ALL_PAIRS)
+        , all_pairs_table_(std::move(all_pairs_table))
+    {
+        if (all_pairs_table_->GetVertexCount() != graph_.GetVertexCount()) {
+            throw std::invalid_argument("All-pairs table does not match the graph");
         }
     }
 
+    template <typename Weight>
+    const ContractionHierarchy<Weight>* Router<Weight>::GetContractionHierarchy() const {
+        return contraction_hierarchy_ ? &*contraction_hierarchy_ : nullptr;
+    }
+
+    template <typename Weight>
+    const AllPairsTable<Weight>* Router<Weight>::GetAllPairsTable() const {
+        return all_pairs_table_ ? &*all_pairs_table_ : nullptr;
+    }
+
+    template <typename Weight>
+    typename Router<Weight>::RoutesInternalData Router<Weight>::SearchDijkstra(VertexId vertex_from,
+        VertexId vertex_to) const {
+        router_detail::BinaryHeap<Weight, VertexId> queue;
+        return Search(vertex_from, vertex_to, queue, [](VertexId, Weight weight) { return weight; });
+    }
+
+    template <typename Weight>
+    typename Router<Weight>::RoutesInternalData Router<Weight>::SearchRadixHeapDijkstra(VertexId vertex_from,
+        VertexId vertex_to) const {
+        router_detail::RadixHeap<VertexId> queue;
+        return Search(vertex_from, vertex_to, queue,
+            [](VertexId, Weight weight) { return router_detail::ToRadixKey(weight); });
+    }
+
+    template <typename Weight>
+    typename Router<Weight>::RoutesInternalData Router<Weight>::SearchAStar(VertexId vertex_from,
+        VertexId vertex_to) const {
+        router_detail::BinaryHeap<Weight, VertexId> queue;
+        return Search(vertex_from, vertex_to, queue, [this, vertex_to](VertexId vertex, Weight weight) {
+            return weight + heuristic_(vertex, vertex_to);
+        });
+    }
+
     template <typename Weight>
     std::optional<typename Router<Weight>::RouteInfo> Router<Weight>::BuildRoute(VertexId from,
         VertexId to) const {
-        const auto& route_internal_data = routes_internal_data_.at(from).at(to);
+        if (from >= graph_.GetVertexCount() || to >= graph_.GetVertexCount()) {
+            throw std::out_of_range("Vertex is out of graph");
+        }
+        if (from == to) {
+            return RouteInfo{ ZERO_WEIGHT, {} };
+        }
+        if (contraction_hierarchy_) {
+            auto route = contraction_hierarchy_->BuildRoute(from, to);
+            if (!route) {
+                return std::nullopt;
+            }
+            return RouteInfo{ route->weight, std::move(route->edges) };
+        }
+        if (all_pairs_table_) {
+            auto route = all_pairs_table_->BuildRoute(graph_, from, to);
+            if (!route) {
+                return std::nullopt;
+            }
+            return RouteInfo{ route->weight, std::move(route->edges) };
+        }
+
+        RoutesInternalData routes_internal_data;
+        switch (algorithm_) {
+        case RouterAlgorithm::RADIX_HEAP_DIJKSTRA:
+            routes_internal_data = SearchRadixHeapDijkstra(from, to);
+            break;
+        case RouterAlgorithm::A_STAR:
+            routes_internal_data = SearchAStar(from, to);
+            break;
+        case RouterAlgorithm::DIJKSTRA:
+        default:
+            routes_internal_data = SearchDijkstra(from, to);
+            break;
+        }
+
+        const auto& route_internal_data = routes_internal_data[to];
         if (!route_internal_data) {
             return std::nullopt;
         }
@@ -105,7 +331,7 @@ namespace graph {
         std::vector<EdgeId> edges;
         for (std::optional<EdgeId> edge_id = route_internal_data->prev_edge;
             edge_id;
-            edge_id = routes_internal_data_[from][graph_.GetEdge(*edge_id).from]->prev_edge)
+            edge_id = routes_internal_data[graph_.GetEdge(*edge_id).from]->prev_edge)
         {
             edges.push_back(*edge_id);
         }
@@ -114,4 +340,4 @@ namespace graph {
         return RouteInfo{ weight, std::move(edges) };
     }
 
-}  // namespace graph
\ No newline at end of file
+}  // namespace graph
@@ -0,0 +1,614 @@
+#include "serialization.h"
+
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define SNAPSHOT_USE_MMAP
+#endif
+
+using namespace std::literals;
+using namespace serialization;
+
+namespace {
+
+	constexpr char MAGIC[8] = { 'T', 'C', 'S', 'N', 'A', 'P', '\0', '\0' };
+	constexpr uint32_t FORMAT_VERSION = 4;
+	constexpr uint64_t SECTION_ALIGNMENT = 8;
+
+	enum SectionId : uint32_t {
+		STRINGS,
+		STOPS,
+		BUSES,
+		ROUTE_STOPS,
+		DISTANCE_SLOTS,
+		RENDER_SETTINGS,
+		ROUTING_SETTINGS,
+		GRAPH_EDGES,
+		GRAPH_INCIDENCE_OFFSETS,
+		HIERARCHY_EDGES,
+		HIERARCHY_UPWARD_OFFSETS,
+		HIERARCHY_UPWARD_EDGES,
+		HIERARCHY_DOWNWARD_OFFSETS,
+		HIERARCHY_DOWNWARD_EDGES,
+		ALL_PAIRS_WEIGHTS,
+		ALL_PAIRS_LAST_EDGES
+	};
+
+	struct Header {
+		char magic[8];
+		uint32_t version;
+		uint32_t section_count;
+		// checksum of the section table
+		uint64_t checksum;
+	};
+
+	struct SectionEntry {
+		uint32_t id;
+		uint32_t element_size;
+		uint64_t offset;
+		uint64_t size;
+		// checksum of the section's data, verified when the section is first read
+		uint64_t checksum;
+	};
+
+	// position of a name in the STRINGS section
+	struct StringRef {
+		uint32_t offset;
+		uint32_t size;
+	};
+
+	struct StopRecord {
+		StringRef name;
+		double lat;
+		double lng;
+	};
+
+	struct BusRecord {
+		StringRef name;
+		// position of the route in the ROUTE_STOPS section
+		uint32_t route_offset;
+		uint32_t route_size;
+		uint32_t is_roundtrip;
+	};
+
+	struct RoutingSettingsRecord {
+		double bus_velocity;
+		int32_t bus_wait_time;
+		uint32_t algorithm;
+	};
+
+	// Records and the arrays of the router are written as raw bytes. Padding would put uninitialized
+	// bytes into the file and its checksum, so the layouts are pinned down here
+	static_assert(sizeof(Header) == 24 && sizeof(SectionEntry) == 32);
+	static_assert(sizeof(StringRef) == 8 && sizeof(StopRecord) == 24 && sizeof(BusRecord) == 20);
+	static_assert(sizeof(transport_catalogue::DistanceTable::Slot) == 16 && sizeof(RoutingSettingsRecord) == 16);
+	static_assert(sizeof(graph::Edge<double>) == 24);
+	static_assert(sizeof(graph::ContractionHierarchy<double>::HierarchyEdge) == 24);
+
+	constexpr uint64_t FNV_OFFSET_BASIS = 14695981039346656037ull;
+	constexpr uint64_t FNV_PRIME = 1099511628211ull;
+
+	// FNV-1a over 8-byte words in four independent lanes, so that the multiplications overlap.
+	// Every step is invertible, so a single damaged word always changes the result.
+	// It detects damaged files and is not meant to resist crafted ones
+	uint64_t ComputeChecksum(const char* data, size_t size) {
+		constexpr size_t LANE_COUNT = 4;
+		uint64_t lanes[LANE_COUNT] = { FNV_OFFSET_BASIS, FNV_OFFSET_BASIS + 1, FNV_OFFSET_BASIS + 2, FNV_OFFSET_BASIS + 3 };
+		size_t position = 0;
+		for (; position + LANE_COUNT * sizeof(uint64_t) <= size; position += LANE_COUNT * sizeof(uint64_t)) {
+			for (size_t lane = 0; lane < LANE_COUNT; ++lane) {
+				uint64_t word;
+				std::memcpy(&word, data + position + lane * sizeof(uint64_t), sizeof(word));
+				lanes[lane] = (lanes[lane] ^ word) * FNV_PRIME;
+			}
+		}
+		uint64_t checksum = FNV_OFFSET_BASIS ^ size;
+		for (const uint64_t lane : lanes) {
+			checksum = (checksum ^ lane) * FNV_PRIME;
+		}
+		for (; position < size; ++position) {
+			checksum = (checksum ^ static_cast<unsigned char>(data[position])) * FNV_PRIME;
+		}
+		return checksum;
+	}
+
+	uint64_t AlignUp(uint64_t offset) {
+		return (offset + SECTION_ALIGNMENT - 1) / SECTION_ALIGNMENT * SECTION_ALIGNMENT;
+	}
+
+	[[noreturn]] void ThrowCorrupted() {
+		throw std::runtime_error("snapshot is corrupted");
+	}
+
+	// the snapshot was written by another version of the program
+	[[noreturn]] void ThrowUnsupported(const std::string& what) {
+		throw std::runtime_error("unsupported snapshot "s + what);
+	}
+
+	graph::RouterAlgorithm GetRouterAlgorithm(uint32_t value) {
+		const auto algorithm = static_cast<graph::RouterAlgorithm>(value);
+		switch (algorithm) {
+		case graph::RouterAlgorithm::DIJKSTRA:
+		case graph::RouterAlgorithm::RADIX_HEAP_DIJKSTRA:
+		case graph::RouterAlgorithm::A_STAR:
+		case graph::RouterAlgorithm::CONTRACTION_HIERARCHY:
+		case graph::RouterAlgorithm::ALL_PAIRS:
+			return algorithm;
+		}
+		ThrowUnsupported("routing algorithm "s + std::to_string(value));
+	}
+
+	class SnapshotWriter {
+	public:
+		// the data is not copied and has to stay alive until Write
+		template <typename T>
+		void AddSection(uint32_t id, const T* data, size_t count) {
+			static_assert(std::is_trivially_copyable_v<T>, "snapshot sections hold plain data only");
+			sections_.push_back({ id, static_cast<uint32_t>(sizeof(T)), reinterpret_cast<const char*>(data), count * sizeof(T) });
+		}
+
+		template <typename T>
+		void AddSection(uint32_t id, const std::vector<T>& elements) {
+			AddSection(id, elements.data(), elements.size());
+		}
+
+		void Write(const std::filesystem::path& file) const {
+			std::vector<SectionEntry> table;
+			uint64_t offset = sizeof(Header) + sections_.size() * sizeof(SectionEntry);
+			for (const auto& section : sections_) {
+				offset = AlignUp(offset);
+				table.push_back({ section.id, section.element_size, offset, section.size, ComputeChecksum(section.data, section.size) });
+				offset += section.size;
+			}
+
+			std::ofstream out(file, std::ios::binary | std::ios::trunc);
+			if (!out) {
+				throw std::runtime_error("cannot write snapshot "s + file.string());
+			}
+			Header header{};
+			std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+			header.version = FORMAT_VERSION;
+			header.section_count = static_cast<uint32_t>(sections_.size());
+			header.checksum = ComputeChecksum(reinterpret_cast<const char*>(table.data()), table.size() * sizeof(SectionEntry));
+			out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+			uint64_t position = sizeof(Header);
+			auto write = [&out, &position](const char* data, size_t size) {
+				out.write(data, size);
+				position += size;
+			};
+			write(reinterpret_cast<const char*>(table.data()), table.size() * sizeof(SectionEntry));
+			static constexpr char PADDING[SECTION_ALIGNMENT] = {};
+			for (size_t i = 0; i < sections_.size(); ++i) {
+				write(PADDING, table[i].offset - position);
+				write(sections_[i].data, sections_[i].size);
+			}
+			if (!out) {
+				throw std::runtime_error("cannot write snapshot "s + file.string());
+			}
+		}
+
+	private:
+		struct PendingSection {
+			uint32_t id;
+			uint32_t element_size;
+			const char* data;
+			uint64_t size;
+		};
+		std::vector<PendingSection> sections_;
+	};
+
+	// Variable-length settings are stored as a byte stream in a single section
+	class ByteWriter {
+	public:
+		template <typename T>
+		void Write(const T& value) {
+			static_assert(std::is_trivially_copyable_v<T>);
+			const char* data = reinterpret_cast<const char*>(&value);
+			bytes_.insert(bytes_.end(), data, data + sizeof(T));
+		}
+
+		void WriteString(std::string_view value) {
+			Write(static_cast<uint32_t>(value.size()));
+			bytes_.insert(bytes_.end(), value.begin(), value.end());
+		}
+
+		void WritePoint(const svg::Point& point) {
+			Write(point.x);
+			Write(point.y);
+		}
+
+		void WriteColor(const svg::Color& color) {
+			Write(static_cast<uint8_t>(color.index()));
+			if (const auto* name = std::get_if<std::string>(&color)) {
+				WriteString(*name);
+			}
+			else if (const auto* rgb = std::get_if<svg::Rgb>(&color)) {
+				Write(rgb->red);
+				Write(rgb->green);
+				Write(rgb->blue);
+			}
+			else if (const auto* rgba = std::get_if<svg::Rgba>(&color)) {
+				Write(rgba->red);
+				Write(rgba->green);
+				Write(rgba->blue);
+				Write(rgba->opacity);
+			}
+		}
+
+		const std::vector<char>& GetBytes() const {
+			return bytes_;
+		}
+
+	private:
+		std::vector<char> bytes_;
+	};
+
+	class ByteReader {
+	public:
+		explicit ByteReader(const graph::ArrayStorage<char>& bytes)
+			: bytes_(bytes) {
+		}
+
+		template <typename T>
+		T Read() {
+			static_assert(std::is_trivially_copyable_v<T>);
+			T value;
+			std::memcpy(&value, Take(sizeof(T)), sizeof(T));
+			return value;
+		}
+
+		std::string ReadString() {
+			const uint32_t size = Read<uint32_t>();
+			return std::string(Take(size), size);
+		}
+
+		svg::Point ReadPoint() {
+			const double x = Read<double>();
+			const double y = Read<double>();
+			return { x, y };
+		}
+
+		svg::Color ReadColor() {
+			switch (Read<uint8_t>()) {
+			case 0:
+				return std::monostate{};
+			case 1:
+				return ReadString();
+			case 2: {
+				svg::Rgb rgb;
+				rgb.red = Read<uint8_t>();
+				rgb.green = Read<uint8_t>();
+				rgb.blue = Read<uint8_t>();
+				return rgb;
+			}
+			case 3: {
+				svg::Rgba rgba;
+				rgba.red = Read<uint8_t>();
+				rgba.green = Read<uint8_t>();
+				rgba.blue = Read<uint8_t>();
+				rgba.opacity = Read<double>();
+				return rgba;
+			}
+			default:
+				ThrowCorrupted();
+			}
+		}
+
+	private:
+		const graph::ArrayStorage<char>& bytes_;
+		size_t position_ = 0;
+
+		const char* Take(size_t size) {
+			if (size > bytes_.size() - position_) {
+				ThrowCorrupted();
+			}
+			const char* data = bytes_.data() + position_;
+			position_ += size;
+			return data;
+		}
+	};
+
+	StringRef AddString(std::vector<char>& strings, std::string_view value) {
+		const StringRef ref{ static_cast<uint32_t>(strings.size()), static_cast<uint32_t>(value.size()) };
+		strings.insert(strings.end(), value.begin(), value.end());
+		return ref;
+	}
+
+	std::string_view GetString(const graph::ArrayStorage<char>& strings, StringRef ref) {
+		if (ref.offset > strings.size() || ref.size > strings.size() - ref.offset) {
+			ThrowCorrupted();
+		}
+		return { strings.data() + ref.offset, ref.size };
+	}
+
+	std::vector<char> SerializeRenderSettings(const renderer::MapRenderer& renderer) {
+		ByteWriter writer;
+		writer.Write(renderer.width_);
+		writer.Write(renderer.height_);
+		writer.Write(renderer.padding_);
+		writer.Write(renderer.line_width_);
+		writer.Write(renderer.stop_radius_);
+		writer.Write(static_cast<int32_t>(renderer.bus_label_font_size_));
+		writer.WritePoint(renderer.bus_label_offset_);
+		writer.Write(static_cast<int32_t>(renderer.stop_label_font_size_));
+		writer.WritePoint(renderer.stop_label_offset_);
+		writer.WriteColor(renderer.underlayer_color_);
+		writer.Write(renderer.underlayer_width_);
+		writer.Write(static_cast<uint32_t>(renderer.color_palette_.size()));
+		for (const auto& color : renderer.color_palette_) {
+			writer.WriteColor(color);
+		}
+		writer.Write(renderer.simplify_tolerance_);
+		writer.Write(static_cast<uint8_t>(renderer.merge_shared_segments_));
+		writer.Write(renderer.min_stop_distance_);
+		return writer.GetBytes();
+	}
+}
+
+void serialization::SaveSnapshot(const SerializationSettings& settings, const transport_catalogue::TransportCatalogue& catalogue,
+	const renderer::MapRenderer& renderer, const transport_router::TransportRouter& router) {
+	std::vector<char> strings;
+
+	// stops are written in id order, so a record's index is the stop's id
+	std::vector<StopRecord> stops;
+	for (const Stop& stop : catalogue.GetStops()) {
+		stops.push_back({ AddString(strings, stop.name), stop.coordinates.lat, stop.coordinates.lng });
+	}
+
+	std::vector<BusRecord> buses;
+	std::vector<StopId> route_stops;
+	for (const Bus* bus : catalogue.GetBuses()) {
+		buses.push_back({ AddString(strings, bus->name), static_cast<uint32_t>(route_stops.size()),
+			bus->route_size, bus->is_roundtrip });
+		for (const StopId stop_id : catalogue.GetRoute(*bus)) {
+			route_stops.push_back(stop_id);
+		}
+	}
+
+	const std::vector<char> render_settings = SerializeRenderSettings(renderer);
+	const auto& params = router.GetParams();
+	const RoutingSettingsRecord routing_settings{ params.bus_velocity, params.bus_wait_time,
+		static_cast<uint32_t>(params.algorithm) };
+
+	SnapshotWriter writer;
+	writer.AddSection(STRINGS, strings);
+	writer.AddSection(STOPS, stops);
+	writer.AddSection(BUSES, buses);
+	writer.AddSection(ROUTE_STOPS, route_stops);
+	// the distance table is stored slot by slot, so loading it is a single copy instead of a rehash
+	writer.AddSection(DISTANCE_SLOTS, catalogue.GetStopsDistances().GetSlots());
+	writer.AddSection(RENDER_SETTINGS, render_settings);
+	writer.AddSection(ROUTING_SETTINGS, &routing_settings, 1);
+
+	const auto& graph = router.GetGraph();
+	writer.AddSection(GRAPH_EDGES, graph.GetEdges().data(), graph.GetEdges().size());
+	writer.AddSection(GRAPH_INCIDENCE_OFFSETS, graph.GetIncidenceOffsets().data(), graph.GetIncidenceOffsets().size());
+	if (const auto* contraction_hierarchy = router.GetRouter().GetContractionHierarchy()) {
+		const auto& index = contraction_hierarchy->GetSearchIndex();
+		writer.AddSection(HIERARCHY_EDGES, index.edges.data(), index.edges.size());
+		writer.AddSection(HIERARCHY_UPWARD_OFFSETS, index.upward_offsets.data(), index.upward_offsets.size());
+		writer.AddSection(HIERARCHY_UPWARD_EDGES, index.upward_edges.data(), index.upward_edges.size());
+		writer.AddSection(HIERARCHY_DOWNWARD_OFFSETS, index.downward_offsets.data(), index.downward_offsets.size());
+		writer.AddSection(HIERARCHY_DOWNWARD_EDGES, index.downward_edges.data(), index.downward_edges.size());
+	}
+	if (const auto* all_pairs_table = router.GetRouter().GetAllPairsTable()) {
+		const auto& matrices = all_pairs_table->GetMatrices();
+		writer.AddSection(ALL_PAIRS_WEIGHTS, matrices.weights.data(), matrices.weights.size());
+		writer.AddSection(ALL_PAIRS_LAST_EDGES, matrices.last_edges.data(), matrices.last_edges.size());
+	}
+	writer.Write(settings.file);
+}
+
+Snapshot::Snapshot(const SerializationSettings& settings) {
+	ReadFile(settings.file);
+	ParseSections();
+}
+
+Snapshot::~Snapshot() {
+#ifdef SNAPSHOT_USE_MMAP
+	if (is_mapped_) {
+		munmap(const_cast<char*>(data_), size_);
+	}
+#endif
+}
+
+void Snapshot::ReadFile(const std::filesystem::path& file) {
+#ifdef SNAPSHOT_USE_MMAP
+	const int fd = open(file.c_str(), O_RDONLY);
+	if (fd < 0) {
+		throw std::runtime_error("cannot open snapshot "s + file.string());
+	}
+	struct stat file_stat;
+	if (fstat(fd, &file_stat) != 0) {
+		close(fd);
+		throw std::runtime_error("cannot open snapshot "s + file.string());
+	}
+	size_ = static_cast<size_t>(file_stat.st_size);
+	if (size_ == 0) {
+		close(fd);
+		ThrowCorrupted();
+	}
+	void* mapping = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+	// the mapping stays valid after the descriptor is closed
+	close(fd);
+	if (mapping == MAP_FAILED) {
+		throw std::runtime_error("cannot map snapshot "s + file.string());
+	}
+	data_ = static_cast<const char*>(mapping);
+	is_mapped_ = true;
+#else
+	std::ifstream in(file, std::ios::binary);
+	if (!in) {
+		throw std::runtime_error("cannot open snapshot "s + file.string());
+	}
+	buffer_.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+	data_ = buffer_.data();
+	size_ = buffer_.size();
+#endif
+}
+
+void Snapshot::ParseSections() {
+	Header header;
+	if (size_ < sizeof(header)) {
+		ThrowCorrupted();
+	}
+	std::memcpy(&header, data_, sizeof(header));
+	if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0) {
+		throw std::runtime_error("file is not a transport catalogue snapshot");
+	}
+	if (header.version != FORMAT_VERSION) {
+		ThrowUnsupported("version "s + std::to_string(header.version));
+	}
+	if (header.section_count > (size_ - sizeof(header)) / sizeof(SectionEntry)) {
+		ThrowCorrupted();
+	}
+	if (ComputeChecksum(data_ + sizeof(header), header.section_count * sizeof(SectionEntry)) != header.checksum) {
+		ThrowCorrupted();
+	}
+
+	for (uint32_t i = 0; i < header.section_count; ++i) {
+		SectionEntry entry;
+		std::memcpy(&entry, data_ + sizeof(header) + i * sizeof(SectionEntry), sizeof(entry));
+		if (entry.offset % SECTION_ALIGNMENT != 0 || entry.offset > size_ || entry.size > size_ - entry.offset) {
+			ThrowCorrupted();
+		}
+		sections_[entry.id] = { data_ + entry.offset, entry.size, entry.element_size, entry.checksum };
+	}
+}
+
+bool Snapshot::HasSection(uint32_t id) const {
+	return sections_.count(id) > 0;
+}
+
+template <typename T>
+graph::ArrayStorage<T> Snapshot::GetArray(uint32_t id) const {
+	const auto it = sections_.find(id);
+	if (it == sections_.end()) {
+		ThrowCorrupted();
+	}
+	const Section& section = it->second;
+	if (!section.is_verified) {
+		if (ComputeChecksum(section.data, section.size) != section.checksum) {
+			ThrowCorrupted();
+		}
+		section.is_verified = true;
+	}
+	if (section.element_size != sizeof(T) || section.size % sizeof(T) != 0) {
+		throw std::runtime_error("snapshot was written by an incompatible build");
+	}
+	return { reinterpret_cast<const T*>(section.data), section.size / sizeof(T) };
+}
+
+// Stops and buses are added by id from the mapped arrays, without looking their names up, and the
+// distance table is copied as a whole. The catalogue still copies names and routes into its own storage
+void Snapshot::LoadCatalogue(transport_catalogue::TransportCatalogue& catalogue) const {
+	const auto strings = GetArray<char>(STRINGS);
+	const auto stops = GetArray<StopRecord>(STOPS);
+	const auto buses = GetArray<BusRecord>(BUSES);
+	const auto route_stops = GetArray<StopId>(ROUTE_STOPS);
+	for (const StopId stop_id : route_stops) {
+		if (stop_id >= stops.size()) {
+			ThrowCorrupted();
+		}
+	}
+
+	catalogue.Reserve(stops.size(), buses.size(), route_stops.size());
+	for (const auto& stop : stops) {
+		catalogue.AddStop(GetString(strings, stop.name), { stop.lat, stop.lng });
+	}
+	const auto distance_slots = GetArray<transport_catalogue::DistanceTable::Slot>(DISTANCE_SLOTS);
+	try {
+		catalogue.AssignStopDistances({ distance_slots.begin(), distance_slots.end() });
+	}
+	catch (const std::invalid_argument&) {
+		ThrowCorrupted();
+	}
+
+	for (const auto& bus : buses) {
+		if (bus.route_offset > route_stops.size() || bus.route_size > route_stops.size() - bus.route_offset) {
+			ThrowCorrupted();
+		}
+		const StopId* route = route_stops.data() + bus.route_offset;
+		catalogue.AddBus(GetString(strings, bus.name), ranges::Range{ route, route + bus.route_size }, bus.is_roundtrip != 0);
+	}
+}
+
+void Snapshot::LoadRenderSettings(renderer::MapRenderer& renderer) const {
+	const auto bytes = GetArray<char>(RENDER_SETTINGS);
+	ByteReader reader(bytes);
+	renderer.width_ = reader.Read<double>();
+	renderer.height_ = reader.Read<double>();
+	renderer.padding_ = reader.Read<double>();
+	renderer.line_width_ = reader.Read<double>();
+	renderer.stop_radius_ = reader.Read<double>();
+	renderer.bus_label_font_size_ = reader.Read<int32_t>();
+	renderer.bus_label_offset_ = reader.ReadPoint();
+	renderer.stop_label_font_size_ = reader.Read<int32_t>();
+	renderer.stop_label_offset_ = reader.ReadPoint();
+	renderer.underlayer_color_ = reader.ReadColor();
+	renderer.underlayer_width_ = reader.Read<double>();
+	const uint32_t palette_size = reader.Read<uint32_t>();
+	renderer.color_palette_.clear();
+	for (uint32_t i = 0; i < palette_size; ++i) {
+		renderer.color_palette_.push_back(reader.ReadColor());
+	}
+	renderer.simplify_tolerance_ = reader.Read<double>();
+	renderer.merge_shared_segments_ = reader.Read<uint8_t>() != 0;
+	renderer.min_stop_distance_ = reader.Read<double>();
+}
+
+transport_router::TranspRouteParams Snapshot::GetRoutingSettings() const {
+	const auto records = GetArray<RoutingSettingsRecord>(ROUTING_SETTINGS);
+	if (records.size() != 1) {
+		ThrowCorrupted();
+	}
+	transport_router::TranspRouteParams params;
+	params.bus_wait_time = records[0].bus_wait_time;
+	params.bus_velocity = records[0].bus_velocity;
+	params.algorithm = GetRouterAlgorithm(records[0].algorithm);
+	return params;
+}
+
+transport_router::Graph Snapshot::GetRoutingGraph() const {
+	return transport_router::Graph(GetArray<graph::Edge<double>>(GRAPH_EDGES), GetArray<graph::EdgeId>(GRAPH_INCIDENCE_OFFSETS));
+}
+
+std::optional<graph::ContractionHierarchy<double>> Snapshot::GetContractionHierarchy() const {
+	if (!HasSection(HIERARCHY_EDGES)) {
+		return std::nullopt;
+	}
+	graph::ContractionHierarchy<double>::SearchIndex index{
+		GetArray<graph::ContractionHierarchy<double>::HierarchyEdge>(HIERARCHY_EDGES),
+		GetArray<graph::EdgeId>(HIERARCHY_UPWARD_OFFSETS),
+		GetArray<graph::EdgeId>(HIERARCHY_UPWARD_EDGES),
+		GetArray<graph::EdgeId>(HIERARCHY_DOWNWARD_OFFSETS),
+		GetArray<graph::EdgeId>(HIERARCHY_DOWNWARD_EDGES)
+	};
+	return graph::ContractionHierarchy<double>(std::move(index));
+}
+
+std::optional<graph::AllPairsTable<double>> Snapshot::GetAllPairsTable() const {
+	if (!HasSection(ALL_PAIRS_WEIGHTS)) {
+		return std::nullopt;
+	}
+	graph::AllPairsTable<double>::Matrices matrices{
+		GetArray<double>(ALL_PAIRS_WEIGHTS),
+		GetArray<graph::EdgeId>(ALL_PAIRS_LAST_EDGES)
+	};
+	try {
+		return graph::AllPairsTable<double>(std::move(matrices));
+	}
+	catch (const std::invalid_argument&) {
+		ThrowCorrupted();
+	}
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+#include "map_renderer.h"
+#include "transport_catalogue.h"
+#include "transport_router.h"
+
+namespace serialization {
+
+	struct SerializationSettings {
+		std::filesystem::path file;
+	};
+
+	// Snapshot file layout: a header with the format version and a checksum of the section table,
+	// a table of sections with a checksum of each, and the sections themselves, each aligned to 8 bytes.
+	// Arrays are stored in the in-memory layout of this build, so the snapshot is meant to be read
+	// by the same build that wrote it; the version and element sizes guard against mismatches
+	void SaveSnapshot(const SerializationSettings& settings, const transport_catalogue::TransportCatalogue& catalogue,
+		const renderer::MapRenderer& renderer, const transport_router::TransportRouter& router);
+
+	// Maps the snapshot file into memory. The routing graph, the contraction hierarchy and the all-pairs table refer
+	// to the mapping instead of copying it, so the snapshot has to outlive the router using them.
+	// A section's checksum is verified when the section is first read, so sections a run does not
+	// need are never hashed. Loading is therefore not thread-safe
+	class Snapshot {
+	public:
+		explicit Snapshot(const SerializationSettings& settings);
+		~Snapshot();
+
+		Snapshot(const Snapshot&) = delete;
+		Snapshot& operator=(const Snapshot&) = delete;
+
+		void LoadCatalogue(transport_catalogue::TransportCatalogue& catalogue) const;
+		void LoadRenderSettings(renderer::MapRenderer& renderer) const;
+		transport_router::TranspRouteParams GetRoutingSettings() const;
+		transport_router::Graph GetRoutingGraph() const;
+		// std::nullopt if the router was not using a contraction hierarchy
+		std::optional<graph::ContractionHierarchy<double>> GetContractionHierarchy() const;
+		// std::nullopt if the router was not using an all-pairs table
+		std::optional<graph::AllPairsTable<double>> GetAllPairsTable() const;
+
+	private:
+		struct Section {
+			const char* data;
+			uint64_t size;
+			uint32_t element_size;
+			uint64_t checksum;
+			mutable bool is_verified = false;
+		};
+
+		const char* data_ = nullptr;
+		size_t size_ = 0;
+		bool is_mapped_ = false;
+		// file contents when memory mapping is not available
+		std::vector<char> buffer_;
+		std::unordered_map<uint32_t, Section> sections_;
+
+		void ReadFile(const std::filesystem::path& file);
+		void ParseSections();
+		bool HasSection(uint32_t id) const;
+
+		template <typename T>
+		graph::ArrayStorage<T> GetArray(uint32_t id) const;
+	};
+}
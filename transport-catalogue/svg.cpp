@@ -1,50 +1,157 @@
 ﻿#include "svg.h"
-#include <regex>
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <iterator>
+
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__)
+#include <emmintrin.h>
+// SSE2 есть на любом x86-64
+#define SVG_X86_SIMD
+#endif
 
 namespace svg {
 
     using namespace std::literals;
 
-    std::ostream& operator<<(std::ostream& out, StrokeLineCap line_cap) {
-        using namespace std::literals;
-        switch (line_cap) {
-        case StrokeLineCap::BUTT:
-            out << "butt"sv;
-            break;
-        case StrokeLineCap::ROUND:
-            out << "round"sv;
-            break;
-        case StrokeLineCap::SQUARE:
-            out << "square"sv;
-            break;
-        default:
-            break;
+    namespace {
+
+        std::string_view GetLineCapName(StrokeLineCap line_cap) {
+            switch (line_cap) {
+            case StrokeLineCap::BUTT:
+                return "butt"sv;
+            case StrokeLineCap::ROUND:
+                return "round"sv;
+            case StrokeLineCap::SQUARE:
+                return "square"sv;
+            default:
+                return {};
+            }
+        }
+
+        std::string_view GetLineJoinName(StrokeLineJoin line_join) {
+            switch (line_join) {
+            case StrokeLineJoin::ARCS:
+                return "arcs"sv;
+            case StrokeLineJoin::BEVEL:
+                return "bevel"sv;
+            case StrokeLineJoin::MITER:
+                return "miter"sv;
+            case StrokeLineJoin::MITER_CLIP:
+                return "miter-clip"sv;
+            case StrokeLineJoin::ROUND:
+                return "round"sv;
+            default:
+                return {};
+            }
+        }
+
+        // Замены символов, которые нельзя выводить в тексте как есть; у остальных символов замена пустая
+        constexpr std::array<std::string_view, 256> MakeXmlEscapes() {
+            std::array<std::string_view, 256> escapes{};
+            escapes['"'] = "&quot;"sv;
+            escapes['\''] = "&apos;"sv;
+            escapes['<'] = "&lt;"sv;
+            escapes['>'] = "&gt;"sv;
+            escapes['&'] = "&amp;"sv;
+            return escapes;
+        }
+
+        constexpr std::array<std::string_view, 256> XML_ESCAPES = MakeXmlEscapes();
+
+        // Вызывает callback(i) для каждого символа text[i], который надо заменить, по порядку
+        template <typename Callback>
+        void ForEachXmlSpecial(std::string_view text, Callback callback) {
+            size_t i = 0;
+#ifdef SVG_X86_SIMD
+            // по 16 байт за сравнение, как в сканерах JSON; найденные в блоке символы перебираются по битам маски
+            const __m128i quote = _mm_set1_epi8('"');
+            const __m128i apostrophe = _mm_set1_epi8('\'');
+            const __m128i less = _mm_set1_epi8('<');
+            const __m128i greater = _mm_set1_epi8('>');
+            const __m128i ampersand = _mm_set1_epi8('&');
+            for (; i + 16 <= text.size(); i += 16) {
+                const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text.data() + i));
+                const __m128i hits = _mm_or_si128(
+                    _mm_or_si128(_mm_cmpeq_epi8(block, quote), _mm_cmpeq_epi8(block, apostrophe)),
+                    _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(block, less), _mm_cmpeq_epi8(block, greater)),
+                        _mm_cmpeq_epi8(block, ampersand)));
+                for (unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(hits)); mask != 0; mask &= mask - 1) {
+                    callback(i + __builtin_ctz(mask));
+                }
+            }
+#endif
+            for (; i < text.size(); ++i) {
+                if (!XML_ESCAPES[static_cast<unsigned char>(text[i])].empty()) {
+                    callback(i);
+                }
+            }
+        }
+
+        // Первый проход только считает длину результата, так что память выделяется один раз,
+        // второй пишет в неё куски между спецсимволами и замены. Текст без спецсимволов копируется одним вызовом
+        void RenderEscapedText(OutputBuffer& out, std::string_view text) {
+            size_t escaped_size = text.size();
+            ForEachXmlSpecial(text, [&](size_t i) {
+                escaped_size += XML_ESCAPES[static_cast<unsigned char>(text[i])].size() - 1;
+            });
+            if (escaped_size == text.size()) {
+                out << text;
+                return;
+            }
+            char* output = out.Extend(escaped_size);
+            size_t plain_start = 0;
+            ForEachXmlSpecial(text, [&](size_t i) {
+                const std::string_view escape = XML_ESCAPES[static_cast<unsigned char>(text[i])];
+                output = std::copy(text.data() + plain_start, text.data() + i, output);
+                output = std::copy(escape.begin(), escape.end(), output);
+                plain_start = i + 1;
+            });
+            std::copy(text.data() + plain_start, text.data() + text.size(), output);
         }
-        return out;
+
+        template <typename Number, typename... Format>
+        void AppendNumber(std::string& output, Number value, Format... format) {
+            char buffer[32];
+            const auto result = std::to_chars(std::begin(buffer), std::end(buffer), value, format...);
+            output.append(buffer, result.ptr);
+        }
+
+    }  // namespace
+
+    std::ostream& operator<<(std::ostream& out, StrokeLineCap line_cap) {
+        return out << GetLineCapName(line_cap);
+    }
+
+    OutputBuffer& operator<<(OutputBuffer& out, StrokeLineCap line_cap) {
+        return out << GetLineCapName(line_cap);
     }
 
     std::ostream& operator<<(std::ostream& out, StrokeLineJoin line_join) {
-        using namespace std::literals;
-        switch (line_join) {
-        case StrokeLineJoin::ARCS:
-            out << "arcs"sv;
-            break;
-        case StrokeLineJoin::BEVEL:
-            out << "bevel"sv;
-            break;
-        case StrokeLineJoin::MITER:
-            out << "miter"sv;
-            break;
-        case StrokeLineJoin::MITER_CLIP:
-            out << "miter-clip"sv;
-            break;
-        case StrokeLineJoin::ROUND:
-            out << "round"sv;
-            break;
-        default:
-            break;
-        }
-        return out;
+        return out << GetLineJoinName(line_join);
+    }
+
+    OutputBuffer& operator<<(OutputBuffer& out, StrokeLineJoin line_join) {
+        return out << GetLineJoinName(line_join);
+    }
+
+    // ---------- OutputBuffer ------------------
+
+    OutputBuffer& OutputBuffer::operator<<(int value) {
+        AppendNumber(output_, value);
+        return *this;
+    }
+
+    OutputBuffer& OutputBuffer::operator<<(uint32_t value) {
+        AppendNumber(output_, value);
+        return *this;
+    }
+
+    // ostream по умолчанию выводит double как printf("%g"), то есть с 6 значащими цифрами
+    OutputBuffer& OutputBuffer::operator<<(double value) {
+        AppendNumber(output_, value, std::chars_format::general, 6);
+        return *this;
     }
 
     void Object::Render(const RenderContext& context) const {
@@ -53,7 +160,7 @@ namespace svg {
         // Делегируем вывод тега своим подклассам
         RenderObject(context);
 
-        context.out << std::endl;
+        context.out << '\n';
     }
 
     // ---------- Circle ------------------
@@ -82,19 +189,22 @@ namespace svg {
         return *this;
     }
 
+    Polyline& Polyline::Reserve(size_t count) {
+        points_.reserve(count);
+        return *this;
+    }
+
     void Polyline::RenderObject(const RenderContext& context) const {
 
         auto& out = context.out;
         out << "<polyline points=\""sv;
-        if (!points_.empty()) {
-            bool is_first = true;
-            std::string delim;
-            for (const auto& point : points_) {
-                is_first ? delim = "" : delim = " ";
-                out << delim << point.x << ","sv << point.y;
-                is_first = false;
+        bool is_first = true;
+        for (const auto& point : points_) {
+            if (!is_first) {
+                out << ' ';
             }
-
+            out << point.x << ","sv << point.y;
+            is_first = false;
         }
         out << "\""sv;
         RenderAttrs(context.out);
@@ -120,56 +230,20 @@ namespace svg {
     }
 
     Text& Text::SetFontFamily(std::string font_family) {
-        font_family_ = font_family;
+        font_family_ = std::move(font_family);
         return *this;
     }
 
     Text& Text::SetFontWeight(std::string font_weight) {
-        font_weight_ = font_weight;
+        font_weight_ = std::move(font_weight);
         return *this;
     }
 
     Text& Text::SetData(std::string data) {
-        data_ = data;
+        data_ = std::move(data);
         return *this;
     }
 
-    std::string Text::PrepareTextData(std::string data) const {
-        std::vector<std::string> replace_values = { "&quot;"s , "&apos;"s , "&lt;"s , "&gt;"s , "&amp;"s };
-        for (size_t i = 0; i < data.size(); ) {
-            std::string curr_replace_value;
-            switch (data[i])
-            {
-            case '\"':
-                curr_replace_value = replace_values[0];
-                break;
-            case '\'':
-                curr_replace_value = replace_values[1];
-                break;
-            case '<':
-                curr_replace_value = replace_values[2];
-                break;
-            case '>':
-                curr_replace_value = replace_values[3];
-                break;
-            case '&':
-                curr_replace_value = replace_values[4];
-                break;
-            default:
-                break;
-            }
-            if (!curr_replace_value.empty()) {
-                data.insert(i, curr_replace_value);
-                i += replace_values[0].size() - 1;
-            }
-            else {
-                ++i;
-            }
-
-        }
-        return data;
-    }
-
     void Text::RenderObject(const RenderContext& context) const {
         auto& out = context.out;
         out << "<text"sv;
@@ -189,7 +263,9 @@ namespace svg {
         }
         
 
-        out << ">"sv << PrepareTextData(data_) << "</text>"sv;
+        out << ">"sv;
+        RenderEscapedText(out, data_);
+        out << "</text>"sv;
     }
 
     // ---------- Document ------------------
@@ -198,12 +274,32 @@ namespace svg {
     }
 
     void Document::Render(std::ostream& out) const {
-        out << "<?xml version=\"1.0\" encoding=\"UTF-8\" ?>"sv << std::endl;
-        out << "<svg xmlns=\"http://www.w3.org/2000/svg\" version=\"1.1\">"sv << std::endl;
+        std::string output;
+        Render(output);
+        out.write(output.data(), output.size());
+    }
+
+    void Document::Render(std::string& out) const {
+        DocumentWriter writer(out);
         for (const auto& object : objects_) {
-            object->Render(RenderContext(out));
+            writer.Add(*object);
         }
-        out << "</svg>"sv;
+        writer.Finish();
+    }
+
+    // ---------- DocumentWriter ------------------
+    DocumentWriter::DocumentWriter(std::string& output)
+        : out_(output) {
+        out_ << "<?xml version=\"1.0\" encoding=\"UTF-8\" ?>\n"sv;
+        out_ << "<svg xmlns=\"http://www.w3.org/2000/svg\" version=\"1.1\">\n"sv;
+    }
+
+    void DocumentWriter::Add(const Object& object) {
+        object.Render(RenderContext(out_));
+    }
+
+    void DocumentWriter::Finish() {
+        out_ << "</svg>"sv;
     }
 
 
@@ -5,6 +5,7 @@
 #include <memory>
 #include <optional>
 #include <string>
+#include <string_view>
 #include <utility>
 #include <variant>
 #include <vector>
@@ -48,26 +49,63 @@ namespace svg {
     // В противном случае каждая единица трансляции будет использовать свою копию этой константы
     inline const Color NoneColor{ "none" };
 
+    /*
+     * Дописывает вывод в конец строки, которая растёт по мере надобности.
+     * Числа выводятся так же, как их выводит ostream с настройками по умолчанию
+     */
+    class OutputBuffer {
+    public:
+        explicit OutputBuffer(std::string& output)
+            : output_(output) {
+        }
+
+        OutputBuffer& operator<<(std::string_view text) {
+            output_.append(text);
+            return *this;
+        }
+        OutputBuffer& operator<<(char c) {
+            output_.push_back(c);
+            return *this;
+        }
+        OutputBuffer& operator<<(int value);
+        OutputBuffer& operator<<(uint32_t value);
+        OutputBuffer& operator<<(double value);
+        // дописывает size символов, которые вызывающий заполнит сам, и возвращает указатель на первый из них
+        char* Extend(size_t size) {
+            const size_t old_size = output_.size();
+            output_.resize(old_size + size);
+            return output_.data() + old_size;
+        }
+
+    private:
+        std::string& output_;
+    };
+
+    // Выводит цвет в поток или в OutputBuffer
+    template <typename Output>
     struct ColorPrinter {
 
-        std::ostream& out;
+        Output& out;
         void operator()(std::monostate) const {
             using namespace std::literals;
             out << "none"sv;
         }
-        void operator()(std::string color) const {
+        void operator()(const std::string& color) const {
             out << color;
         }
         void operator()(Rgb rgb) const {
             using namespace std::literals;
-            out << "rgb("sv << std::to_string(rgb.red) << ","sv << std::to_string(rgb.green) << ","sv << std::to_string(rgb.blue) << ")"sv;
+            out << "rgb("sv << static_cast<int>(rgb.red) << ","sv << static_cast<int>(rgb.green) << ","sv << static_cast<int>(rgb.blue) << ")"sv;
         }
         void operator()(Rgba rgba) const {
             using namespace std::literals;
-            out << "rgba("sv << std::to_string(rgba.red) << ","sv << std::to_string(rgba.green) << ","sv << std::to_string(rgba.blue) << ","sv << rgba.opacity << ")"sv;
+            out << "rgba("sv << static_cast<int>(rgba.red) << ","sv << static_cast<int>(rgba.green) << ","sv << static_cast<int>(rgba.blue) << ","sv << rgba.opacity << ")"sv;
         }
     };
 
+    template <typename Output>
+    ColorPrinter(Output&) -> ColorPrinter<Output>;
+
     enum class StrokeLineCap {
         BUTT,
         ROUND,
@@ -75,6 +113,7 @@ namespace svg {
     };
 
     std::ostream& operator<<(std::ostream& out, StrokeLineCap line_cap);
+    OutputBuffer& operator<<(OutputBuffer& out, StrokeLineCap line_cap);
 
     enum class StrokeLineJoin {
         ARCS,
@@ -85,18 +124,19 @@ namespace svg {
     };
 
     std::ostream& operator<<(std::ostream& out, StrokeLineJoin line_join);
+    OutputBuffer& operator<<(OutputBuffer& out, StrokeLineJoin line_join);
 
 
     /*
      * Вспомогательная структура, хранящая контекст для вывода SVG-документа с отступами.
-     * Хранит ссылку на поток вывода, текущее значение и шаг отступа при выводе элемента
+     * Хранит ссылку на буфер вывода, текущее значение и шаг отступа при выводе элемента
      */
     struct RenderContext {
-        RenderContext(std::ostream& out)
+        RenderContext(OutputBuffer& out)
             : out(out) {
         }
 
-        RenderContext(std::ostream& out, int indent_step, int indent = 0)
+        RenderContext(OutputBuffer& out, int indent_step, int indent = 0)
             : out(out)
             , indent_step(indent_step)
             , indent(indent) {
@@ -108,11 +148,11 @@ namespace svg {
 
         void RenderIndent() const {
             for (int i = 0; i < indent; ++i) {
-                out.put(' ');
+                out << ' ';
             }
         }
 
-        std::ostream& out;
+        OutputBuffer& out;
         int indent_step = 0;
         int indent = 0;
     };
@@ -160,7 +200,7 @@ namespace svg {
         ~PathProps() = default;
 
         // Метод RenderAttrs выводит в поток общие для всех путей атрибуты fill и stroke
-        void RenderAttrs(std::ostream& out) const {
+        void RenderAttrs(OutputBuffer& out) const {
             using namespace std::literals;
 
             if (!std::holds_alternative<std::monostate>(fill_color_)) {
@@ -222,6 +262,8 @@ namespace svg {
     public:
         // Добавляет очередную вершину к ломаной линии
         Polyline& AddPoint(Point point);
+        // Заранее выделяет память под count вершин
+        Polyline& Reserve(size_t count);
 
     private:
         void RenderObject(const RenderContext& context) const override;
@@ -254,7 +296,6 @@ namespace svg {
 
     private:
         void RenderObject(const RenderContext& context) const override;
-        std::string PrepareTextData(std::string data) const;
         Point position_ = { 0.0, 0.0 };
         Point offset_ = { 0.0, 0.0 };
         uint32_t font_size_ = 1;
@@ -295,9 +336,28 @@ namespace svg {
         void AddPtr(std::unique_ptr<Object>&& obj) override;
         // Выводит в ostream svg-представление документа
         void Render(std::ostream& out) const;
+        // Дописывает svg-представление документа в конец строки
+        void Render(std::string& out) const;
 
     private:
         std::vector<std::unique_ptr<Object>> objects_;
     };
 
+    /*
+     * Выводит объекты в строку сразу при добавлении, не храня их, поэтому
+     * на каждый объект не нужно выделять память. Результат тот же, что у Document::Render
+     */
+    class DocumentWriter {
+    public:
+        // Сразу выводит заголовок документа
+        explicit DocumentWriter(std::string& output);
+
+        void Add(const Object& object);
+        // Закрывает документ, после этого объекты добавлять нельзя
+        void Finish();
+
+    private:
+        OutputBuffer out_;
+    };
+
 }  // namespace svg
@@ -0,0 +1,101 @@
+#include "../geo.h"
+#include "testing.h"
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace std::literals;
+
+namespace {
+
+    // random points all over the globe, each followed by the same point and by its antipode
+    std::vector<geo::Coordinates> MakePoints(uint32_t seed, size_t count) {
+        std::mt19937 generator(seed);
+        std::uniform_real_distribution<double> lat(-90.0, 90.0);
+        std::uniform_real_distribution<double> lng(-180.0, 180.0);
+        std::vector<geo::Coordinates> points;
+        for (size_t i = 0; i < count; ++i) {
+            const geo::Coordinates point{ lat(generator), lng(generator) };
+            points.push_back(point);
+            points.push_back(point);
+            points.push_back({ -point.lat, point.lng > 0 ? point.lng - 180.0 : point.lng + 180.0 });
+        }
+        // poles, the date line and neighbours a few metres apart
+        points.push_back({ 90.0, 0.0 });
+        points.push_back({ -90.0, 0.0 });
+        points.push_back({ 0.0, 180.0 });
+        points.push_back({ 0.0, -180.0 });
+        points.push_back({ 55.75, 37.62 });
+        points.push_back({ 55.75001, 37.62001 });
+        return points;
+    }
+
+    // the batch over a random walk through the points that also steps over every neighbouring pair
+    template <typename BatchMethod, typename Function>
+    void CheckBatchMatches(BatchMethod method, Function function) {
+        const std::vector<geo::Coordinates> points = MakePoints(7, 300);
+        geo::PointBatch batch;
+        for (const geo::Coordinates& point : points) {
+            batch.Add(point);
+        }
+        std::vector<uint32_t> route;
+        for (uint32_t i = 0; i < points.size(); ++i) {
+            route.push_back(i);
+        }
+        std::mt19937 generator(8);
+        for (int i = 0; i < 1000; ++i) {
+            route.push_back(static_cast<uint32_t>(generator() % points.size()));
+        }
+
+        std::vector<double> distances(route.size() - 1);
+        (batch.*method)(route.data(), route.size(), distances.data());
+        size_t mismatch_count = 0;
+        for (size_t i = 0; i + 1 < route.size(); ++i) {
+            const double expected = function(points[route[i]], points[route[i + 1]]);
+            // bit for bit, as PointBatch promises
+            if (!(distances[i] == expected || (std::isnan(distances[i]) && std::isnan(expected)))) {
+                ++mismatch_count;
+            }
+        }
+        CHECK(mismatch_count == 0);
+    }
+
+    void TestComputeDistances() {
+        CheckBatchMatches(&geo::PointBatch::ComputeDistances, geo::ComputeDistance);
+    }
+
+    void TestComputeHaversineDistances() {
+        CheckBatchMatches(&geo::PointBatch::ComputeHaversineDistances, geo::ComputeHaversineDistance);
+    }
+
+    void TestHaversineSpecialPoints() {
+        constexpr double HALF_CIRCUMFERENCE = 3.1415926535 * 6371000;
+        const geo::Coordinates point{ 55.75, 37.62 };
+        CHECK(geo::ComputeHaversineDistance(point, point) == 0.0);
+        // antipodal points must not give NaN from a rounding error above 1 under the root
+        const double antipodal = geo::ComputeHaversineDistance(point, { -55.75, 37.62 - 180.0 });
+        CHECK(std::abs(antipodal - HALF_CIRCUMFERENCE) < 1.0);
+        CHECK(std::abs(geo::ComputeHaversineDistance({ 90.0, 0.0 }, { -90.0, 0.0 }) - HALF_CIRCUMFERENCE) < 1.0);
+        // about 1.3 m, where the law of cosines loses most of its digits
+        const double short_distance = geo::ComputeHaversineDistance(point, { 55.75001, 37.62001 });
+        CHECK(short_distance > 1.2 && short_distance < 1.4);
+
+        geo::PointBatch batch;
+        batch.Add(point);
+        batch.Add({ -55.75, 37.62 - 180.0 });
+        const uint32_t route[] = { 0, 0, 1, 0 };
+        double distances[3];
+        batch.ComputeHaversineDistances(route, 4, distances);
+        CHECK(distances[0] == 0.0);
+        CHECK(distances[1] == antipodal && distances[2] == antipodal);
+    }
+
+}  // namespace
+
+int main() {
+    testing::RunTest("TestComputeDistances"sv, TestComputeDistances);
+    testing::RunTest("TestComputeHaversineDistances"sv, TestComputeHaversineDistances);
+    testing::RunTest("TestHaversineSpecialPoints"sv, TestHaversineSpecialPoints);
+    return testing::GetExitCode();
+}
@@ -0,0 +1,374 @@
+#include "../json.h"
+#include "testing.h"
+
+#include <optional>
+#include <random>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std::literals;
+
+namespace {
+
+    // Builds Nodes from the events of json::Parse, to compare them with json::Load
+    class NodeBuilder final : public json::EventHandler {
+    public:
+        void StartDict() override {
+            frames_.push_back({ json::Dict{}, std::move(key_) });
+        }
+        void Key(std::string_view key) override {
+            key_ = std::string(key);
+        }
+        void EndDict() override {
+            EndContainer();
+        }
+        void StartArray() override {
+            frames_.push_back({ json::Array{}, std::move(key_) });
+        }
+        void EndArray() override {
+            EndContainer();
+        }
+        void Null() override {
+            Add(json::Node{ nullptr });
+        }
+        void Bool(bool value) override {
+            Add(json::Node{ value });
+        }
+        void Int(int value) override {
+            Add(json::Node{ value });
+        }
+        void Double(double value) override {
+            Add(json::Node{ value });
+        }
+        void String(std::string_view value) override {
+            Add(json::Node{ std::string(value) });
+        }
+
+        json::Node Build() {
+            return std::move(root_);
+        }
+
+    private:
+        struct Frame {
+            json::Node container;
+            // the key of the container in its parent dict
+            std::string key;
+        };
+
+        std::vector<Frame> frames_;
+        std::string key_;
+        json::Node root_;
+
+        void Add(json::Node value) {
+            if (frames_.empty()) {
+                root_ = std::move(value);
+            }
+            else if (frames_.back().container.IsArray()) {
+                std::get<json::Array>(frames_.back().container.GetValue()).push_back(std::move(value));
+            }
+            else {
+                std::get<json::Dict>(frames_.back().container.GetValue())[std::move(key_)] = std::move(value);
+            }
+        }
+
+        void EndContainer() {
+            Frame frame = std::move(frames_.back());
+            frames_.pop_back();
+            key_ = std::move(frame.key);
+            Add(std::move(frame.container));
+        }
+    };
+
+    // the document, or nullopt if the parser rejects it
+    std::optional<json::Node> ParseWithEvents(const std::string& text) {
+        try {
+            NodeBuilder builder;
+            json::Parse(text, builder);
+            return builder.Build();
+        }
+        catch (const json::ParsingError&) {
+            return std::nullopt;
+        }
+    }
+
+    // the same through the stream parser, whose buffer is refilled every buffer_size bytes
+    std::optional<json::Node> ParseStreamWithEvents(const std::string& text, size_t buffer_size) {
+        try {
+            NodeBuilder builder;
+            std::istringstream input(text);
+            json::Parse(input, builder, buffer_size);
+            return builder.Build();
+        }
+        catch (const json::ParsingError&) {
+            return std::nullopt;
+        }
+    }
+
+    std::optional<json::Node> LoadWithStream(const std::string& text) {
+        try {
+            std::istringstream input(text);
+            return json::Load(input).GetRoot();
+        }
+        catch (const json::ParsingError&) {
+            return std::nullopt;
+        }
+    }
+
+    bool ParsesAsLoad(const std::string& text) {
+        return ParseWithEvents(text) == LoadWithStream(text);
+    }
+
+    const std::vector<json::Scanner> ALL_SCANNERS = {
+        json::Scanner::SCALAR, json::Scanner::SSE2, json::Scanner::AVX2 };
+
+    const char* GetScannerName(json::Scanner scanner) {
+        switch (scanner) {
+        case json::Scanner::SCALAR:
+            return "scalar";
+        case json::Scanner::SSE2:
+            return "SSE2";
+        default:
+            return "AVX2";
+        }
+    }
+
+    // runs the check with every scanner the processor supports and returns to the default one
+    template <typename Check>
+    void ForEachScanner(Check check) {
+        const json::Scanner default_scanner = json::IsScannerSupported(json::Scanner::AVX2)
+            ? json::Scanner::AVX2
+            : json::IsScannerSupported(json::Scanner::SSE2) ? json::Scanner::SSE2 : json::Scanner::SCALAR;
+        for (const json::Scanner scanner : ALL_SCANNERS) {
+            if (!json::IsScannerSupported(scanner)) {
+                std::cerr << "  the " << GetScannerName(scanner) << " scanner is not supported here, skipped\n";
+                continue;
+            }
+            json::SetScanner(scanner);
+            check(scanner);
+        }
+        json::SetScanner(default_scanner);
+    }
+
+    std::string MakeSpaces(std::mt19937& generator, size_t max_count) {
+        std::string spaces(generator() % (max_count + 1), ' ');
+        for (char& c : spaces) {
+            c = " \t\n\r\v\f"[generator() % 6];
+        }
+        return spaces;
+    }
+
+    const std::vector<std::string_view> ESCAPES = { "\\\\"sv, "\\\""sv, "\\n"sv, "\\t"sv, "\\r"sv };
+
+    std::string MakeStringToken(std::mt19937& generator) {
+        std::string token = "\"";
+        // long plain runs cross the 16 and 32 byte blocks of the scanners
+        for (size_t length = generator() % 80; length > 0; --length) {
+            const uint32_t kind = generator() % 20;
+            if (kind == 0) {
+                token += ESCAPES[generator() % ESCAPES.size()];
+            }
+            else if (kind == 1) {
+                token += "Ю"sv;
+            }
+            else {
+                token += static_cast<char>('a' + generator() % 26);
+            }
+        }
+        return token + '"';
+    }
+
+    void AppendRandomValue(std::mt19937& generator, int depth, std::string& text) {
+        const uint32_t kind = depth == 0 ? generator() % 5 : generator() % 7;
+        switch (kind) {
+        case 0:
+            text += "null"sv;
+            break;
+        case 1:
+            text += generator() % 2 == 0 ? "true"sv : "false"sv;
+            break;
+        case 2: {
+            const int value = static_cast<int>(generator());
+            const int divisor = static_cast<int>(generator() % 1000 + 1);
+            text += std::to_string(value / divisor);
+            break;
+        }
+        case 3: {
+            const int whole = static_cast<int>(generator() % 2000) - 1000;
+            const int fraction = static_cast<int>(generator() % 1000);
+            text += std::to_string(whole) + '.' + std::to_string(fraction);
+            if (generator() % 3 == 0) {
+                const int exponent = static_cast<int>(generator() % 40) - 20;
+                text += 'e' + std::to_string(exponent);
+            }
+            break;
+        }
+        case 4:
+            text += MakeStringToken(generator);
+            break;
+        case 5: {
+            text += '[';
+            for (uint32_t size = generator() % 6, i = 0; i < size; ++i) {
+                text += i == 0 ? ""s : ","s;
+                text += MakeSpaces(generator, 40);
+                AppendRandomValue(generator, depth - 1, text);
+                text += MakeSpaces(generator, 3);
+            }
+            text += MakeSpaces(generator, 20);
+            text += ']';
+            break;
+        }
+        default: {
+            text += '{';
+            for (uint32_t size = generator() % 6, i = 0; i < size; ++i) {
+                text += i == 0 ? ""s : ","s;
+                text += MakeSpaces(generator, 40);
+                text += MakeStringToken(generator);
+                text += MakeSpaces(generator, 3);
+                text += ':';
+                text += MakeSpaces(generator, 35);
+                AppendRandomValue(generator, depth - 1, text);
+            }
+            text += MakeSpaces(generator, 20);
+            text += '}';
+            break;
+        }
+        }
+    }
+
+    void TestRandomDocuments() {
+        std::mt19937 generator(11);
+        std::vector<std::string> documents;
+        for (int i = 0; i < 400; ++i) {
+            std::string text = MakeSpaces(generator, 40);
+            AppendRandomValue(generator, 5, text);
+            documents.push_back(std::move(text));
+        }
+        ForEachScanner([&](json::Scanner) {
+            size_t mismatch_count = 0;
+            for (const std::string& text : documents) {
+                mismatch_count += ParsesAsLoad(text) ? 0 : 1;
+            }
+            CHECK(mismatch_count == 0);
+        });
+    }
+
+    // A quote, an escape or a line break right after `offset` plain bytes from where the scanner starts,
+    // for the offsets at the edges of the 16 and 32 byte blocks; the same with the whitespace scanner
+    void TestBlockEdges() {
+        ForEachScanner([&](json::Scanner) {
+            size_t mismatch_count = 0;
+            size_t parsed_count = 0;
+            for (size_t offset = 0; offset <= 66; ++offset) {
+                const std::string run(offset, 'x');
+                const std::string spaces(offset, ' ');
+                for (const std::string& text : {
+                    // the closing quote, an escaped quote or backslash, a raw line break
+                    "[\""s + run + "\", 1]"s,
+                    "[\""s + run + "\\\"tail\"]"s,
+                    "[\""s + run + "\\\\\"]"s,
+                    "{\""s + run + "\\n\": \""s + run + "\\t\"}"s,
+                    "[\""s + run + "\n\"]"s,
+                    "[\""s + run + "\r\"]"s,
+                    // the first non-space after the run of spaces
+                    "["s + spaces + "1,"s + spaces + "\"a\""s + spaces + "]"s,
+                    "{"s + spaces + "\"k\""s + spaces + ":"s + spaces + "null}"s,
+                    spaces + "true"s }) {
+                    const auto parsed = ParseWithEvents(text);
+                    mismatch_count += parsed == LoadWithStream(text) ? 0 : 1;
+                    parsed_count += parsed ? 1 : 0;
+                }
+            }
+            CHECK(mismatch_count == 0);
+            // only the raw line breaks are rejected
+            CHECK(parsed_count == 67 * 7);
+        });
+    }
+
+    // The special character or the end of the document at the very last byte of the buffer,
+    // with nothing after it that a block load could fall back on
+    void TestEndOfBuffer() {
+        ForEachScanner([&](json::Scanner) {
+            size_t mismatch_count = 0;
+            for (size_t offset = 0; offset <= 66; ++offset) {
+                const std::string run(offset, 'x');
+                const std::string spaces(offset, ' ');
+                for (const std::string& text : {
+                    "\""s + run + "\""s,
+                    "\""s + run + "\\\"\""s,
+                    "\""s + run + "\\\\\""s,
+                    // unterminated: both parsers have to reject them
+                    "\""s + run,
+                    "\""s + run + "\\"s,
+                    "["s + spaces,
+                    "[\"a\","s + spaces,
+                    "1"s + spaces,
+                    spaces + "1"s }) {
+                    mismatch_count += ParsesAsLoad(text) ? 0 : 1;
+                }
+            }
+            CHECK(mismatch_count == 0);
+            CHECK(!ParseWithEvents("\"abc"s) && !ParseWithEvents("\"abc\\"s));
+            CHECK(ParseWithEvents(std::string(40, 'x').insert(0, 1, '"') + '"') == json::Node{ std::string(40, 'x') });
+        });
+    }
+
+    // Tokens cut by the end of the buffer at every place: the refilled parser has to give the same events
+    void TestStreamBuffer() {
+        std::mt19937 generator(17);
+        std::vector<std::string> documents;
+        for (int i = 0; i < 100; ++i) {
+            std::string text = MakeSpaces(generator, 40);
+            AppendRandomValue(generator, 4, text);
+            documents.push_back(std::move(text));
+        }
+        for (size_t offset = 0; offset <= 40; offset += 3) {
+            const std::string run(offset, 'x');
+            documents.push_back("[\""s + run + "\\\"tail\", -12.5e-3, 1234567, true, false, null]"s);
+            documents.push_back("{\""s + run + "\": \"a\\nb\"}   "s);
+            documents.push_back("[\""s + run);
+            documents.push_back("[1"s + std::string(offset, ' '));
+            documents.push_back("[tru"s);
+        }
+        ForEachScanner([&](json::Scanner) {
+            size_t mismatch_count = 0;
+            for (const size_t buffer_size : { 1, 2, 3, 5, 16, 33, 4096 }) {
+                for (const std::string& text : documents) {
+                    mismatch_count += ParseStreamWithEvents(text, buffer_size) == ParseWithEvents(text) ? 0 : 1;
+                }
+            }
+            CHECK(mismatch_count == 0);
+        });
+        // a string much longer than the buffer
+        const std::string long_string(100000, 'y');
+        CHECK(ParseStreamWithEvents("[\""s + long_string + "\"]"s, 64) == json::Node{ json::Array{ json::Node{ long_string } } });
+    }
+
+    void TestUnsupportedScanner() {
+        for (const json::Scanner scanner : ALL_SCANNERS) {
+            if (json::IsScannerSupported(scanner)) {
+                continue;
+            }
+            bool is_thrown = false;
+            try {
+                json::SetScanner(scanner);
+            }
+            catch (const std::invalid_argument&) {
+                is_thrown = true;
+            }
+            CHECK(is_thrown);
+        }
+        CHECK(json::IsScannerSupported(json::Scanner::SCALAR));
+    }
+
+}  // namespace
+
+int main() {
+    testing::RunTest("TestRandomDocuments"sv, TestRandomDocuments);
+    testing::RunTest("TestBlockEdges"sv, TestBlockEdges);
+    testing::RunTest("TestEndOfBuffer"sv, TestEndOfBuffer);
+    testing::RunTest("TestStreamBuffer"sv, TestStreamBuffer);
+    testing::RunTest("TestUnsupportedScanner"sv, TestUnsupportedScanner);
+    return testing::GetExitCode();
+}
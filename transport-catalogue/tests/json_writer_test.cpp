@@ -0,0 +1,294 @@
+#include "../json_writer.h"
+#include "testing.h"
+
+#include <cmath>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <string>
+
+using namespace std::literals;
+
+namespace {
+
+    // The printer json::Print had before it was built on Writer, kept as the reference of the format
+    namespace reference {
+
+        void PrintIndent(int indent, std::ostream& out) {
+            for (int i = 0; i < indent; ++i) {
+                out.put(' ');
+            }
+        }
+
+        void PrintString(const std::string& value, std::ostream& out) {
+            out.put('"');
+            for (const char c : value) {
+                switch (c) {
+                case '\r':
+                    out << "\\r"sv;
+                    break;
+                case '\n':
+                    out << "\\n"sv;
+                    break;
+                case '\t':
+                    out << "\\t"sv;
+                    break;
+                case '"':
+                    [[fallthrough]];
+                case '\\':
+                    out.put('\\');
+                    [[fallthrough]];
+                default:
+                    out.put(c);
+                    break;
+                }
+            }
+            out.put('"');
+        }
+
+        void PrintNode(const json::Node& node, int indent, std::ostream& out) {
+            if (node.IsInt()) {
+                out << node.AsInt();
+            }
+            else if (node.IsPureDouble()) {
+                out << node.AsDouble();
+            }
+            else if (node.IsString()) {
+                PrintString(node.AsString(), out);
+            }
+            else if (node.IsNull()) {
+                out << "null"sv;
+            }
+            else if (node.IsBool()) {
+                out << std::boolalpha << node.AsBool();
+            }
+            else if (node.IsArray()) {
+                out << "[\n"sv;
+                bool first = true;
+                for (const json::Node& item : node.AsArray()) {
+                    if (!first) {
+                        out << ",\n"sv;
+                    }
+                    first = false;
+                    PrintIndent(indent + json::Writer::INDENT_STEP, out);
+                    PrintNode(item, indent + json::Writer::INDENT_STEP, out);
+                }
+                out.put('\n');
+                PrintIndent(indent, out);
+                out.put(']');
+            }
+            else {
+                out << "{\n"sv;
+                bool first = true;
+                for (const auto& [key, item] : node.AsMap()) {
+                    if (!first) {
+                        out << ",\n"sv;
+                    }
+                    first = false;
+                    PrintIndent(indent + json::Writer::INDENT_STEP, out);
+                    PrintString(key, out);
+                    out << ": "sv;
+                    PrintNode(item, indent + json::Writer::INDENT_STEP, out);
+                }
+                out.put('\n');
+                PrintIndent(indent, out);
+                out.put('}');
+            }
+        }
+
+        std::string Print(const json::Node& node) {
+            std::ostringstream out;
+            PrintNode(node, 0, out);
+            return out.str();
+        }
+
+    }  // namespace reference
+
+    // the node as calls of Writer's streaming methods rather than WriteNode
+    void WriteEvents(const json::Node& node, json::Writer& writer) {
+        if (node.IsInt()) {
+            writer.Value(node.AsInt());
+        }
+        else if (node.IsPureDouble()) {
+            writer.Value(node.AsDouble());
+        }
+        else if (node.IsString()) {
+            writer.Value(node.AsString());
+        }
+        else if (node.IsNull()) {
+            writer.Null();
+        }
+        else if (node.IsBool()) {
+            writer.Value(node.AsBool());
+        }
+        else if (node.IsArray()) {
+            writer.StartArray();
+            for (const json::Node& item : node.AsArray()) {
+                WriteEvents(item, writer);
+            }
+            writer.EndArray();
+        }
+        else {
+            writer.StartDict();
+            for (const auto& [key, item] : node.AsMap()) {
+                writer.Key(key);
+                WriteEvents(item, writer);
+            }
+            writer.EndDict();
+        }
+    }
+
+    // Every way to print the node has to give the reference text: json::Print, WriteNode and the streaming
+    // methods, into a stream and into a string, and for an array every item written by its own Writer
+    // with the indent of an item and passed to RawValue
+    bool PrintsAsReference(const json::Node& node) {
+        const std::string expected = reference::Print(node);
+        bool is_same = true;
+
+        std::ostringstream printed;
+        json::Print(json::Document{ node }, printed);
+        is_same = is_same && printed.str() == expected;
+
+        std::ostringstream node_stream;
+        json::Writer(node_stream).WriteNode(node).Flush();
+        is_same = is_same && node_stream.str() == expected;
+
+        std::string events_string;
+        json::Writer events_writer(events_string);
+        WriteEvents(node, events_writer);
+        events_writer.Flush();
+        is_same = is_same && events_string == expected;
+
+        std::ostringstream events_stream;
+        json::Writer stream_writer(events_stream);
+        WriteEvents(node, stream_writer);
+        stream_writer.Flush();
+        is_same = is_same && events_stream.str() == expected;
+
+        if (node.IsArray()) {
+            std::string raw_string;
+            json::Writer raw_writer(raw_string);
+            raw_writer.StartArray();
+            for (const json::Node& item : node.AsArray()) {
+                std::string item_text;
+                json::Writer(item_text, json::Writer::INDENT_STEP).WriteNode(item).Flush();
+                raw_writer.RawValue(item_text);
+            }
+            raw_writer.EndArray().Flush();
+            is_same = is_same && raw_string == expected;
+        }
+        return is_same;
+    }
+
+    void TestScalars() {
+        for (const json::Node& node : {
+            json::Node{ nullptr }, json::Node{ true }, json::Node{ false }, json::Node{ 0 }, json::Node{ -17 },
+            json::Node{ std::numeric_limits<int>::max() }, json::Node{ std::numeric_limits<int>::min() } }) {
+            CHECK(PrintsAsReference(node));
+        }
+    }
+
+    void TestDoubles() {
+        for (const double value : { 1e21, 0.1, -0.0, 0.0, 1.0, -2.5, 1e-7, 123456.789, 1234567.0, 1e300, -1e-300, 3.0e15,
+            std::numeric_limits<double>::min(), std::numeric_limits<double>::max(), std::numeric_limits<double>::denorm_min() }) {
+            CHECK(PrintsAsReference(json::Node{ value }));
+            CHECK(PrintsAsReference(json::Array{ json::Node{ value }, json::Dict{ { "value"s, json::Node{ value } } } }));
+        }
+        CHECK(reference::Print(json::Node{ 1e21 }) == "1e+21"s);
+        CHECK(reference::Print(json::Node{ -0.0 }) == "-0"s);
+    }
+
+    void TestStrings() {
+        std::string all_bytes;
+        for (int c = 1; c < 256; ++c) {
+            all_bytes.push_back(static_cast<char>(c));
+        }
+        for (const std::string& value : { ""s, "plain"s, "\"quoted\""s, "back\\slash"s, "\\\\\"\\"s, "line\nfeed"s,
+            "carriage\rreturn"s, "\ttab"s, "\b\f\v\x01\x1f\x7f"s, "\r\n\t\"\\"s, "zero\0byte"s, "Привет"s, all_bytes }) {
+            CHECK(PrintsAsReference(json::Node{ value }));
+            // as a key too
+            CHECK(PrintsAsReference(json::Dict{ { value, json::Node{ value } } }));
+        }
+    }
+
+    void TestContainers() {
+        const json::Node empty_array{ json::Array{} };
+        const json::Node empty_dict{ json::Dict{} };
+        CHECK(PrintsAsReference(empty_array));
+        CHECK(PrintsAsReference(empty_dict));
+        CHECK(PrintsAsReference(json::Array{ empty_array, empty_dict, json::Array{ empty_array } }));
+        CHECK(PrintsAsReference(json::Dict{ { "a"s, empty_array }, { "b"s, empty_dict }, { "c"s, json::Dict{ { "d"s, empty_dict } } } }));
+
+        // arrays and dicts in turn, nested eight levels deep
+        json::Node nested{ 1 };
+        for (int level = 0; level < 8; ++level) {
+            if (level % 2 == 0) {
+                nested = json::Array{ nested, json::Node{ level }, json::Array{}, json::Node{ "item"s } };
+            }
+            else {
+                nested = json::Dict{ { "inner"s, nested }, { "level"s, json::Node{ level } }, { "empty"s, json::Dict{} } };
+            }
+        }
+        CHECK(PrintsAsReference(nested));
+    }
+
+    json::Node MakeRandomNode(std::mt19937& generator, int depth) {
+        const uint32_t kind = depth == 0 ? generator() % 6 : generator() % 8;
+        switch (kind) {
+        case 0:
+            return json::Node{ nullptr };
+        case 1:
+            return json::Node{ generator() % 2 == 0 };
+        case 2:
+            return json::Node{ static_cast<int>(generator()) };
+        case 3: {
+            const double mantissa = std::uniform_real_distribution<double>(-10.0, 10.0)(generator);
+            const int exponent = static_cast<int>(generator() % 50) - 25;
+            return json::Node{ mantissa * std::pow(10.0, exponent) };
+        }
+        case 4:
+        case 5: {
+            std::string value(generator() % 12, ' ');
+            for (char& c : value) {
+                c = "ab \"\\\n\r\t\x01/"[generator() % 10];
+            }
+            return json::Node{ value };
+        }
+        case 6: {
+            json::Array array(generator() % 5);
+            for (json::Node& item : array) {
+                item = MakeRandomNode(generator, depth - 1);
+            }
+            return json::Node{ std::move(array) };
+        }
+        default: {
+            json::Dict dict;
+            for (uint32_t size = generator() % 5; dict.size() < size;) {
+                std::string key = "key"s + std::to_string(generator() % 100);
+                dict[std::move(key)] = MakeRandomNode(generator, depth - 1);
+            }
+            return json::Node{ std::move(dict) };
+        }
+        }
+    }
+
+    void TestRandomDocuments() {
+        std::mt19937 generator(21);
+        size_t mismatch_count = 0;
+        for (int i = 0; i < 500; ++i) {
+            const json::Node node = MakeRandomNode(generator, 5);
+            mismatch_count += PrintsAsReference(node) ? 0 : 1;
+        }
+        CHECK(mismatch_count == 0);
+    }
+
+}  // namespace
+
+int main() {
+    testing::RunTest("TestScalars"sv, TestScalars);
+    testing::RunTest("TestDoubles"sv, TestDoubles);
+    testing::RunTest("TestStrings"sv, TestStrings);
+    testing::RunTest("TestContainers"sv, TestContainers);
+    testing::RunTest("TestRandomDocuments"sv, TestRandomDocuments);
+    return testing::GetExitCode();
+}
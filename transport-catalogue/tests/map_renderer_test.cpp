@@ -0,0 +1,382 @@
+#include "../grid_index.h"
+#include "../map_renderer.h"
+#include "testing.h"
+
+#include <cmath>
+#include <map>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std::literals;
+
+namespace {
+
+    size_t CountOccurrences(const std::string& text, std::string_view pattern) {
+        size_t count = 0;
+        for (size_t position = text.find(pattern); position != std::string::npos; position = text.find(pattern, position + 1)) {
+            ++count;
+        }
+        return count;
+    }
+
+    void SetUpRenderer(renderer::MapRenderer& renderer) {
+        renderer.width_ = 1000;
+        renderer.height_ = 800;
+        renderer.padding_ = 30;
+        renderer.line_width_ = 4;
+        renderer.stop_radius_ = 3;
+        renderer.bus_label_font_size_ = 12;
+        renderer.bus_label_offset_ = { 5, 10 };
+        renderer.stop_label_font_size_ = 10;
+        renderer.stop_label_offset_ = { 4, -4 };
+        renderer.underlayer_color_ = svg::Rgba{ 255, 255, 255, 0.85 };
+        renderer.underlayer_width_ = 3;
+        renderer.color_palette_ = { "green"s, svg::Rgb{ 255, 160, 0 }, "red"s };
+    }
+
+    // Stops at random coordinates and buses of 0 to max_route_size random stops
+    void FillCatalogue(transport_catalogue::TransportCatalogue& catalogue, std::mt19937& generator,
+        size_t stop_count, size_t bus_count, size_t max_route_size) {
+        std::uniform_real_distribution<double> offset(0.0, 0.1);
+        std::vector<std::string> stop_names;
+        for (size_t i = 0; i < stop_count; ++i) {
+            stop_names.push_back("Stop "s + std::to_string(i));
+            const double lat = 55.6 + offset(generator);
+            catalogue.AddStop(stop_names.back(), { lat, 37.5 + offset(generator) });
+        }
+        for (size_t bus = 0; bus < bus_count; ++bus) {
+            std::vector<std::string_view> stops(generator() % (max_route_size + 1));
+            for (auto& stop : stops) {
+                stop = stop_names[generator() % stop_count];
+            }
+            catalogue.AddBus("Bus "s + std::to_string(bus), stops, generator() % 2 == 0);
+        }
+    }
+
+    // A polyline of the SVG: its points as printed and its colour
+    struct Polyline {
+        std::vector<std::string> points;
+        std::string stroke;
+    };
+
+    std::string_view GetAttribute(std::string_view element, std::string_view name) {
+        const std::string prefix = " "s + std::string(name) + "=\""s;
+        const size_t begin = element.find(prefix) + prefix.size();
+        return element.substr(begin, element.find('"', begin) - begin);
+    }
+
+    std::vector<std::string_view> FindElements(std::string_view text, std::string_view tag) {
+        std::vector<std::string_view> elements;
+        for (size_t begin = text.find(tag); begin != std::string_view::npos; begin = text.find(tag, begin + 1)) {
+            elements.push_back(text.substr(begin, text.find('>', begin) - begin));
+        }
+        return elements;
+    }
+
+    std::vector<Polyline> ParsePolylines(std::string_view text) {
+        std::vector<Polyline> polylines;
+        for (const std::string_view element : FindElements(text, "<polyline "sv)) {
+            Polyline polyline;
+            const std::string_view points = GetAttribute(element, "points"sv);
+            for (size_t begin = 0; begin < points.size();) {
+                const size_t end = std::min(points.find(' ', begin), points.size());
+                polyline.points.emplace_back(points.substr(begin, end - begin));
+                begin = end + 1;
+            }
+            polyline.stroke = std::string(GetAttribute(element, "stroke"sv));
+            polylines.push_back(std::move(polyline));
+        }
+        return polylines;
+    }
+
+    svg::Point ParsePoint(const std::string& point) {
+        const size_t comma = point.find(',');
+        return { std::stod(point.substr(0, comma)), std::stod(point.substr(comma + 1)) };
+    }
+
+    std::vector<svg::Point> ParseCircles(std::string_view text) {
+        std::vector<svg::Point> circles;
+        for (const std::string_view element : FindElements(text, "<circle "sv)) {
+            circles.push_back({ std::stod(std::string(GetAttribute(element, "cx"sv))), std::stod(std::string(GetAttribute(element, "cy"sv))) });
+        }
+        return circles;
+    }
+
+    double GetDistanceToSegment(svg::Point point, svg::Point from, svg::Point to) {
+        const double dx = to.x - from.x;
+        const double dy = to.y - from.y;
+        const double length_squared = dx * dx + dy * dy;
+        const double t = length_squared > 0
+            ? std::clamp(((point.x - from.x) * dx + (point.y - from.y) * dy) / length_squared, 0.0, 1.0)
+            : 0.0;
+        return std::hypot(point.x - (from.x + t * dx), point.y - (from.y + t * dy));
+    }
+
+    // the colour of the last polyline drawn over every segment, whatever its direction
+    std::map<std::pair<std::string, std::string>, std::string> GetSegmentColors(const std::vector<Polyline>& polylines) {
+        std::map<std::pair<std::string, std::string>, std::string> colors;
+        for (const Polyline& polyline : polylines) {
+            for (size_t i = 1; i < polyline.points.size(); ++i) {
+                colors[std::minmax(polyline.points[i - 1], polyline.points[i])] = polyline.stroke;
+            }
+        }
+        return colors;
+    }
+
+    // 0 if the points are collinear, otherwise the sign of the turn a -> b -> c
+    int GetOrientation(svg::Point a, svg::Point b, svg::Point c) {
+        const double value = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+        return (value > 0) - (value < 0);
+    }
+
+    bool IsInBox(svg::Point a, svg::Point b, svg::Point point) {
+        return std::min(a.x, b.x) <= point.x && point.x <= std::max(a.x, b.x)
+            && std::min(a.y, b.y) <= point.y && point.y <= std::max(a.y, b.y);
+    }
+
+    bool SegmentsIntersect(svg::Point a, svg::Point b, svg::Point c, svg::Point d) {
+        const int abc = GetOrientation(a, b, c);
+        const int abd = GetOrientation(a, b, d);
+        const int cda = GetOrientation(c, d, a);
+        const int cdb = GetOrientation(c, d, b);
+        if (abc * abd < 0 && cda * cdb < 0) {
+            return true;
+        }
+        return (abc == 0 && IsInBox(a, b, c)) || (abd == 0 && IsInBox(a, b, d))
+            || (cda == 0 && IsInBox(c, d, a)) || (cdb == 0 && IsInBox(c, d, b));
+    }
+
+    // the segment touches the area if an end lies inside or it crosses a side of the area
+    bool SegmentTouchesArea(svg::Point from, svg::Point to, const renderer::Viewport& area) {
+        if (area.Contains(from) || area.Contains(to)) {
+            return true;
+        }
+        const svg::Point corners[] = {
+            { area.min_x, area.min_y }, { area.max_x, area.min_y }, { area.max_x, area.max_y }, { area.min_x, area.max_y }
+        };
+        for (size_t i = 0; i < 4; ++i) {
+            if (SegmentsIntersect(from, to, corners[i], corners[(i + 1) % 4])) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void TestGridIndexMatchesBruteForce() {
+        // integer coordinates keep the brute-force orientation tests exact, including touching segments
+        std::mt19937 generator(11);
+        for (int round = 0; round < 20; ++round) {
+            const size_t point_count = 1 + generator() % 300;
+            std::vector<svg::Point> points;
+            for (size_t i = 0; i < point_count; ++i) {
+                points.push_back({ static_cast<double>(generator() % 1000), static_cast<double>(generator() % 700) });
+            }
+            std::vector<size_t> route_offsets = { 0 };
+            std::vector<uint32_t> route_points;
+            for (size_t route = 0, route_count = generator() % 60; route < route_count; ++route) {
+                for (size_t i = 0, size = generator() % 7; i < size; ++i) {
+                    route_points.push_back(static_cast<uint32_t>(generator() % point_count));
+                }
+                route_offsets.push_back(route_points.size());
+            }
+            const renderer::GridIndex index(points, route_offsets, route_points);
+
+            std::vector<renderer::Viewport> areas = {
+                { -1e30, -1e30, 1e30, 1e30 }, { -5000, -5000, -10, -10 }, { 1e30, 1e30, 2e30, 2e30 },
+            };
+            for (int i = 0; i < 200; ++i) {
+                const double min_x = static_cast<double>(generator() % 1100) - 50;
+                const double min_y = static_cast<double>(generator() % 800) - 50;
+                areas.push_back({ min_x, min_y, min_x + generator() % 300, min_y + generator() % 300 });
+            }
+
+            for (const auto& area : areas) {
+                std::vector<uint32_t> expected_points;
+                for (uint32_t point = 0; point < points.size(); ++point) {
+                    if (area.Contains(points[point])) {
+                        expected_points.push_back(point);
+                    }
+                }
+                CHECK(index.FindPoints(area) == expected_points);
+
+                std::vector<uint32_t> expected_routes;
+                for (uint32_t route = 0; route + 1 < route_offsets.size(); ++route) {
+                    const size_t first = route_offsets[route];
+                    const size_t last = route_offsets[route + 1];
+                    bool touches = last - first == 1 && area.Contains(points[route_points[first]]);
+                    for (size_t i = first + 1; i < last && !touches; ++i) {
+                        touches = SegmentTouchesArea(points[route_points[i - 1]], points[route_points[i]], area);
+                    }
+                    if (touches) {
+                        expected_routes.push_back(route);
+                    }
+                }
+                CHECK(index.FindRoutes(area) == expected_routes);
+            }
+        }
+    }
+
+    void TestWholeMapAreas() {
+        // the tile of zoom 0 and a viewport far beyond the map both show the whole map
+        std::mt19937 generator(12);
+        for (int round = 0; round < 20; ++round) {
+            transport_catalogue::TransportCatalogue catalogue;
+            const size_t stop_count = 20 + generator() % 200;
+            const size_t bus_count = 1 + generator() % 40;
+            FillCatalogue(catalogue, generator, stop_count, bus_count, 8);
+            renderer::MapRenderer renderer;
+            SetUpRenderer(renderer);
+            const std::string map = *renderer.RenderCatalogueMap(catalogue);
+            CHECK(renderer.RenderCatalogueMapArea(catalogue, renderer.GetTileViewport(0, 0, 0)) == map);
+            CHECK(renderer.RenderCatalogueMapArea(catalogue, { -1e30, -1e30, 1e30, 1e30 }) == map);
+        }
+    }
+
+    void TestTilesCoverMap() {
+        // every route and stop of the map lies on at least one tile of zoom 2
+        std::mt19937 generator(13);
+        transport_catalogue::TransportCatalogue catalogue;
+        FillCatalogue(catalogue, generator, 200, 40, 8);
+        renderer::MapRenderer renderer;
+        SetUpRenderer(renderer);
+        const std::string map = *renderer.RenderCatalogueMap(catalogue);
+        size_t tile_routes = 0;
+        size_t tile_stops = 0;
+        for (int x = 0; x < 4; ++x) {
+            for (int y = 0; y < 4; ++y) {
+                const std::string tile = renderer.RenderCatalogueMapArea(catalogue, renderer.GetTileViewport(2, x, y));
+                tile_routes += CountOccurrences(tile, "<polyline"sv);
+                tile_stops += CountOccurrences(tile, "<circle"sv);
+            }
+        }
+        CHECK(tile_routes >= CountOccurrences(map, "<polyline"sv));
+        CHECK(tile_stops >= CountOccurrences(map, "<circle"sv));
+    }
+
+    void TestSimplifiedRoutes() {
+        // Douglas–Peucker keeps the ends and a subsequence of the stops, and no stop
+        // lies farther than the tolerance from the simplified polyline
+        constexpr double TOLERANCE = 20;
+        // the points are printed with six significant digits
+        constexpr double PRINT_ERROR = 1e-2;
+        std::mt19937 generator(14);
+        size_t point_count = 0;
+        size_t simplified_point_count = 0;
+        for (int round = 0; round < 10; ++round) {
+            transport_catalogue::TransportCatalogue catalogue;
+            FillCatalogue(catalogue, generator, 300, 30, 40);
+            renderer::MapRenderer renderer;
+            SetUpRenderer(renderer);
+            const auto polylines = ParsePolylines(*renderer.RenderCatalogueMap(catalogue));
+            renderer::MapRenderer simplifying_renderer;
+            SetUpRenderer(simplifying_renderer);
+            simplifying_renderer.simplify_tolerance_ = TOLERANCE;
+            const auto simplified_polylines = ParsePolylines(*simplifying_renderer.RenderCatalogueMap(catalogue));
+
+            CHECK(simplified_polylines.size() == polylines.size());
+            for (size_t i = 0; i < std::min(polylines.size(), simplified_polylines.size()); ++i) {
+                const auto& points = polylines[i].points;
+                const auto& simplified_points = simplified_polylines[i].points;
+                point_count += points.size();
+                simplified_point_count += simplified_points.size();
+                CHECK(simplified_polylines[i].stroke == polylines[i].stroke);
+                CHECK(points.size() < 2 || simplified_points.size() >= 2);
+                if (points.empty() || simplified_points.empty()) {
+                    CHECK(points.empty() && simplified_points.empty());
+                    continue;
+                }
+                CHECK(simplified_points.front() == points.front() && simplified_points.back() == points.back());
+                // every simplified point is the next kept stop, and the stops skipped before it are close to the chord
+                size_t kept = 0;
+                for (size_t j = 0; j < points.size() && kept < simplified_points.size(); ++j) {
+                    if (points[j] == simplified_points[kept]) {
+                        ++kept;
+                        continue;
+                    }
+                    CHECK(kept > 0);
+                    if (kept > 0) {
+                        const double distance = GetDistanceToSegment(ParsePoint(points[j]),
+                            ParsePoint(simplified_points[kept - 1]), ParsePoint(simplified_points[kept]));
+                        CHECK(distance <= TOLERANCE + PRINT_ERROR);
+                    }
+                }
+                CHECK(kept == simplified_points.size());
+            }
+        }
+        CHECK(simplified_point_count < point_count);
+    }
+
+    void TestMergedSharedSegments() {
+        // the same segments are drawn with the same colour on top, only fewer times
+        std::mt19937 generator(15);
+        for (int round = 0; round < 10; ++round) {
+            transport_catalogue::TransportCatalogue catalogue;
+            // few stops and many buses, so that the routes share a lot of segments
+            FillCatalogue(catalogue, generator, 15, 40, 20);
+            renderer::MapRenderer renderer;
+            SetUpRenderer(renderer);
+            const auto polylines = ParsePolylines(*renderer.RenderCatalogueMap(catalogue));
+            renderer::MapRenderer merging_renderer;
+            SetUpRenderer(merging_renderer);
+            merging_renderer.merge_shared_segments_ = true;
+            const auto merged_polylines = ParsePolylines(*merging_renderer.RenderCatalogueMap(catalogue));
+
+            CHECK(GetSegmentColors(merged_polylines) == GetSegmentColors(polylines));
+            size_t point_count = 0;
+            for (const auto& polyline : polylines) {
+                point_count += polyline.points.size();
+            }
+            size_t merged_point_count = 0;
+            for (const auto& polyline : merged_polylines) {
+                merged_point_count += polyline.points.size();
+            }
+            CHECK(merged_point_count < point_count);
+        }
+    }
+
+    void TestThinnedOutStops() {
+        // the stops left are at least min_stop_distance_ apart, and every dropped one is close to a stop left
+        constexpr double MIN_DISTANCE = 25;
+        constexpr double PRINT_ERROR = 1e-2;
+        std::mt19937 generator(16);
+        for (int round = 0; round < 10; ++round) {
+            transport_catalogue::TransportCatalogue catalogue;
+            FillCatalogue(catalogue, generator, 400, 40, 20);
+            renderer::MapRenderer renderer;
+            SetUpRenderer(renderer);
+            const auto circles = ParseCircles(*renderer.RenderCatalogueMap(catalogue));
+            renderer::MapRenderer thinning_renderer;
+            SetUpRenderer(thinning_renderer);
+            thinning_renderer.min_stop_distance_ = MIN_DISTANCE;
+            const auto thinned_circles = ParseCircles(*thinning_renderer.RenderCatalogueMap(catalogue));
+
+            CHECK(!thinned_circles.empty() && thinned_circles.size() < circles.size());
+            for (size_t i = 0; i < thinned_circles.size(); ++i) {
+                for (size_t j = i + 1; j < thinned_circles.size(); ++j) {
+                    const double distance = std::hypot(thinned_circles[i].x - thinned_circles[j].x, thinned_circles[i].y - thinned_circles[j].y);
+                    CHECK(distance >= MIN_DISTANCE - PRINT_ERROR);
+                }
+            }
+            for (const svg::Point circle : circles) {
+                bool is_covered = false;
+                for (const svg::Point thinned_circle : thinned_circles) {
+                    is_covered = is_covered || std::hypot(circle.x - thinned_circle.x, circle.y - thinned_circle.y) < MIN_DISTANCE + PRINT_ERROR;
+                }
+                CHECK(is_covered);
+            }
+        }
+    }
+
+}  // namespace
+
+int main() {
+    testing::RunTest("TestGridIndexMatchesBruteForce"sv, TestGridIndexMatchesBruteForce);
+    testing::RunTest("TestWholeMapAreas"sv, TestWholeMapAreas);
+    testing::RunTest("TestTilesCoverMap"sv, TestTilesCoverMap);
+    testing::RunTest("TestSimplifiedRoutes"sv, TestSimplifiedRoutes);
+    testing::RunTest("TestMergedSharedSegments"sv, TestMergedSharedSegments);
+    testing::RunTest("TestThinnedOutStops"sv, TestThinnedOutStops);
+    return testing::GetExitCode();
+}
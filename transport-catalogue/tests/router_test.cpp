@@ -0,0 +1,199 @@
+#include "../transport_router.h"
+#include "testing.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std::literals;
+using namespace transport_router;
+
+namespace {
+
+    // Stops scattered over a few kilometres and buses over random stops. Every road is
+    // road_factor_min..road_factor_max times its great-circle distance, both ways
+    void FillCatalogue(TransportCatalogue& catalogue, uint32_t seed, size_t stop_count, size_t bus_count,
+        double road_factor_min, double road_factor_max) {
+        std::mt19937 generator(seed);
+        std::uniform_real_distribution<double> offset(0.0, 0.05);
+        std::uniform_real_distribution<double> road_factor(road_factor_min, road_factor_max);
+        std::uniform_int_distribution<size_t> stop_index(0, stop_count - 1);
+        std::uniform_int_distribution<size_t> route_size(3, 12);
+
+        std::vector<std::string> stop_names;
+        for (size_t i = 0; i < stop_count; ++i) {
+            stop_names.push_back("Stop "s + std::to_string(i));
+            const double lat = 55.6 + offset(generator);
+            catalogue.AddStop(stop_names.back(), { lat, 37.5 + offset(generator) });
+        }
+        for (size_t bus = 0; bus < bus_count; ++bus) {
+            const bool is_roundtrip = bus % 2 == 0;
+            std::vector<std::string_view> stops;
+            for (size_t size = route_size(generator); stops.size() < size;) {
+                const size_t stop = stop_index(generator);
+                if (!stops.empty() && stops.back() == stop_names[stop]) {
+                    continue;
+                }
+                stops.push_back(stop_names[stop]);
+            }
+            if (is_roundtrip) {
+                stops.push_back(stops.front());
+            }
+            for (size_t i = 0; i + 1 < stops.size(); ++i) {
+                const geo::Coordinates from = catalogue.FindStop(stops[i])->coordinates;
+                const geo::Coordinates to = catalogue.FindStop(stops[i + 1])->coordinates;
+                const int distance = static_cast<int>(std::ceil(geo::ComputeDistance(from, to) * road_factor(generator)));
+                catalogue.SetStopDistances(stops[i], stops[i + 1], distance);
+                catalogue.SetStopDistances(stops[i + 1], stops[i], distance);
+            }
+            catalogue.AddBus("Bus "s + std::to_string(bus), stops, is_roundtrip);
+        }
+    }
+
+    // Chains of vertices with random transfers between them; a fifth of the weights are zero
+    graph::DirectedWeightedGraph<double> MakeRandomGraph(uint32_t seed, size_t vertex_count) {
+        std::mt19937 generator(seed);
+        std::uniform_int_distribution<size_t> vertex(0, vertex_count - 1);
+        std::uniform_int_distribution<int> weight(0, 4);
+        std::vector<graph::Edge<double>> edges;
+        for (size_t from = 0; from + 1 < vertex_count; ++from) {
+            edges.emplace_back(static_cast<VertexId>(from), static_cast<VertexId>(from + 1), weight(generator), EdgeType::BUS, 0, 1);
+        }
+        for (size_t i = 0; i < vertex_count * 2; ++i) {
+            // drawn one by one, the order of evaluating arguments is unspecified
+            const auto from = static_cast<VertexId>(vertex(generator));
+            const auto to = static_cast<VertexId>(vertex(generator));
+            edges.emplace_back(from, to, weight(generator) * 2.5, EdgeType::WAIT, 0, 0);
+        }
+        return graph::DirectedWeightedGraph<double>(vertex_count, edges);
+    }
+
+    // routes between all pairs of vertices found by router weigh the same as the ones Dijkstra finds,
+    // and their edges make a chain of that weight
+    void CheckSameGraphRoutes(const graph::DirectedWeightedGraph<double>& graph, const graph::Router<double>& router) {
+        const graph::Router<double> dijkstra(graph);
+        for (VertexId from = 0; from < graph.GetVertexCount(); ++from) {
+            for (VertexId to = 0; to < graph.GetVertexCount(); ++to) {
+                const auto expected = dijkstra.BuildRoute(from, to);
+                const auto route = router.BuildRoute(from, to);
+                CHECK(expected.has_value() == route.has_value());
+                if (!expected || !route) {
+                    continue;
+                }
+                CHECK(std::abs(expected->weight - route->weight) <= 1e-9 * expected->weight);
+                VertexId vertex = from;
+                double weight = 0.0;
+                for (const EdgeId edge_id : route->edges) {
+                    const auto& edge = graph.GetEdge(edge_id);
+                    CHECK(edge.from == vertex);
+                    vertex = edge.to;
+                    weight += edge.weight;
+                }
+                CHECK(vertex == to);
+                CHECK(std::abs(weight - route->weight) <= 1e-9 * route->weight);
+            }
+        }
+    }
+
+    // routes between all pairs of stops found by algorithm weigh the same as the ones Dijkstra finds
+    void CheckSameRoutes(const TransportCatalogue& catalogue, graph::RouterAlgorithm algorithm) {
+        TranspRouteParams params;
+        params.bus_wait_time = 2;
+        params.bus_velocity = 30;
+        const TransportRouter dijkstra(catalogue, params);
+        params.algorithm = algorithm;
+        const TransportRouter checked(catalogue, params);
+
+        size_t route_count = 0;
+        for (const Stop& from : catalogue.GetStops()) {
+            for (const Stop& to : catalogue.GetStops()) {
+                const auto expected = dijkstra.MakeRoute(from.name, to.name);
+                const auto route = checked.MakeRoute(from.name, to.name);
+                CHECK(expected.has_value() == route.has_value());
+                if (expected && route) {
+                    CHECK(std::abs(expected->total_time - route->total_time) <= 1e-9 * expected->total_time);
+                    ++route_count;
+                }
+            }
+        }
+        CHECK(route_count > catalogue.GetStops().size());
+    }
+
+    void TestAStarWithShortRoads() {
+        // roads shorter than the great circle would make the plain great-circle estimate inadmissible
+        TransportCatalogue catalogue;
+        FillCatalogue(catalogue, 1, 150, 40, 0.3, 1.5);
+        CheckSameRoutes(catalogue, graph::RouterAlgorithm::A_STAR);
+    }
+
+    void TestAStarWithLongRoads() {
+        TransportCatalogue catalogue;
+        FillCatalogue(catalogue, 2, 150, 40, 1.0, 2.0);
+        CheckSameRoutes(catalogue, graph::RouterAlgorithm::A_STAR);
+    }
+
+    void TestRadixHeapDijkstra() {
+        TransportCatalogue catalogue;
+        FillCatalogue(catalogue, 3, 150, 40, 0.3, 2.0);
+        CheckSameRoutes(catalogue, graph::RouterAlgorithm::RADIX_HEAP_DIJKSTRA);
+    }
+
+    void TestContractionHierarchy() {
+        TransportCatalogue catalogue;
+        FillCatalogue(catalogue, 4, 300, 80, 0.5, 2.0);
+        CheckSameRoutes(catalogue, graph::RouterAlgorithm::CONTRACTION_HIERARCHY);
+
+        for (uint32_t seed = 1; seed <= 3; ++seed) {
+            const auto graph = MakeRandomGraph(seed, 200);
+            CheckSameGraphRoutes(graph, graph::Router<double>(graph, graph::RouterAlgorithm::CONTRACTION_HIERARCHY));
+        }
+
+        // the initial priorities computed on several threads give the same hierarchy
+        const auto graph = MakeRandomGraph(7, 300);
+        const graph::Router<double> router(graph, graph::RouterAlgorithm::CONTRACTION_HIERARCHY, nullptr, 1);
+        const graph::Router<double> parallel_router(graph, graph::RouterAlgorithm::CONTRACTION_HIERARCHY, nullptr, 3);
+        CheckSameGraphRoutes(graph, parallel_router);
+        const auto& index = router.GetContractionHierarchy()->GetSearchIndex();
+        const auto& parallel_index = parallel_router.GetContractionHierarchy()->GetSearchIndex();
+        CHECK(index.edges.size() == parallel_index.edges.size());
+        CHECK(std::equal(index.upward_edges.begin(), index.upward_edges.end(), parallel_index.upward_edges.begin(),
+            parallel_index.upward_edges.end()));
+    }
+
+    void TestAllPairsTable() {
+        TransportCatalogue catalogue;
+        FillCatalogue(catalogue, 5, 150, 40, 0.5, 2.0);
+        CheckSameRoutes(catalogue, graph::RouterAlgorithm::ALL_PAIRS);
+
+        // a size that is not a multiple of the block, built on several threads and restored from its matrices
+        const auto graph = MakeRandomGraph(6, 150);
+        for (const size_t thread_count : { 1, 3 }) {
+            const graph::Router<double> router(graph, graph::RouterAlgorithm::ALL_PAIRS, nullptr, thread_count);
+            CheckSameGraphRoutes(graph, router);
+            CheckSameGraphRoutes(graph, graph::Router<double>(graph, *router.GetAllPairsTable()));
+        }
+
+        // integer weights use max() for unreachable vertices and must not overflow
+        const std::vector<graph::Edge<int>> edges = {
+            { 0, 1, 5, EdgeType::BUS, 0, 1 }, { 1, 2, 7, EdgeType::BUS, 0, 1 }, { 0, 2, 13, EdgeType::BUS, 0, 1 },
+        };
+        const graph::DirectedWeightedGraph<int> int_graph(4, edges);
+        const graph::Router<int> int_router(int_graph, graph::RouterAlgorithm::ALL_PAIRS);
+        const auto route = int_router.BuildRoute(0, 2);
+        CHECK(route && route->weight == 12 && route->edges.size() == 2);
+        CHECK(!int_router.BuildRoute(2, 0));
+        CHECK(!int_router.BuildRoute(0, 3));
+    }
+
+}  // namespace
+
+int main() {
+    testing::RunTest("TestAStarWithShortRoads"sv, TestAStarWithShortRoads);
+    testing::RunTest("TestAStarWithLongRoads"sv, TestAStarWithLongRoads);
+    testing::RunTest("TestRadixHeapDijkstra"sv, TestRadixHeapDijkstra);
+    testing::RunTest("TestContractionHierarchy"sv, TestContractionHierarchy);
+    testing::RunTest("TestAllPairsTable"sv, TestAllPairsTable);
+    return testing::GetExitCode();
+}
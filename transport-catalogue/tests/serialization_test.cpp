@@ -0,0 +1,317 @@
+#include "../serialization.h"
+#include "testing.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std::literals;
+using namespace transport_router;
+
+namespace {
+
+    // The start of the snapshot layout as serialization.cpp writes it: the header and the section table
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t section_count;
+        uint64_t checksum;
+    };
+
+    struct SectionEntry {
+        uint32_t id;
+        uint32_t element_size;
+        uint64_t offset;
+        uint64_t size;
+        uint64_t checksum;
+    };
+
+    // Stops over a few kilometres, buses over random stops and distances for most of their segments
+    void FillCatalogue(TransportCatalogue& catalogue, uint32_t seed, size_t stop_count, size_t bus_count) {
+        std::mt19937 generator(seed);
+        std::uniform_real_distribution<double> offset(0.0, 0.05);
+        std::uniform_real_distribution<double> road_factor(1.0, 1.8);
+        std::uniform_int_distribution<size_t> stop_index(0, stop_count - 1);
+        std::uniform_int_distribution<size_t> route_size(2, 10);
+
+        std::vector<std::string> stop_names;
+        for (size_t i = 0; i < stop_count; ++i) {
+            stop_names.push_back("Stop "s + std::to_string(i));
+            const double lat = 55.6 + offset(generator);
+            catalogue.AddStop(stop_names.back(), { lat, 37.5 + offset(generator) });
+        }
+        for (size_t bus = 0; bus < bus_count; ++bus) {
+            const bool is_roundtrip = bus % 3 == 0;
+            std::vector<std::string_view> stops;
+            for (size_t size = route_size(generator); stops.size() < size;) {
+                stops.push_back(stop_names[stop_index(generator)]);
+            }
+            if (is_roundtrip) {
+                stops.push_back(stops.front());
+            }
+            for (size_t i = 0; i + 1 < stops.size(); ++i) {
+                const geo::Coordinates from = catalogue.FindStop(stops[i])->coordinates;
+                const geo::Coordinates to = catalogue.FindStop(stops[i + 1])->coordinates;
+                const int distance = static_cast<int>(std::ceil(geo::ComputeDistance(from, to) * road_factor(generator)));
+                catalogue.SetStopDistances(stops[i], stops[i + 1], distance);
+                if (generator() % 2 == 0) {
+                    catalogue.SetStopDistances(stops[i + 1], stops[i], distance + 100);
+                }
+            }
+            catalogue.AddBus("Bus "s + std::to_string(bus), stops, is_roundtrip);
+        }
+    }
+
+    void SetUpRenderer(renderer::MapRenderer& renderer) {
+        renderer.width_ = 600;
+        renderer.height_ = 400;
+        renderer.padding_ = 20;
+        renderer.line_width_ = 3;
+        renderer.stop_radius_ = 2;
+        renderer.bus_label_font_size_ = 12;
+        renderer.bus_label_offset_ = { 5, 10 };
+        renderer.stop_label_font_size_ = 10;
+        renderer.stop_label_offset_ = { 4, -4 };
+        renderer.underlayer_color_ = svg::Rgba{ 255, 255, 255, 0.85 };
+        renderer.underlayer_width_ = 3;
+        renderer.color_palette_ = { "green"s, svg::Rgb{ 255, 160, 0 }, "red"s };
+    }
+
+    std::filesystem::path GetSnapshotPath() {
+        return std::filesystem::temp_directory_path() / "serialization_test.db";
+    }
+
+    // A snapshot of a small city routed by algorithm
+    struct SavedCity {
+        TransportCatalogue catalogue;
+        renderer::MapRenderer renderer{};
+        TranspRouteParams params;
+        serialization::SerializationSettings settings{ GetSnapshotPath() };
+
+        explicit SavedCity(graph::RouterAlgorithm algorithm) {
+            FillCatalogue(catalogue, 5, 60, 25);
+            SetUpRenderer(renderer);
+            params.bus_wait_time = 3;
+            params.bus_velocity = 35;
+            params.algorithm = algorithm;
+            const TransportRouter router(catalogue, params);
+            serialization::SaveSnapshot(settings, catalogue, renderer, router);
+        }
+    };
+
+    std::vector<char> ReadBytes(const std::filesystem::path& file) {
+        std::ifstream in(file, std::ios::binary);
+        return { std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>() };
+    }
+
+    void WriteBytes(const std::filesystem::path& file, const std::vector<char>& bytes) {
+        std::ofstream out(file, std::ios::binary | std::ios::trunc);
+        out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+    }
+
+    std::vector<SectionEntry> ReadSectionTable(const std::vector<char>& bytes) {
+        Header header;
+        std::memcpy(&header, bytes.data(), sizeof(header));
+        std::vector<SectionEntry> sections(header.section_count);
+        std::memcpy(sections.data(), bytes.data() + sizeof(header), sections.size() * sizeof(SectionEntry));
+        return sections;
+    }
+
+    // Reads every part of the snapshot, so that every section's checksum is verified.
+    // Returns the message of the exception, or an empty string if the snapshot was read
+    std::string LoadEverything(const serialization::SerializationSettings& settings) {
+        try {
+            const serialization::Snapshot snapshot(settings);
+            TransportCatalogue catalogue;
+            snapshot.LoadCatalogue(catalogue);
+            renderer::MapRenderer renderer{};
+            snapshot.LoadRenderSettings(renderer);
+            const TransportRouter router(catalogue, snapshot.GetRoutingSettings(), snapshot.GetRoutingGraph(),
+                snapshot.GetContractionHierarchy(), snapshot.GetAllPairsTable());
+            return {};
+        }
+        catch (const std::runtime_error& error) {
+            return error.what();
+        }
+    }
+
+    void CheckRoundTrip(graph::RouterAlgorithm algorithm) {
+        const SavedCity city(algorithm);
+        const TransportRouter direct_router(city.catalogue, city.params);
+
+        const serialization::Snapshot snapshot(city.settings);
+        TransportCatalogue catalogue;
+        snapshot.LoadCatalogue(catalogue);
+        renderer::MapRenderer renderer{};
+        snapshot.LoadRenderSettings(renderer);
+        const TranspRouteParams params = snapshot.GetRoutingSettings();
+        CHECK(params.algorithm == algorithm && params.bus_wait_time == city.params.bus_wait_time
+            && params.bus_velocity == city.params.bus_velocity);
+        const auto hierarchy = snapshot.GetContractionHierarchy();
+        const auto all_pairs_table = snapshot.GetAllPairsTable();
+        CHECK(hierarchy.has_value() == (algorithm == graph::RouterAlgorithm::CONTRACTION_HIERARCHY));
+        CHECK(all_pairs_table.has_value() == (algorithm == graph::RouterAlgorithm::ALL_PAIRS));
+        const TransportRouter router(catalogue, params, snapshot.GetRoutingGraph(), hierarchy, all_pairs_table);
+
+        // stops, distances between all of them and buses
+        CHECK(catalogue.GetStops().size() == city.catalogue.GetStops().size());
+        for (const Stop& expected : city.catalogue.GetStops()) {
+            const Stop* stop = catalogue.FindStop(expected.name);
+            CHECK(stop != nullptr && stop->id == expected.id && stop->coordinates == expected.coordinates);
+            for (const Stop& to : city.catalogue.GetStops()) {
+                CHECK(catalogue.GetStopsDistance(expected.id, to.id) == city.catalogue.GetStopsDistance(expected.id, to.id));
+            }
+            // the snapshot keeps buses in the order of their names, so their ids may change
+            const auto expected_buses = city.catalogue.GetStopInfo(expected.name);
+            const auto buses = catalogue.GetStopInfo(expected.name);
+            CHECK(std::equal(buses.begin(), buses.end(), expected_buses.begin(), expected_buses.end(), [&](BusId bus, BusId expected_bus) {
+                return catalogue.GetBus(bus).name == city.catalogue.GetBus(expected_bus).name;
+            }));
+        }
+        CHECK(catalogue.GetStopsDistances().Size() == city.catalogue.GetStopsDistances().Size());
+        const auto buses = catalogue.GetBuses();
+        const auto expected_buses = city.catalogue.GetBuses();
+        CHECK(buses.end() - buses.begin() == expected_buses.end() - expected_buses.begin());
+        for (const Bus* expected : city.catalogue.GetBuses()) {
+            const Bus* bus = catalogue.FindBus(expected->name);
+            CHECK(bus != nullptr && bus->is_roundtrip == expected->is_roundtrip);
+            const auto expected_route = city.catalogue.GetRoute(*expected);
+            const auto route = catalogue.GetRoute(*bus);
+            CHECK(std::equal(route.begin(), route.end(), expected_route.begin(), expected_route.end()));
+            const BusInfo expected_info = city.catalogue.GetBusInfo(expected->name);
+            const BusInfo info = catalogue.GetBusInfo(expected->name);
+            CHECK(info.all_stops_count == expected_info.all_stops_count && info.unique_stops_count == expected_info.unique_stops_count
+                && info.route_length == expected_info.route_length && info.curvature == expected_info.curvature);
+        }
+
+        // routes between all pairs of stops, item by item
+        for (const Stop& from : catalogue.GetStops()) {
+            for (const Stop& to : catalogue.GetStops()) {
+                const auto expected = direct_router.MakeRoute(from.name, to.name);
+                const auto route = router.MakeRoute(from.name, to.name);
+                CHECK(expected.has_value() == route.has_value());
+                if (!expected || !route) {
+                    continue;
+                }
+                CHECK(route->total_time == expected->total_time && route->items.size() == expected->items.size());
+                for (size_t i = 0; i < std::min(route->items.size(), expected->items.size()); ++i) {
+                    const auto& item = route->items[i];
+                    const auto& expected_item = expected->items[i];
+                    CHECK(item.type == expected_item.type && item.name == expected_item.name
+                        && item.span_count == expected_item.span_count && item.time == expected_item.time);
+                }
+            }
+        }
+
+        CHECK(*renderer.RenderCatalogueMap(catalogue) == *city.renderer.RenderCatalogueMap(city.catalogue));
+        std::filesystem::remove(city.settings.file);
+    }
+
+    void TestRoundTripDijkstra() {
+        CheckRoundTrip(graph::RouterAlgorithm::DIJKSTRA);
+    }
+
+    void TestRoundTripAStar() {
+        CheckRoundTrip(graph::RouterAlgorithm::A_STAR);
+    }
+
+    void TestRoundTripRadixHeapDijkstra() {
+        CheckRoundTrip(graph::RouterAlgorithm::RADIX_HEAP_DIJKSTRA);
+    }
+
+    void TestRoundTripContractionHierarchy() {
+        CheckRoundTrip(graph::RouterAlgorithm::CONTRACTION_HIERARCHY);
+    }
+
+    void TestRoundTripAllPairs() {
+        CheckRoundTrip(graph::RouterAlgorithm::ALL_PAIRS);
+    }
+
+    // one damaged byte in the middle of any section, or in the section table, is found
+    void TestCorruptedChecksum() {
+        const SavedCity city(graph::RouterAlgorithm::ALL_PAIRS);
+        const std::vector<char> bytes = ReadBytes(city.settings.file);
+        CHECK(LoadEverything(city.settings).empty());
+
+        const std::vector<SectionEntry> sections = ReadSectionTable(bytes);
+        size_t damaged_count = 0;
+        for (const SectionEntry& section : sections) {
+            if (section.size == 0) {
+                continue;
+            }
+            std::vector<char> damaged = bytes;
+            damaged[section.offset + section.size / 2] ^= 0x10;
+            WriteBytes(city.settings.file, damaged);
+            CHECK(LoadEverything(city.settings) == "snapshot is corrupted"s);
+            ++damaged_count;
+        }
+        CHECK(damaged_count > 10);
+
+        std::vector<char> damaged = bytes;
+        damaged[sizeof(Header) + sizeof(SectionEntry) + offsetof(SectionEntry, checksum)] ^= 0x01;
+        WriteBytes(city.settings.file, damaged);
+        CHECK(LoadEverything(city.settings) == "snapshot is corrupted"s);
+        std::filesystem::remove(city.settings.file);
+    }
+
+    void TestWrongMagicAndVersion() {
+        const SavedCity city(graph::RouterAlgorithm::DIJKSTRA);
+        const std::vector<char> bytes = ReadBytes(city.settings.file);
+
+        std::vector<char> damaged = bytes;
+        damaged[0] = 'X';
+        WriteBytes(city.settings.file, damaged);
+        CHECK(LoadEverything(city.settings) == "file is not a transport catalogue snapshot"s);
+
+        Header header;
+        std::memcpy(&header, bytes.data(), sizeof(header));
+        damaged = bytes;
+        for (const uint32_t version : { header.version - 1, header.version + 1, 0u }) {
+            std::memcpy(damaged.data() + offsetof(Header, version), &version, sizeof(version));
+            WriteBytes(city.settings.file, damaged);
+            CHECK(LoadEverything(city.settings) == "unsupported snapshot version "s + std::to_string(version));
+        }
+        std::filesystem::remove(city.settings.file);
+    }
+
+    // a file cut anywhere, from the header to the last section, is rejected
+    void TestTruncatedFile() {
+        const SavedCity city(graph::RouterAlgorithm::CONTRACTION_HIERARCHY);
+        const std::vector<char> bytes = ReadBytes(city.settings.file);
+        const std::vector<SectionEntry> sections = ReadSectionTable(bytes);
+        std::vector<size_t> sizes = { 0, 1, sizeof(Header) - 1, sizeof(Header), sizeof(Header) + sizeof(SectionEntry) * 2 + 5 };
+        for (const SectionEntry& section : sections) {
+            if (section.size > 0) {
+                sizes.push_back(section.offset + section.size - 1);
+                sizes.push_back(section.offset + section.size / 2);
+            }
+        }
+        for (const size_t size : sizes) {
+            WriteBytes(city.settings.file, { bytes.begin(), bytes.begin() + size });
+            CHECK(!LoadEverything(city.settings).empty());
+        }
+        std::filesystem::remove(city.settings.file);
+        CHECK(!LoadEverything(city.settings).empty());
+    }
+
+}  // namespace
+
+int main() {
+    testing::RunTest("TestRoundTripDijkstra"sv, TestRoundTripDijkstra);
+    testing::RunTest("TestRoundTripAStar"sv, TestRoundTripAStar);
+    testing::RunTest("TestRoundTripRadixHeapDijkstra"sv, TestRoundTripRadixHeapDijkstra);
+    testing::RunTest("TestRoundTripContractionHierarchy"sv, TestRoundTripContractionHierarchy);
+    testing::RunTest("TestRoundTripAllPairs"sv, TestRoundTripAllPairs);
+    testing::RunTest("TestCorruptedChecksum"sv, TestCorruptedChecksum);
+    testing::RunTest("TestWrongMagicAndVersion"sv, TestWrongMagicAndVersion);
+    testing::RunTest("TestTruncatedFile"sv, TestTruncatedFile);
+    return testing::GetExitCode();
+}
@@ -0,0 +1,85 @@
+#include "../svg.h"
+#include "testing.h"
+
+#include <random>
+#include <string>
+
+using namespace std::literals;
+
+namespace {
+
+    std::string EscapeText(const std::string& text) {
+        std::string result;
+        for (const char c : text) {
+            switch (c) {
+            case '"':
+                result += "&quot;"sv;
+                break;
+            case '\'':
+                result += "&apos;"sv;
+                break;
+            case '<':
+                result += "&lt;"sv;
+                break;
+            case '>':
+                result += "&gt;"sv;
+                break;
+            case '&':
+                result += "&amp;"sv;
+                break;
+            default:
+                result += c;
+                break;
+            }
+        }
+        return result;
+    }
+
+    // the escaped data between <text ...> and </text>
+    std::string RenderTextData(const std::string& data) {
+        svg::Text text;
+        text.SetData(data);
+        std::string out = "prefix"s;
+        svg::DocumentWriter writer(out);
+        writer.Add(text);
+        const size_t begin = out.find('>', out.find("<text"sv)) + 1;
+        return out.substr(begin, out.find("</text>"sv, begin) - begin);
+    }
+
+    void TestEscapesAtBlockEdges() {
+        // every special character after 0 to 40 plain ones, alone and followed by more text
+        size_t mismatch_count = 0;
+        for (const char special : "\"'<>&"sv) {
+            for (size_t offset = 0; offset <= 40; ++offset) {
+                for (const std::string& data : { std::string(offset, 'x') + special, std::string(offset, 'x') + special + "tail"s,
+                    std::string(offset, 'x') + special + special + std::string(offset, 'y') }) {
+                    mismatch_count += RenderTextData(data) == EscapeText(data) ? 0 : 1;
+                }
+            }
+        }
+        CHECK(mismatch_count == 0);
+        CHECK(RenderTextData(""s).empty());
+        CHECK(RenderTextData("Ulitsa Lizy Chaikinoi"s) == "Ulitsa Lizy Chaikinoi"s);
+    }
+
+    void TestRandomTexts() {
+        std::mt19937 generator(3);
+        size_t mismatch_count = 0;
+        for (int i = 0; i < 2000; ++i) {
+            std::string data(generator() % 100, ' ');
+            for (char& c : data) {
+                // mostly plain bytes, including the ones above 127
+                c = generator() % 8 == 0 ? "\"'<>&"[generator() % 5] : static_cast<char>(generator() % 255 + 1);
+            }
+            mismatch_count += RenderTextData(data) == EscapeText(data) ? 0 : 1;
+        }
+        CHECK(mismatch_count == 0);
+    }
+
+}  // namespace
+
+int main() {
+    testing::RunTest("TestEscapesAtBlockEdges"sv, TestEscapesAtBlockEdges);
+    testing::RunTest("TestRandomTexts"sv, TestRandomTexts);
+    return testing::GetExitCode();
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <iostream>
+#include <string_view>
+
+// A minimal harness for the test programs: each test is a function, CHECK reports a failed condition
+// and lets the test go on, and the program exits with 1 if any check failed
+namespace testing {
+
+    inline int& GetFailureCount() {
+        static int failure_count = 0;
+        return failure_count;
+    }
+
+    inline void ReportFailure(const char* condition, const char* file, int line) {
+        std::cerr << file << ':' << line << ": CHECK(" << condition << ") failed\n";
+        ++GetFailureCount();
+    }
+
+    template <typename Test>
+    void RunTest(std::string_view name, Test test) {
+        const int failures_before = GetFailureCount();
+        test();
+        std::cerr << name << (GetFailureCount() == failures_before ? " OK\n" : " FAILED\n");
+    }
+
+    inline int GetExitCode() {
+        return GetFailureCount() == 0 ? 0 : 1;
+    }
+
+}  // namespace testing
+
+#define CHECK(condition)                                                  \
+    do {                                                                  \
+        if (!(condition)) {                                               \
+            testing::ReportFailure(#condition, __FILE__, __LINE__);       \
+        }                                                                 \
+    } while (false)
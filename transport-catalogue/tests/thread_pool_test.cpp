@@ -0,0 +1,93 @@
+#include "../thread_pool.h"
+#include "testing.h"
+
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+using namespace std::literals;
+
+namespace {
+
+    void TestEveryTaskRunsOnce() {
+        for (const size_t thread_count : { 1, 2, 3, 8 }) {
+            thread_pool::ThreadPool pool(thread_count);
+            CHECK(pool.GetThreadCount() == thread_count);
+            // several rounds on the same pool, so that workers fall asleep between them
+            for (int round = 0; round < 20; ++round) {
+                std::vector<std::atomic<int>> runs(1000 + round);
+                thread_pool::ParallelFor(pool, runs.size(), [&](size_t i) {
+                    runs[i].fetch_add(1);
+                });
+                size_t wrong_count = 0;
+                for (const auto& run_count : runs) {
+                    wrong_count += run_count.load() == 1 ? 0 : 1;
+                }
+                CHECK(wrong_count == 0);
+            }
+        }
+    }
+
+    void TestUnevenTasks() {
+        // a few long tasks land in some queues, so the other workers have to steal the short ones
+        thread_pool::ThreadPool pool(4);
+        std::atomic<size_t> sum = 0;
+        thread_pool::ParallelFor(pool, 400, [&](size_t i) {
+            size_t value = 0;
+            const size_t step_count = i % 4 == 0 ? 200000 : 10;
+            for (size_t step = 0; step < step_count; ++step) {
+                value += step % 7;
+            }
+            sum.fetch_add(value == 0 ? 0 : 1);
+        });
+        CHECK(sum.load() == 400);
+    }
+
+    void TestExceptions() {
+        thread_pool::ThreadPool pool(3);
+        std::atomic<int> finished = 0;
+        bool is_thrown = false;
+        try {
+            thread_pool::ParallelFor(pool, 100, [&](size_t i) {
+                if (i % 10 == 3) {
+                    throw std::runtime_error("task failed");
+                }
+                finished.fetch_add(1);
+            });
+        }
+        catch (const std::runtime_error&) {
+            is_thrown = true;
+        }
+        CHECK(is_thrown);
+        // the other tasks still run, and the pool goes on working after the error
+        CHECK(finished.load() == 90);
+        thread_pool::ParallelFor(pool, 10, [&](size_t) {
+            finished.fetch_add(1);
+        });
+        CHECK(finished.load() == 100);
+    }
+
+    void TestDestroyWithoutWait() {
+        std::atomic<int> finished = 0;
+        {
+            thread_pool::ThreadPool pool(2);
+            for (int i = 0; i < 100; ++i) {
+                pool.Submit([&] {
+                    finished.fetch_add(1);
+                });
+            }
+        }
+        // the destructor lets the queued tasks finish
+        CHECK(finished.load() == 100);
+        thread_pool::ThreadPool idle_pool(4);
+    }
+
+}  // namespace
+
+int main() {
+    testing::RunTest("TestEveryTaskRunsOnce"sv, TestEveryTaskRunsOnce);
+    testing::RunTest("TestUnevenTasks"sv, TestUnevenTasks);
+    testing::RunTest("TestExceptions"sv, TestExceptions);
+    testing::RunTest("TestDestroyWithoutWait"sv, TestDestroyWithoutWait);
+    return testing::GetExitCode();
+}
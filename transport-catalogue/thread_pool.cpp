@@ -0,0 +1,130 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <utility>
+
+using namespace thread_pool;
+
+ThreadPool::ThreadPool(size_t thread_count) {
+	if (thread_count == 0) {
+		thread_count = std::max<size_t>(1, std::thread::hardware_concurrency());
+	}
+	for (size_t i = 0; i < thread_count; ++i) {
+		queues_.push_back(std::make_unique<WorkerQueue>());
+	}
+	workers_.reserve(thread_count);
+	for (size_t i = 0; i < thread_count; ++i) {
+		workers_.emplace_back([this, i] { RunWorker(i); });
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard lock(mutex_);
+		stopping_ = true;
+	}
+	task_added_.notify_all();
+	for (auto& worker : workers_) {
+		worker.join();
+	}
+}
+
+size_t ThreadPool::GetThreadCount() const {
+	return workers_.size();
+}
+
+void ThreadPool::Submit(std::function<void()> task) {
+	WorkerQueue& queue = *queues_[next_queue_];
+	next_queue_ = (next_queue_ + 1) % queues_.size();
+	unfinished_count_.fetch_add(1);
+	queued_count_.fetch_add(1);
+	{
+		std::lock_guard lock(queue.mutex);
+		queue.tasks.push_back(std::move(task));
+	}
+	// A worker counts itself as sleeping before it checks queued_count_ for the last time, so either it sees
+	// the new task or the task's submitter sees it. Taking the mutex orders the notification after its wait
+	if (sleeping_count_.load() > 0) {
+		{
+			std::lock_guard lock(mutex_);
+		}
+		task_added_.notify_one();
+	}
+}
+
+void ThreadPool::Wait() {
+	std::unique_lock lock(mutex_);
+	tasks_finished_.wait(lock, [this] { return unfinished_count_.load() == 0; });
+	if (error_) {
+		std::rethrow_exception(std::exchange(error_, nullptr));
+	}
+}
+
+void ThreadPool::RunWorker(size_t worker_index) {
+	std::function<void()> task;
+	while (true) {
+		if (TryTakeTask(worker_index, task)) {
+			std::exception_ptr error;
+			try {
+				task();
+			}
+			catch (...) {
+				error = std::current_exception();
+			}
+			task = nullptr;
+			FinishTask(error);
+			continue;
+		}
+
+		std::unique_lock lock(mutex_);
+		sleeping_count_.fetch_add(1);
+		task_added_.wait(lock, [this] { return queued_count_.load() > 0 || stopping_; });
+		sleeping_count_.fetch_sub(1);
+		if (stopping_ && queued_count_.load() == 0) {
+			return;
+		}
+	}
+}
+
+bool ThreadPool::TryTakeTask(size_t worker_index, std::function<void()>& task) {
+	if (queued_count_.load() == 0) {
+		return false;
+	}
+	{
+		WorkerQueue& own_queue = *queues_[worker_index];
+		std::lock_guard lock(own_queue.mutex);
+		if (!own_queue.tasks.empty()) {
+			task = std::move(own_queue.tasks.front());
+			own_queue.tasks.pop_front();
+			queued_count_.fetch_sub(1);
+			return true;
+		}
+	}
+	for (size_t offset = 1; offset < queues_.size(); ++offset) {
+		WorkerQueue& victim = *queues_[(worker_index + offset) % queues_.size()];
+		std::lock_guard lock(victim.mutex);
+		if (!victim.tasks.empty()) {
+			task = std::move(victim.tasks.back());
+			victim.tasks.pop_back();
+			queued_count_.fetch_sub(1);
+			return true;
+		}
+	}
+	return false;
+}
+
+void ThreadPool::FinishTask(std::exception_ptr error) {
+	if (error) {
+		std::lock_guard lock(mutex_);
+		if (!error_) {
+			error_ = error;
+		}
+	}
+	if (unfinished_count_.fetch_sub(1) == 1) {
+		// the same ordering as in Submit, for Wait
+		{
+			std::lock_guard lock(mutex_);
+		}
+		tasks_finished_.notify_all();
+	}
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace thread_pool {
+
+	// Fixed set of workers, each with its own task queue under its own lock. Tasks are spread over the queues
+	// in turn; a worker takes tasks from the front of its queue and, when it runs dry, steals from the back
+	// of the others. The shared mutex is only taken to fall asleep when every queue is empty, to wake
+	// sleeping workers and to report that the last task is finished. Submit and Wait are meant to be called from one thread
+	class ThreadPool {
+	public:
+		// 0 means one thread per hardware thread
+		explicit ThreadPool(size_t thread_count = 0);
+		~ThreadPool();
+
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+
+		size_t GetThreadCount() const;
+
+		void Submit(std::function<void()> task);
+		// blocks until every submitted task is finished and rethrows the first exception thrown by them
+		void Wait();
+
+	private:
+		struct WorkerQueue {
+			std::mutex mutex;
+			std::deque<std::function<void()>> tasks;
+		};
+
+		std::vector<std::unique_ptr<WorkerQueue>> queues_;
+		std::vector<std::thread> workers_;
+		size_t next_queue_ = 0;
+
+		// tasks in the queues; counted before a task is pushed, so for a moment it may be ahead of the queues
+		std::atomic<size_t> queued_count_ = 0;
+		// submitted tasks not finished yet
+		std::atomic<size_t> unfinished_count_ = 0;
+		// workers waiting on task_added_
+		std::atomic<size_t> sleeping_count_ = 0;
+
+		std::mutex mutex_;
+		std::condition_variable task_added_;
+		std::condition_variable tasks_finished_;
+		bool stopping_ = false;
+		std::exception_ptr error_;
+
+		void RunWorker(size_t worker_index);
+		// takes a task from the worker's own queue or steals one from another queue; false if all of them are empty
+		bool TryTakeTask(size_t worker_index, std::function<void()>& task);
+		void FinishTask(std::exception_ptr error);
+	};
+
+	// Calls function(i) for every i in [0, count) on the pool and waits for all of them
+	template <typename Function>
+	void ParallelFor(ThreadPool& pool, size_t count, Function function) {
+		for (size_t i = 0; i < count; ++i) {
+			pool.Submit([&function, i] { function(i); });
+		}
+		pool.Wait();
+	}
+}
@@ -1,91 +1,362 @@
 ﻿#include "transport_catalogue.h"
 #include "geo.h"
 
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <mutex>
+#include <numeric>
+#include <stdexcept>
 #include <unordered_set>
 #include <cassert>
 
 using namespace transport_catalogue;
 
 
-void TransportCatalogue::AddStop(const std::string& stop_name, geo::Coordinates coordinates) {
-    Stop stop{ stop_name, coordinates };
-    stops_.emplace_back(stop);
-    stop_name_to_data_.insert({ stops_.back().name, &stops_.back() });
-    // добавляем остановку в индекс
-    stop_name_to_buses_.insert({ &stops_.back(), {} });
+std::string_view StringPool::Add(std::string_view value) {
+    char* data = nullptr;
+    if (value.size() <= block_free_) {
+        data = next_;
+        next_ += value.size();
+        block_free_ -= value.size();
+    }
+    else if (value.size() > BLOCK_SIZE / 4) {
+        // длинная строка получает отдельный блок, а текущий остаётся для следующих строк
+        blocks_.push_back(std::make_unique<char[]>(value.size()));
+        data = blocks_.back().get();
+    }
+    else {
+        blocks_.push_back(std::make_unique<char[]>(BLOCK_SIZE));
+        data = blocks_.back().get();
+        next_ = data + value.size();
+        block_free_ = BLOCK_SIZE - value.size();
+    }
+    if (!value.empty()) {
+        std::memcpy(data, value.data(), value.size());
+    }
+    return { data, value.size() };
 }
 
-void TransportCatalogue::SetStopDistances(const std::string_view from_stop_name, const std::string_view to_stop_name, int distance) {
-    std::pair<const Stop*, const Stop*> stop_pair(stop_name_to_data_[from_stop_name], stop_name_to_data_[to_stop_name]);
-    stop_pairs_to_distance_.insert({ stop_pair, distance });
+namespace {
+
+    // финализатор MurmurHash3: каждый бит ключа влияет на все биты хеша
+    uint64_t MixHash(uint64_t key) {
+        key ^= key >> 33;
+        key *= 0xff51afd7ed558ccdULL;
+        key ^= key >> 33;
+        key *= 0xc4ceb9fe1a85ec53ULL;
+        key ^= key >> 33;
+        return key;
+    }
+
+    uint64_t GetPairKey(StopId lower, StopId upper) {
+        return (static_cast<uint64_t>(lower) << 32) | upper;
+    }
 
 }
 
-int TransportCatalogue::GetStopsDistance(const Stop* from_stop, const Stop* to_stop) const {
-    return stop_pairs_to_distance_.count({ from_stop, to_stop }) != 0 ?
-        stop_pairs_to_distance_.at({ from_stop, to_stop })
-        : stop_pairs_to_distance_.count({ to_stop, from_stop }) != 0
-        ? stop_pairs_to_distance_.at({ to_stop, from_stop })
-        : 0;
+void DistanceTable::Set(StopId from, StopId to, int distance) {
+    if ((used_slots_ + 1) * 2 > slots_.size()) {
+        Grow();
+    }
+    const uint64_t key = GetPairKey(std::min(from, to), std::max(from, to));
+    const size_t mask = slots_.size() - 1;
+    size_t index = MixHash(key) & mask;
+    while (slots_[index].key != key && slots_[index].key != EMPTY_KEY) {
+        index = (index + 1) & mask;
+    }
+    Slot& slot = slots_[index];
+    if (slot.key == EMPTY_KEY) {
+        slot.key = key;
+        ++used_slots_;
+    }
+    // к самой себе расстояние хранится как прямое
+    int& value = from <= to ? slot.forward : slot.backward;
+    if (value == NO_DISTANCE) {
+        value = distance;
+        ++size_;
+    }
 }
 
-void TransportCatalogue::AddBus(const std::string& bus_name, const std::vector<std::string_view>& stops, bool is_roundtrip) {
-    Bus current_bus;
-    current_bus.name = bus_name;
-    current_bus.is_roundtrip = is_roundtrip;
-    for (const auto& stop_name : stops) {
-        current_bus.route.emplace_back(FindStop(stop_name));
+int DistanceTable::Get(StopId from, StopId to) const {
+    const Slot* slot = Find(GetPairKey(std::min(from, to), std::max(from, to)));
+    if (slot == nullptr) {
+        return 0;
     }
-    buses_.emplace_back(current_bus);
-    bus_name_to_data_.insert({ buses_.back().name, &buses_.back() });
-    for (const auto stop : buses_.back().route) {
-        stop_name_to_buses_[stop].emplace(&buses_.back());
+    const int direct = from <= to ? slot->forward : slot->backward;
+    if (direct != NO_DISTANCE) {
+        return direct;
     }
+    const int reverse = from <= to ? slot->backward : slot->forward;
+    return reverse != NO_DISTANCE ? reverse : 0;
 }
 
-Bus* TransportCatalogue::FindBus(const std::string_view bus_name) const {
-    if (bus_name_to_data_.count(bus_name) == 0) {
+const DistanceTable::Slot* DistanceTable::Find(uint64_t key) const {
+    if (slots_.empty()) {
         return nullptr;
     }
-    return bus_name_to_data_.at(bus_name);
+    const size_t mask = slots_.size() - 1;
+    for (size_t index = MixHash(key) & mask; slots_[index].key != EMPTY_KEY; index = (index + 1) & mask) {
+        if (slots_[index].key == key) {
+            return &slots_[index];
+        }
+    }
+    return nullptr;
 }
 
-Stop* TransportCatalogue::FindStop(const std::string_view stop_name) const {
-    if (stop_name_to_data_.count(stop_name) == 0) {
-        return nullptr;
+void DistanceTable::Grow() {
+    std::vector<Slot> old_slots = std::move(slots_);
+    slots_.assign(old_slots.empty() ? 16 : old_slots.size() * 2, Slot{});
+    const size_t mask = slots_.size() - 1;
+    for (const Slot& slot : old_slots) {
+        if (slot.key == EMPTY_KEY) {
+            continue;
+        }
+        size_t index = MixHash(slot.key) & mask;
+        while (slots_[index].key != EMPTY_KEY) {
+            index = (index + 1) & mask;
+        }
+        slots_[index] = slot;
+    }
+}
+
+const std::vector<DistanceTable::Slot>& DistanceTable::GetSlots() const {
+    return slots_;
+}
+
+void DistanceTable::AssignSlots(std::vector<Slot> slots, StopId stop_count) {
+    if ((slots.size() & (slots.size() - 1)) != 0) {
+        throw std::invalid_argument("distance table size should be a power of two");
+    }
+    size_t size = 0;
+    size_t used_slots = 0;
+    for (const Slot& slot : slots) {
+        if (slot.key == EMPTY_KEY) {
+            continue;
+        }
+        const StopId lower = static_cast<StopId>(slot.key >> 32);
+        const StopId upper = static_cast<StopId>(slot.key);
+        if (lower > upper || upper >= stop_count) {
+            throw std::invalid_argument("distance table refers to an unknown stop");
+        }
+        ++used_slots;
+        size += (slot.forward != NO_DISTANCE) + (slot.backward != NO_DISTANCE);
+    }
+    // поиск останавливается на свободной ячейке, поэтому она должна быть
+    if (used_slots * 2 > slots.size()) {
+        throw std::invalid_argument("distance table is more than half full");
+    }
+    slots_ = std::move(slots);
+    size_ = size;
+    used_slots_ = used_slots;
+}
+
+void TransportCatalogue::Reserve(size_t stop_count, size_t bus_count, size_t route_stop_count) {
+    stops_.reserve(stop_count);
+    stop_points_.Reserve(stop_count);
+    stop_ids_.reserve(stop_count);
+    buses_.reserve(bus_count);
+    bus_ids_.reserve(bus_count);
+    route_stops_.reserve(route_stop_count);
+}
+
+void TransportCatalogue::AddStop(std::string_view stop_name, geo::Coordinates coordinates) {
+    const StopId id = static_cast<StopId>(stops_.size());
+    stops_.push_back({ names_.Add(stop_name), coordinates, id });
+    stop_points_.Add(coordinates);
+    stop_ids_.insert({ stops_.back().name, id });
+    is_bus_index_ready_ = false;
+    ++version_;
+}
+
+void TransportCatalogue::SetStopDistances(const std::string_view from_stop_name, const std::string_view to_stop_name, int distance) {
+    const Stop* from_stop = FindStop(from_stop_name);
+    const Stop* to_stop = FindStop(to_stop_name);
+    if (from_stop == nullptr || to_stop == nullptr) {
+        return;
     }
-    return stop_name_to_data_.at(stop_name);
+    SetStopDistances(from_stop->id, to_stop->id, distance);
+}
+
+void TransportCatalogue::SetStopDistances(StopId from_stop, StopId to_stop, int distance) {
+    stop_pairs_to_distance_.Set(from_stop, to_stop, distance);
+    // длины маршрутов могли измениться
+    is_bus_info_cache_ready_ = false;
+    ++version_;
+}
+
+void TransportCatalogue::AssignStopDistances(std::vector<DistanceTable::Slot> slots) {
+    stop_pairs_to_distance_.AssignSlots(std::move(slots), static_cast<StopId>(stops_.size()));
+    is_bus_info_cache_ready_ = false;
+    ++version_;
+}
+
+int TransportCatalogue::GetStopsDistance(StopId from_stop, StopId to_stop) const {
+    return stop_pairs_to_distance_.Get(from_stop, to_stop);
+}
+
+void TransportCatalogue::AddBus(std::string_view bus_name, const std::vector<std::string_view>& stops, bool is_roundtrip) {
+    // id находятся до изменения справочника, чтобы неизвестная остановка не оставила в route_stops_ половину маршрута
+    std::vector<StopId> stop_ids;
+    stop_ids.reserve(stops.size());
+    for (const auto& stop_name : stops) {
+        stop_ids.push_back(stop_ids_.at(stop_name));
+    }
+    const StopId* first = stop_ids.data();
+    AddBus(bus_name, ranges::Range{ first, first + stop_ids.size() }, is_roundtrip);
+}
+
+void TransportCatalogue::AddBus(std::string_view bus_name, ranges::Range<const StopId*> stops, bool is_roundtrip) {
+    const size_t route_offset = route_stops_.size();
+    route_stops_.insert(route_stops_.end(), stops.begin(), stops.end());
+    AddBusRoute(bus_name, route_offset, is_roundtrip);
+}
+
+void TransportCatalogue::AddBusRoute(std::string_view bus_name, size_t route_offset, bool is_roundtrip) {
+    const BusId id = static_cast<BusId>(buses_.size());
+    const uint32_t route_size = static_cast<uint32_t>(route_stops_.size() - route_offset);
+    buses_.push_back({ names_.Add(bus_name), id, static_cast<uint32_t>(route_offset), route_size, is_roundtrip });
+    bus_ids_.insert({ buses_.back().name, id });
+    is_bus_index_ready_ = false;
+    is_bus_info_cache_ready_ = false;
+    ++version_;
+}
+
+const Bus* TransportCatalogue::FindBus(const std::string_view bus_name) const {
+    const auto it = bus_ids_.find(bus_name);
+    return it == bus_ids_.end() ? nullptr : &buses_[it->second];
+}
+
+const Stop* TransportCatalogue::FindStop(const std::string_view stop_name) const {
+    const auto it = stop_ids_.find(stop_name);
+    return it == stop_ids_.end() ? nullptr : &stops_[it->second];
+}
+
+const Stop& TransportCatalogue::GetStop(StopId stop_id) const {
+    return stops_[stop_id];
+}
+
+const Bus& TransportCatalogue::GetBus(BusId bus_id) const {
+    return buses_[bus_id];
+}
+
+ranges::Range<const StopId*> TransportCatalogue::GetRoute(const Bus& bus) const {
+    const StopId* first = route_stops_.data() + bus.route_offset;
+    return { first, first + bus.route_size };
 }
 
 BusInfo TransportCatalogue::GetBusInfo(const std::string_view bus_name) const {
-    Bus* bus_info = FindBus(bus_name);
+    const Bus* bus_info = FindBus(bus_name);
     assert(bus_info != nullptr);
+    BusInfoCache& cache = GetBusInfoCache();
+    // после первого подсчёта маршрута запрос обходится без блокировок
+    std::call_once(cache.computed[bus_info->id], [&] {
+        cache.infos[bus_info->id] = ComputeBusInfo(*bus_info);
+    });
+    return cache.infos[bus_info->id];
+}
+
+TransportCatalogue::BusInfoCache& TransportCatalogue::GetBusInfoCache() const {
+    if (!is_bus_info_cache_ready_.load(std::memory_order_acquire)) {
+        std::lock_guard lock(bus_info_cache_mutex_);
+        if (!is_bus_info_cache_ready_.load(std::memory_order_relaxed)) {
+            // флаги std::once_flag не сбрасываются, поэтому выделяются новые
+            bus_info_cache_.infos.assign(buses_.size(), BusInfo{});
+            bus_info_cache_.computed = std::make_unique<std::once_flag[]>(buses_.size());
+            is_bus_info_cache_ready_.store(true, std::memory_order_release);
+        }
+    }
+    return bus_info_cache_;
+}
+
+BusInfo TransportCatalogue::ComputeBusInfo(const Bus& bus) const {
+    const StopId* route = route_stops_.data() + bus.route_offset;
+    // расстояния по прямой считаются для всего маршрута сразу и складываются по порядку
+    std::vector<double> geo_distances(bus.route_size == 0 ? 0 : bus.route_size - 1);
+    stop_points_.ComputeDistances(route, bus.route_size, geo_distances.data());
     double geo_distance = 0.0;
     int route_length = 0;
-    std::unordered_set<Stop*> unique_stops;
-    for (size_t i = 0; i < bus_info->route.size() - 1; ++i) {
-        geo_distance += geo::ComputeDistance({ bus_info->route[i]->coordinates.lat, bus_info->route[i]->coordinates.lng }, { bus_info->route[i + 1]->coordinates.lat, bus_info->route[i + 1]->coordinates.lng });
-        route_length += GetStopsDistance(bus_info->route[i], bus_info->route[i + 1]);
-        unique_stops.emplace(bus_info->route[i]);
+    std::unordered_set<StopId> unique_stops;
+    for (size_t i = 0; i + 1 < bus.route_size; ++i) {
+        geo_distance += geo_distances[i];
+        route_length += GetStopsDistance(route[i], route[i + 1]);
+        unique_stops.emplace(route[i]);
     }
     double curvature = route_length / geo_distance;
-    return { bus_info->route.size(), unique_stops.size(), route_length, curvature };
+    return { bus.route_size, unique_stops.size(), route_length, curvature };
 }
 
-std::set<const Bus*, BusSetCmp> TransportCatalogue::GetStopInfo(const std::string_view stop_name) const {
-    Stop* stop_ptr = FindStop(stop_name);
+ranges::Range<const BusId*> TransportCatalogue::GetStopInfo(const std::string_view stop_name) const {
+    const Stop* stop_ptr = FindStop(stop_name);
     assert(stop_ptr != nullptr);
-    return stop_name_to_buses_.at(stop_ptr);
+    const BusIndex& index = GetBusIndex();
+    const BusId* buses = index.stop_buses.data();
+    return { buses + index.stop_bus_offsets[stop_ptr->id], buses + index.stop_bus_offsets[stop_ptr->id + 1] };
 }
 
-std::set<const Bus*, BusSetCmp> TransportCatalogue::GetBuses() const {
-    std::set<const Bus*, BusSetCmp> result;
-    for (const Bus& bus : buses_) {
-        result.emplace(&bus);
+const TransportCatalogue::BusIndex& TransportCatalogue::GetBusIndex() const {
+    // справочник в это время не меняется, так что индекс строится один раз, а дальше только читается
+    if (!is_bus_index_ready_.load(std::memory_order_acquire)) {
+        std::lock_guard lock(bus_index_mutex_);
+        if (!is_bus_index_ready_.load(std::memory_order_relaxed)) {
+            BuildBusIndex();
+            is_bus_index_ready_.store(true, std::memory_order_release);
+        }
     }
-    return result;
+    return bus_index_;
 }
 
-std::deque<Stop> TransportCatalogue::GetStops() const {
-    return stops_; 
-}
\ No newline at end of file
+void TransportCatalogue::BuildBusIndex() const {
+    std::vector<BusId> buses_by_name(buses_.size());
+    std::iota(buses_by_name.begin(), buses_by_name.end(), 0);
+    std::sort(buses_by_name.begin(), buses_by_name.end(), [this](BusId lhs, BusId rhs) {
+        return buses_[lhs].name < buses_[rhs].name;
+    });
+    bus_index_.buses_by_name.clear();
+    for (const BusId bus_id : buses_by_name) {
+        bus_index_.buses_by_name.push_back(&buses_[bus_id]);
+    }
+
+    // маршруты перебираются по названиям, поэтому у каждой остановки они сразу лежат в нужном порядке.
+    // Первый проход считает маршруты остановок, второй раскладывает их; last_bus отсекает повторы остановки в маршруте
+    constexpr BusId NO_BUS = std::numeric_limits<BusId>::max();
+    std::vector<BusId> last_bus(stops_.size(), NO_BUS);
+    auto for_each_stop_bus = [&](auto action) {
+        std::fill(last_bus.begin(), last_bus.end(), NO_BUS);
+        for (const BusId bus_id : buses_by_name) {
+            for (const StopId stop_id : GetRoute(buses_[bus_id])) {
+                if (last_bus[stop_id] != bus_id) {
+                    last_bus[stop_id] = bus_id;
+                    action(stop_id, bus_id);
+                }
+            }
+        }
+    };
+    bus_index_.stop_bus_offsets.assign(stops_.size() + 1, 0);
+    for_each_stop_bus([this](StopId stop_id, BusId) {
+        ++bus_index_.stop_bus_offsets[stop_id + 1];
+    });
+    std::partial_sum(bus_index_.stop_bus_offsets.begin(), bus_index_.stop_bus_offsets.end(), bus_index_.stop_bus_offsets.begin());
+    bus_index_.stop_buses.resize(bus_index_.stop_bus_offsets.back());
+    std::vector<uint32_t> next(bus_index_.stop_bus_offsets.begin(), bus_index_.stop_bus_offsets.end() - 1);
+    for_each_stop_bus([&](StopId stop_id, BusId bus_id) {
+        bus_index_.stop_buses[next[stop_id]++] = bus_id;
+    });
+}
+
+ranges::Range<const Bus* const*> TransportCatalogue::GetBuses() const {
+    const std::vector<const Bus*>& buses = GetBusIndex().buses_by_name;
+    return { buses.data(), buses.data() + buses.size() };
+}
+
+const std::vector<Stop>& TransportCatalogue::GetStops() const {
+    return stops_;
+}
+
+const DistanceTable& TransportCatalogue::GetStopsDistances() const {
+    return stop_pairs_to_distance_;
+}
+
+uint64_t TransportCatalogue::GetVersion() const {
+    return version_;
+}
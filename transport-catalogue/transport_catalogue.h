@@ -1,13 +1,17 @@
 #pragma once
 
-#include <deque>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <string_view>
 #include <unordered_map>
-#include <set>
 #include <vector>
 
 #include "domain.h"
+#include "ranges.h"
 
 namespace transport_catalogue {
 
@@ -18,42 +22,162 @@ namespace transport_catalogue {
 		double curvature;
 	};
 
-	class StopPairHasher {
+	// Расстояния между остановками в открытой хеш-таблице. Пара остановок хранится в одной ячейке
+	// под ключом (меньший id, больший id) вместе с расстояниями в обе стороны, так что любой запрос,
+	// в том числе с подстановкой обратного расстояния, — это один поиск
+	class DistanceTable {
 	public:
-		size_t operator() (std::pair<const Stop*, const Stop*> stops_pair) const {
-			size_t hash_first = hasher_(stops_pair.first);
-			size_t hash_second = hasher_(stops_pair.second);
-			return (hash_first + hash_second) * 37;
+		// первое заданное расстояние для направления не перезаписывается
+		void Set(StopId from, StopId to, int distance);
+		// расстояние from -> to, а если оно не задано, то to -> from; 0, если не задано ни одно
+		int Get(StopId from, StopId to) const;
+		size_t Size() const {
+			return size_;
 		}
-		bool operator ==(std::pair<const Stop*, const Stop*> other) {
-			return *this == other;
+
+		// callback(from, to, distance) для каждого заданного расстояния
+		template <typename Callback>
+		void ForEach(Callback callback) const {
+			for (const Slot& slot : slots_) {
+				if (slot.key == EMPTY_KEY) {
+					continue;
+				}
+				const StopId lower = static_cast<StopId>(slot.key >> 32);
+				const StopId upper = static_cast<StopId>(slot.key);
+				if (slot.forward != NO_DISTANCE) {
+					callback(lower, upper, slot.forward);
+				}
+				if (slot.backward != NO_DISTANCE) {
+					callback(upper, lower, slot.backward);
+				}
+			}
 		}
 
+		struct Slot {
+			uint64_t key = EMPTY_KEY;
+			// от меньшего id к большему и обратно
+			int forward = NO_DISTANCE;
+			int backward = NO_DISTANCE;
+		};
+
+		// ячейки таблицы как есть: по ним таблицу восстанавливают без повторной вставки
+		const std::vector<Slot>& GetSlots() const;
+		// принимает ячейки, полученные из GetSlots, с остановками меньше stop_count;
+		// std::invalid_argument, если такой таблицы быть не может
+		void AssignSlots(std::vector<Slot> slots, StopId stop_count);
+
+	private:
+		static constexpr uint64_t EMPTY_KEY = ~uint64_t{ 0 };
+		static constexpr int NO_DISTANCE = std::numeric_limits<int>::min();
+
+		// размер — степень двойки, заполнено не больше половины
+		std::vector<Slot> slots_;
+		// число заданных направлений
+		size_t size_ = 0;
+		size_t used_slots_ = 0;
+
+		const Slot* Find(uint64_t key) const;
+		void Grow();
+	};
+
+	// Хранит строки в больших блоках. Добавление не перемещает уже сохранённые строки,
+	// поэтому string_view на них остаются действительными, пока жив пул
+	class StringPool {
+	public:
+		std::string_view Add(std::string_view value);
+
 	private:
-		std::hash<const Stop*> hasher_;
+		static constexpr size_t BLOCK_SIZE = 64 * 1024;
+
+		std::vector<std::unique_ptr<char[]>> blocks_;
+		// свободная часть текущего блока
+		char* next_ = nullptr;
+		size_t block_free_ = 0;
 	};
 
+	// Остановки и маршруты лежат в плотных массивах и адресуются 32-битными id в порядке добавления.
+	// Указатели и ссылки на них действительны до следующего добавления остановки или маршрута
 	class TransportCatalogue {
 
 	public:
-		void AddStop(const std::string& stop_name, geo::Coordinates coordinates);
+		// заранее выделяет память под известное число остановок и маршрутов, например при загрузке снимка
+		void Reserve(size_t stop_count, size_t bus_count, size_t route_stop_count);
+		void AddStop(std::string_view stop_name, geo::Coordinates coordinates);
+		// расстояния до неизвестных остановок не сохраняются
 		void SetStopDistances(const std::string_view from_stop_name, const std::string_view to_stop_name, int distance);
-		int GetStopsDistance(const Stop* from_stop, const Stop* to_stop) const;
-		void AddBus(const std::string& bus_name, const std::vector<std::string_view>& stops, bool is_roundtrip);
-		Stop* FindStop(const std::string_view stop_name) const;
-		Bus* FindBus(const std::string_view bus_name) const;
+		void SetStopDistances(StopId from_stop, StopId to_stop, int distance);
+		// заменяет все расстояния ячейками таблицы, сохранёнными из DistanceTable::GetSlots
+		void AssignStopDistances(std::vector<DistanceTable::Slot> slots);
+		// расстояние по дорогам, а если оно задано только в обратную сторону, то обратное
+		int GetStopsDistance(StopId from_stop, StopId to_stop) const;
+		// все остановки маршрута должны быть уже добавлены, иначе std::out_of_range
+		void AddBus(std::string_view bus_name, const std::vector<std::string_view>& stops, bool is_roundtrip);
+		// маршрут из id уже добавленных остановок, например найденных заранее в нескольких потоках
+		void AddBus(std::string_view bus_name, ranges::Range<const StopId*> stops, bool is_roundtrip);
+		const Stop* FindStop(const std::string_view stop_name) const;
+		const Bus* FindBus(const std::string_view bus_name) const;
+		const Stop& GetStop(StopId stop_id) const;
+		const Bus& GetBus(BusId bus_id) const;
+		// id остановок маршрута по порядку
+		ranges::Range<const StopId*> GetRoute(const Bus& bus) const;
+		// Считается при первом запросе маршрута и дальше берётся готовой, пока не изменятся расстояния.
+		// Можно вызывать из нескольких потоков, если справочник в это время не меняется
 		BusInfo GetBusInfo(const std::string_view bus_name) const;
-		std::set<const Bus*, BusSetCmp> GetStopInfo(const std::string_view stop_name) const;
+		// id маршрутов через остановку в порядке их названий. Индекс строится при первом запросе
+		// после изменения маршрутов; диапазон действителен до следующего изменения справочника
+		ranges::Range<const BusId*> GetStopInfo(const std::string_view stop_name) const;
 
-		std::set<const Bus*, BusSetCmp> GetBuses() const;
-		std::deque<Stop> GetStops() const;
+		// маршруты в порядке названий; порядок считается вместе с индексом GetStopInfo
+		// и действителен до следующего изменения справочника
+		ranges::Range<const Bus* const*> GetBuses() const;
+		// остановки по возрастанию id
+		const std::vector<Stop>& GetStops() const;
+		const DistanceTable& GetStopsDistances() const;
+		// растёт при каждом изменении справочника, по нему узнают, что сохранённые результаты устарели
+		uint64_t GetVersion() const;
 
 	private:
-		std::deque<Stop> stops_;
-		std::unordered_map<std::string_view, Stop*> stop_name_to_data_;
-		std::unordered_map<Stop*, std::set<const Bus*, BusSetCmp>> stop_name_to_buses_;
-		std::unordered_map<std::pair<const Stop*, const Stop*>, int, StopPairHasher> stop_pairs_to_distance_;
-		std::deque<Bus> buses_;
-		std::unordered_map<std::string_view, Bus*> bus_name_to_data_;
+		StringPool names_;
+		std::vector<Stop> stops_;
+		// координаты остановок по их id, подготовленные для расчёта длин маршрутов
+		geo::PointBatch stop_points_;
+		std::unordered_map<std::string_view, StopId> stop_ids_;
+		DistanceTable stop_pairs_to_distance_;
+		std::vector<Bus> buses_;
+		// остановки всех маршрутов подряд
+		std::vector<StopId> route_stops_;
+		std::unordered_map<std::string_view, BusId> bus_ids_;
+		uint64_t version_ = 0;
+
+		// Порядок маршрутов и маршруты по остановкам, строится при первом запросе после загрузки
+		struct BusIndex {
+			std::vector<const Bus*> buses_by_name;
+			// маршруты через остановку i в порядке названий лежат в stop_buses
+			// с stop_bus_offsets[i] по stop_bus_offsets[i + 1]
+			std::vector<uint32_t> stop_bus_offsets;
+			std::vector<BusId> stop_buses;
+		};
+		mutable std::mutex bus_index_mutex_;
+		mutable std::atomic<bool> is_bus_index_ready_ = false;
+		mutable BusIndex bus_index_;
+
+		// Статистика маршрутов по их id. Ячейка считается при первом запросе маршрута,
+		// а сами массивы выделяются заново при первом запросе после изменения справочника
+		struct BusInfoCache {
+			std::vector<BusInfo> infos;
+			std::unique_ptr<std::once_flag[]> computed;
+		};
+		mutable std::mutex bus_info_cache_mutex_;
+		mutable std::atomic<bool> is_bus_info_cache_ready_ = false;
+		mutable BusInfoCache bus_info_cache_;
+
+		// добавляет маршрут, остановки которого уже дописаны в route_stops_ начиная с route_offset
+		void AddBusRoute(std::string_view bus_name, size_t route_offset, bool is_roundtrip);
+		BusInfo ComputeBusInfo(const Bus& bus) const;
+		// можно вызывать из нескольких потоков
+		const BusIndex& GetBusIndex() const;
+		void BuildBusIndex() const;
+		// можно вызывать из нескольких потоков
+		BusInfoCache& GetBusInfoCache() const;
 	};
 }
\ No newline at end of file
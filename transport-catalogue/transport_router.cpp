@@ -1,18 +1,55 @@
 #include "transport_router.h"
+#include "thread_pool.h"
 
 #include <algorithm>
+#include <cmath>
+#include <stdexcept>
 
 using namespace std::literals;
 using namespace transport_router;
 
-TransportRouter::TransportRouter(const transport_catalogue::TransportCatalogue& transport_catalogue, const TranspRouteParams& params)
+TransportRouter::TransportRouter(const transport_catalogue::TransportCatalogue& transport_catalogue, const TranspRouteParams& params, size_t thread_count)
 	:transport_catalogue_(transport_catalogue),
-	graph_(Graph{ transport_catalogue_.GetStops().size() * 2 }),
+	graph_(),
 	router_(nullptr),
 	params_(params)
 {
-	MakeGraph();
-	router_ = std::make_unique<Router>(graph_);
+	MakeGraph(thread_count);
+	MakeRouter(thread_count);
+}
+
+TransportRouter::TransportRouter(const transport_catalogue::TransportCatalogue& transport_catalogue, const TranspRouteParams& params,
+	Graph graph, std::optional<graph::ContractionHierarchy<double>> contraction_hierarchy,
+	std::optional<graph::AllPairsTable<double>> all_pairs_table, size_t thread_count)
+	:transport_catalogue_(transport_catalogue),
+	graph_(std::move(graph)),
+	router_(nullptr),
+	params_(params)
+{
+	if (IndexEntities() != graph_.GetVertexCount()) {
+		throw std::invalid_argument("routing graph does not match the catalogue");
+	}
+	if (contraction_hierarchy) {
+		router_ = std::make_unique<Router>(graph_, std::move(*contraction_hierarchy));
+	}
+	else if (all_pairs_table) {
+		router_ = std::make_unique<Router>(graph_, std::move(*all_pairs_table));
+	}
+	else {
+		MakeRouter(thread_count);
+	}
+}
+
+const Graph& TransportRouter::GetGraph() const {
+	return graph_;
+}
+
+const transport_router::Router& TransportRouter::GetRouter() const {
+	return *router_;
+}
+
+const TranspRouteParams& TransportRouter::GetParams() const {
+	return params_;
 }
 
 double TransportRouter::CalculateTime(double distance, double velocity) {
@@ -21,51 +58,163 @@ double TransportRouter::CalculateTime(double distance, double velocity) {
 	return time_in_hour * MINUTES_IN_HOURS;
 }
 
-void TransportRouter::AddStopsToGraph() {
-	size_t curr_vertex_id = 0;
+double TransportRouter::ComputeGeoTime(VertexId from, VertexId to) const {
+	const double distance = geo::ComputeDistance(vertex_coordinates_[from], vertex_coordinates_[to]);
+	// acos may return NaN for coinciding points due to rounding
+	if (std::isnan(distance)) {
+		return 0.0;
+	}
+	return CalculateTime(distance, params_.bus_velocity);
+}
+
+// lower bound of travel time: the bus rides straight to the target at full speed,
+// over roads as much shorter than the great circle as the shortest road of the graph
+double TransportRouter::EstimateTime(VertexId from, VertexId to) const {
+	return ComputeGeoTime(from, to) * heuristic_scale_;
+}
+
+// every edge weighs at least heuristic_scale_ times the great-circle time between its ends, so by the triangle
+// inequality the estimate never exceeds the rest of any route and stays consistent along an edge
+double TransportRouter::ComputeHeuristicScale() const {
+	double scale = 1.0;
+	for (EdgeId edge_id = 0; edge_id < graph_.GetEdgeCount(); ++edge_id) {
+		const Edge<double>& edge = graph_.GetEdge(edge_id);
+		const double geo_time = ComputeGeoTime(edge.from, edge.to);
+		if (geo_time > 0.0) {
+			scale = std::min(scale, edge.weight / geo_time);
+		}
+	}
+	return scale;
+}
+
+// vertices are numbered deterministically from the catalogue, so a stored graph can be reused with it:
+// a pair of wait/go vertices for every stop, then a ride vertex for every stop of every route
+size_t TransportRouter::IndexEntities() {
+	const auto buses = transport_catalogue_.GetBuses();
+	buses_.assign(buses.begin(), buses.end());
+
+	for (const Stop& stop : transport_catalogue_.GetStops()) {
+		vertex_coordinates_.insert(vertex_coordinates_.end(), 2, stop.coordinates);
+	}
+	for (const Bus* bus : buses_) {
+		for (const StopId stop_id : transport_catalogue_.GetRoute(*bus)) {
+			vertex_coordinates_.push_back(transport_catalogue_.GetStop(stop_id).coordinates);
+		}
+	}
+	return vertex_coordinates_.size();
+}
+
+TransportRouter::StopPairVertex TransportRouter::GetStopVertices(StopId stop_id) {
+	return { stop_id * 2, stop_id * 2 + 1 };
+}
+
+void TransportRouter::AddStopsToGraph(std::vector<Edge<double>>& edges) {
 	// draw stops
-	for (const auto& stop : transport_catalogue_.GetStops()) {
-		// add pairs of vertices for stops
-		stops_to_vertex_ids_[stop.name] = { curr_vertex_id, curr_vertex_id + 1 };
-		graph_.AddEdge({ stops_to_vertex_ids_.at(stop.name).stop_wait_id, stops_to_vertex_ids_.at(stop.name).stop_go_id, static_cast<double>(params_.bus_wait_time), EdgeType::WAIT, stop.name, 0 });
+	const StopId stop_count = static_cast<StopId>(transport_catalogue_.GetStops().size());
+	for (StopId stop_id = 0; stop_id < stop_count; ++stop_id) {
+		const StopPairVertex stop_vertex_ids = GetStopVertices(stop_id);
+		edges.emplace_back(stop_vertex_ids.stop_wait_id, stop_vertex_ids.stop_go_id, static_cast<double>(params_.bus_wait_time), EdgeType::WAIT, stop_id, 0);
+	}
+}
 
-		curr_vertex_id += 2;
+// every bus gets a chain of ride vertices, one per stop of its route: a passenger boards the bus
+// from the go vertex of a stop, rides along the chain and alights to the wait vertex of another stop,
+// so the number of edges is linear in the route length
+void TransportRouter::AddBusRouteToGraph(uint32_t bus_id, VertexId first_ride_vertex_id, Edge<double>* edges) const {
+	const auto route = transport_catalogue_.GetRoute(*buses_[bus_id]);
+	const StopId* stops = route.begin();
+	const uint32_t route_size = static_cast<uint32_t>(route.end() - route.begin());
+	for (uint32_t i = 0; i < route_size; ++i) {
+		const VertexId ride_vertex_id = first_ride_vertex_id + i;
+		const StopPairVertex stop_vertex_ids = GetStopVertices(stops[i]);
+		if (i + 1 < route_size) {
+			double ride_time = CalculateTime(transport_catalogue_.GetStopsDistance(stops[i], stops[i + 1]) * 1.0, params_.bus_velocity);
+			*edges++ = { stop_vertex_ids.stop_go_id, ride_vertex_id, 0.0, EdgeType::BOARD, bus_id, 0 };
+			*edges++ = { ride_vertex_id, ride_vertex_id + 1, ride_time, EdgeType::BUS, bus_id, 1 };
+		}
+		if (i > 0) {
+			*edges++ = { ride_vertex_id, stop_vertex_ids.stop_wait_id, 0.0, EdgeType::ALIGHT, bus_id, 0 };
+		}
 	}
 }
 
-void TransportRouter::MakeGraph() {
-	AddStopsToGraph();
-	std::set<const Bus*, BusSetCmp> buses = transport_catalogue_.GetBuses();
+void TransportRouter::MakeGraph(size_t thread_count) {
+	const size_t vertex_count = IndexEntities();
+	// a wait edge for every stop and three edges for every segment of every route;
+	// every bus writes its edges to its own place, so the order does not depend on the threads
+	const size_t stop_count = transport_catalogue_.GetStops().size();
+	std::vector<size_t> bus_edge_offsets(buses_.size() + 1, stop_count);
+	std::vector<VertexId> bus_ride_vertex_ids(buses_.size() + 1, static_cast<VertexId>(stop_count * 2));
+	for (uint32_t bus_id = 0; bus_id < buses_.size(); ++bus_id) {
+		const uint32_t route_size = buses_[bus_id]->route_size;
+		bus_edge_offsets[bus_id + 1] = bus_edge_offsets[bus_id] + (route_size == 0 ? 0 : (route_size - 1) * 3);
+		bus_ride_vertex_ids[bus_id + 1] = bus_ride_vertex_ids[bus_id] + route_size;
+	}
+	std::vector<Edge<double>> edges;
+	edges.reserve(bus_edge_offsets.back());
+
+	AddStopsToGraph(edges);
 	// add edges for bus routes
-	for (const auto& bus : buses) {
-		AddBusRoutesToGraph(bus->route.begin(), bus->route.end(), bus->name);
-		if (!bus->is_roundtrip) {
-			AddBusRoutesToGraph(bus->route.rbegin(), bus->route.rend(), bus->name);
+	edges.resize(bus_edge_offsets.back());
+	const auto add_bus_routes = [&](uint32_t first_bus, uint32_t last_bus) {
+		for (uint32_t bus_id = first_bus; bus_id < last_bus; ++bus_id) {
+			AddBusRouteToGraph(bus_id, bus_ride_vertex_ids[bus_id], edges.data() + bus_edge_offsets[bus_id]);
 		}
+	};
+	if (thread_count == 1) {
+		add_bus_routes(0, static_cast<uint32_t>(buses_.size()));
+	}
+	else {
+		thread_pool::ThreadPool pool(thread_count);
+		// a few blocks per thread even out the routes of different length
+		const size_t block_count = std::min(buses_.size(), pool.GetThreadCount() * 4);
+		thread_pool::ParallelFor(pool, block_count, [&](size_t block) {
+			add_bus_routes(static_cast<uint32_t>(buses_.size() * block / block_count),
+				static_cast<uint32_t>(buses_.size() * (block + 1) / block_count));
+		});
 	}
+	graph_ = Graph{ vertex_count, edges };
 }
 
-std::optional<TranspRouteInfo> TransportRouter::MakeRoute(std::string_view stop_from, std::string_view stop_to) {
+void TransportRouter::MakeRouter(size_t thread_count) {
+	Router::Heuristic heuristic = nullptr;
+	if (params_.algorithm == RouterAlgorithm::A_STAR) {
+		heuristic_scale_ = ComputeHeuristicScale();
+		heuristic = [this](VertexId from, VertexId to) { return EstimateTime(from, to); };
+	}
+	router_ = std::make_unique<Router>(graph_, params_.algorithm, std::move(heuristic), thread_count);
+}
+
+std::optional<TranspRouteInfo> TransportRouter::MakeRoute(std::string_view stop_from, std::string_view stop_to) const {
 	TranspRouteInfo result;
 	if (stop_from == stop_to) {
 		return result;
 	}
-	auto route_info =  router_->BuildRoute(stops_to_vertex_ids_.at(std::string(stop_from)).stop_wait_id, stops_to_vertex_ids_.at(std::string(stop_to)).stop_wait_id);
+	const Stop* from = transport_catalogue_.FindStop(stop_from);
+	const Stop* to = transport_catalogue_.FindStop(stop_to);
+	if (from == nullptr || to == nullptr) {
+		return std::nullopt;
+	}
+	auto route_info =  router_->BuildRoute(GetStopVertices(from->id).stop_wait_id, GetStopVertices(to->id).stop_wait_id);
 	if (!route_info) {
 		return std::nullopt;
 	}
 	result.total_time = route_info->weight;
 
-	// parse edges of optimal route
+	// parse edges of optimal route: boarding opens a bus item, riding edges extend it
 	for (const auto& edge : route_info->edges) {
 		const Edge<double>& curr_edge_data = graph_.GetEdge(edge);
-		// if we get no bus name - push wait item
-		if (curr_edge_data.type == EdgeType::WAIT) {
-			result.items.emplace_back(TranspRouteInfo::RouteItemInfo{ EdgeType::WAIT, curr_edge_data.entity_name, 0, static_cast<double>(params_.bus_wait_time) });
+		const EdgeType edge_type = curr_edge_data.GetType();
+		if (edge_type == EdgeType::WAIT) {
+			result.items.emplace_back(TranspRouteInfo::RouteItemInfo{ EdgeType::WAIT, std::string(transport_catalogue_.GetStop(curr_edge_data.entity_id).name), 0, static_cast<double>(params_.bus_wait_time) });
 
-		} else if (curr_edge_data.type == EdgeType::BUS) {
-			result.items.emplace_back(TranspRouteInfo::RouteItemInfo{ EdgeType::BUS, curr_edge_data.entity_name, curr_edge_data.span_count, curr_edge_data.weight });
+		} else if (edge_type == EdgeType::BOARD) {
+			result.items.emplace_back(TranspRouteInfo::RouteItemInfo{ EdgeType::BUS, std::string(buses_[curr_edge_data.entity_id]->name), 0, 0.0 });
 
+		} else if (edge_type == EdgeType::BUS) {
+			TranspRouteInfo::RouteItemInfo& bus_item = result.items.back();
+			bus_item.span_count = *bus_item.span_count + static_cast<int>(curr_edge_data.GetSpanCount());
+			bus_item.time += curr_edge_data.weight;
 		}
 	}
 
@@ -16,6 +16,8 @@ namespace transport_router {
 	struct TranspRouteParams {
 		int bus_wait_time = 0;
 		double bus_velocity = 40;
+		// A* scales its great-circle estimate down by the shortest ratio of a road to its great circle
+		graph::RouterAlgorithm algorithm = graph::RouterAlgorithm::DIJKSTRA;
 	};
 
 	struct TranspRouteInfo {
@@ -37,9 +39,18 @@ namespace transport_router {
 	class TransportRouter {
 	public:
 		TransportRouter() = default;
-		TransportRouter(const TransportCatalogue& transport_catalogue, const TranspRouteParams& params);
+		// edges of the routes, the contraction hierarchy and the all-pairs table are built on thread_count threads (0 for one per hardware thread)
+		TransportRouter(const TransportCatalogue& transport_catalogue, const TranspRouteParams& params, size_t thread_count = 1);
+		// restores the router from a graph (and a hierarchy or an all-pairs table) built earlier for the same catalogue
+		TransportRouter(const TransportCatalogue& transport_catalogue, const TranspRouteParams& params,
+			Graph graph, std::optional<graph::ContractionHierarchy<double>> contraction_hierarchy,
+			std::optional<graph::AllPairsTable<double>> all_pairs_table, size_t thread_count = 1);
 
-		std::optional<TranspRouteInfo> MakeRoute(std::string_view stop_from, std::string_view stop_to);
+		std::optional<TranspRouteInfo> MakeRoute(std::string_view stop_from, std::string_view stop_to) const;
+
+		const Graph& GetGraph() const;
+		const Router& GetRouter() const;
+		const TranspRouteParams& GetParams() const;
 
 	private:
 		const TransportCatalogue& transport_catalogue_;
@@ -48,30 +59,27 @@ namespace transport_router {
 		TranspRouteParams params_;
 
 		struct StopPairVertex {
-			size_t stop_wait_id;
-			size_t stop_go_id;
+			VertexId stop_wait_id;
+			VertexId stop_go_id;
 		};
-		std::unordered_map<std::string, StopPairVertex> stops_to_vertex_ids_;
+		std::vector<geo::Coordinates> vertex_coordinates_;
+		// the least ratio of an edge's weight to the great-circle time between its ends, at most 1
+		double heuristic_scale_ = 1.0;
+		// edges refer to stops by their id and to buses by their index in buses_
+		std::vector<const Bus*> buses_;
 
 
 		double static CalculateTime(double distance, double velocity);
-		void AddStopsToGraph();
-
-		template <typename InputIt>
-		void AddBusRoutesToGraph(InputIt begin, InputIt end, std::string bus_name) {
-			for (; std::distance(begin, end) != 1; begin++) {
-				size_t from_stop_vertex_id = stops_to_vertex_ids_.at((*begin)->name).stop_go_id;
-				double edge_weight = 0.0;
-				auto curr_stop_it = begin;
-				for (std::advance(curr_stop_it, 1); curr_stop_it != end; curr_stop_it++) {
-					size_t to_stop_wait_vertex_id = stops_to_vertex_ids_.at((*curr_stop_it)->name).stop_wait_id;
-					edge_weight += CalculateTime(transport_catalogue_.GetStopsDistance(*prev(curr_stop_it), *curr_stop_it) * 1.0, params_.bus_velocity);
-					graph_.AddEdge({ from_stop_vertex_id, to_stop_wait_vertex_id, edge_weight, EdgeType::BUS, bus_name, std::distance(begin, curr_stop_it) });
-				}
-
-			}
-		}
-
-		void MakeGraph();
+		static StopPairVertex GetStopVertices(StopId stop_id);
+		double ComputeGeoTime(VertexId from, VertexId to) const;
+		double EstimateTime(VertexId from, VertexId to) const;
+		double ComputeHeuristicScale() const;
+		size_t IndexEntities();
+		void AddStopsToGraph(std::vector<Edge<double>>& edges);
+		// writes (route size - 1) * 3 edges starting from edges
+		void AddBusRouteToGraph(uint32_t bus_id, VertexId first_ride_vertex_id, Edge<double>* edges) const;
+
+		void MakeGraph(size_t thread_count);
+		void MakeRouter(size_t thread_count);
 	};
 }